@@ -0,0 +1,823 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fdgen.cpp:
+ * synthetic stress input generator for the benchmarks
+ *
+ * writes files shaped to hit the expensive paths in each plugin:
+ *
+ * cbff  - compound binary files with as many FAT sectors as asked for
+ *         (past 109 that means a DIFAT chain), a deep storage tree, wide
+ *         sibling chains and interleaved (so long and non-sequential)
+ *         mini-stream chains
+ * xls   - the same container with a Workbook stream holding one huge SST
+ *         record split over CONTINUE records
+ * pdf   - lots of small objects, a few big Flate streams and either a
+ *         classic xref table or a cross reference stream. the small
+ *         objects can also be packed into object streams
+ *
+ * the output is deterministic for a given set of parameters.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <zlib.h>
+
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+
+
+/*
+ * growable byte buffer, little endian helpers
+ */
+struct fdgBuf
+{
+	u8 *data;
+	size_t len;
+	size_t alloc;
+};
+
+static void buf_reserve(fdgBuf *b, size_t more)
+{
+	if (b->len + more <= b->alloc)
+		return;
+	size_t nalloc = b->alloc ? b->alloc : 4096;
+	while (nalloc < b->len + more)
+		nalloc *= 2;
+	u8 *p = (u8 *)realloc(b->data, nalloc);
+	if (!p)
+	{
+		fprintf(stderr, "fdgen: out of memory\n");
+		exit(1);
+	}
+	b->data = p;
+	b->alloc = nalloc;
+}
+
+static void buf_put(fdgBuf *b, const void *p, size_t len)
+{
+	buf_reserve(b, len);
+	memcpy(b->data + b->len, p, len);
+	b->len += len;
+}
+
+static void buf_put8(fdgBuf *b, u8 v)
+{
+	buf_put(b, &v, 1);
+}
+
+static void buf_put16(fdgBuf *b, u16 v)
+{
+	u8 x[2] = { (u8)v, (u8)(v >> 8) };
+	buf_put(b, x, 2);
+}
+
+static void buf_put32(fdgBuf *b, u32 v)
+{
+	u8 x[4] = { (u8)v, (u8)(v >> 8), (u8)(v >> 16), (u8)(v >> 24) };
+	buf_put(b, x, 4);
+}
+
+static void buf_printf(fdgBuf *b, const char *fmt, ...)
+{
+	char tmp[1024];
+	va_list ap;
+	va_start(ap, fmt);
+	int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+	va_end(ap);
+	if (n > 0)
+		buf_put(b, tmp, ((size_t)n < sizeof(tmp)) ? (size_t)n : sizeof(tmp) - 1);
+}
+
+static void buf_free(fdgBuf *b)
+{
+	if (b->data)
+		free(b->data);
+	b->data = NULL;
+	b->len = b->alloc = 0;
+}
+
+// tiny deterministic PRNG so runs are comparable
+static u32 g_seed = 0x12345678;
+static u32 rnd(void)
+{
+	g_seed = g_seed * 1103515245 + 12345;
+	return (g_seed >> 8);
+}
+
+
+/*
+ * compound binary file
+ */
+#define SECT_SIZE		512
+#define MINI_SIZE		64
+#define MINI_CUTOFF		4096
+#define DIR_ENT_SIZE	128
+#define FAT_PER_SECT	(SECT_SIZE / 4)
+#define DIF_PER_SECT	(FAT_PER_SECT - 1)
+#define HDR_DIFAT		109
+
+#define SECT_FREE		0xffffffff
+#define SECT_END		0xfffffffe
+#define SECT_FAT		0xfffffffd
+#define SECT_DIF		0xfffffffc
+#define SID_NONE		0xffffffff
+
+#define STGTY_STORAGE	1
+#define STGTY_STREAM	2
+#define STGTY_ROOT		5
+
+struct cbffEntry
+{
+	char name[32];
+	int type;
+	u32 child;
+	u32 right;
+	u32 start;
+	u32 size;
+	// stream contents (NULL means generated filler of 'size' bytes)
+	fdgBuf data;
+	bool mini;
+};
+
+struct cbffParams
+{
+	u32 fat_sectors;	// minimum number of FAT sectors
+	u32 depth;			// nested storages
+	u32 width;			// streams per storage
+	u32 mini_size;		// size of each small stream
+	u32 sst_strings;	// 0 for no Workbook
+	u32 sst_len;		// characters per SST string
+};
+
+static cbffEntry *g_ents;
+static u32 g_nents;
+
+static u32 add_entry(const char *name, int type)
+{
+	g_ents = (cbffEntry *)realloc(g_ents, (g_nents + 1) * sizeof(cbffEntry));
+	if (!g_ents)
+	{
+		fprintf(stderr, "fdgen: out of memory\n");
+		exit(1);
+	}
+	cbffEntry *pe = &g_ents[g_nents];
+	memset(pe, 0, sizeof(*pe));
+	snprintf(pe->name, sizeof(pe->name), "%s", name);
+	pe->type = type;
+	pe->child = pe->right = SID_NONE;
+	pe->start = SECT_END;
+	return g_nents++;
+}
+
+// children hang off the parent as one long right-sibling chain
+static void link_children(u32 parent, u32 *kids, u32 nkids)
+{
+	if (nkids < 1)
+		return;
+	g_ents[parent].child = kids[0];
+	for (u32 i = 0; i + 1 < nkids; i++)
+		g_ents[kids[i]].right = kids[i + 1];
+}
+
+static void fill_stream(u32 sid, u32 size)
+{
+	cbffEntry *pe = &g_ents[sid];
+	buf_reserve(&pe->data, size);
+	for (u32 i = 0; i < size; i++)
+		pe->data.data[i] = (u8)(sid + i);
+	pe->data.len = size;
+	pe->size = size;
+}
+
+/*
+ * BIFF8 workbook globals: BOF, one SST with its CONTINUE records, EOF.
+ * strings are never split across records to keep this simple.
+ */
+static void build_workbook(fdgBuf *wb, u32 nstr, u32 len)
+{
+	if (len > 8000)
+		len = 8000;
+
+	buf_put16(wb, 0x0809);
+	buf_put16(wb, 16);
+	buf_put16(wb, 0x0600);
+	buf_put16(wb, 0x0005);
+	buf_put16(wb, 0x0dbb);
+	buf_put16(wb, 0x07cc);
+	buf_put32(wb, 0);
+	buf_put32(wb, 0x0006);
+
+	size_t rec = wb->len;
+	buf_put16(wb, 0x00fc);
+	buf_put16(wb, 0);
+	buf_put32(wb, nstr);
+	buf_put32(wb, nstr);
+	for (u32 i = 0; i < nstr; i++)
+	{
+		size_t used = wb->len - rec - 4;
+		if (used + 3 + len > 8224)
+		{
+			// close this record, continue in a new one
+			wb->data[rec + 2] = (u8)used;
+			wb->data[rec + 3] = (u8)(used >> 8);
+			rec = wb->len;
+			buf_put16(wb, 0x003c);
+			buf_put16(wb, 0);
+		}
+		buf_put16(wb, (u16)len);
+		buf_put8(wb, 0);
+		for (u32 j = 0; j < len; j++)
+			buf_put8(wb, (u8)('a' + (rnd() % 26)));
+	}
+	size_t used = wb->len - rec - 4;
+	wb->data[rec + 2] = (u8)used;
+	wb->data[rec + 3] = (u8)(used >> 8);
+
+	buf_put16(wb, 0x000a);
+	buf_put16(wb, 0);
+}
+
+static void put_dirent(fdgBuf *b, cbffEntry *pe)
+{
+	u8 name[64];
+	memset(name, 0, sizeof(name));
+	size_t nlen = strlen(pe->name);
+	if (nlen > 31)
+		nlen = 31;
+	for (size_t i = 0; i < nlen; i++)
+		name[i * 2] = (u8)pe->name[i];
+	buf_put(b, name, sizeof(name));
+	buf_put16(b, (u16)((nlen + 1) * 2));
+	buf_put8(b, (u8)pe->type);
+	buf_put8(b, 1);			// black
+	buf_put32(b, SID_NONE);	// everything hangs off right siblings
+	buf_put32(b, pe->right);
+	buf_put32(b, pe->child);
+	u8 zero[16 + 4 + 8 + 8];
+	memset(zero, 0, sizeof(zero));
+	buf_put(b, zero, sizeof(zero));
+	buf_put32(b, pe->start);
+	buf_put32(b, pe->size);
+	buf_put32(b, 0);
+}
+
+static int gen_cbff(const char *out, cbffParams *pp)
+{
+	u32 i, j;
+
+	// the directory: root, optional Workbook, storage chain, small streams
+	u32 root = add_entry("Root Entry", STGTY_ROOT);
+	u32 *kids = (u32 *)calloc(pp->width + 3, sizeof(u32));
+	u32 parent = root;
+	for (u32 d = 0; d <= pp->depth; d++)
+	{
+		u32 nkids = 0;
+		if (d == 0 && pp->sst_strings)
+		{
+			u32 wb = add_entry("Workbook", STGTY_STREAM);
+			build_workbook(&g_ents[wb].data, pp->sst_strings, pp->sst_len);
+			g_ents[wb].size = (u32)g_ents[wb].data.len;
+			kids[nkids++] = wb;
+		}
+		if (d == 0)
+		{
+			// one big stream to bring the FAT up to size, sized below
+			kids[nkids++] = add_entry("Filler", STGTY_STREAM);
+		}
+		for (i = 0; i < pp->width; i++)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "Mini %u.%u", d, i);
+			u32 sid = add_entry(name, STGTY_STREAM);
+			fill_stream(sid, pp->mini_size);
+			kids[nkids++] = sid;
+		}
+		u32 next = SID_NONE;
+		if (d < pp->depth)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "Storage %u", d + 1);
+			next = add_entry(name, STGTY_STORAGE);
+			kids[nkids++] = next;
+		}
+		link_children(parent, kids, nkids);
+		parent = next;
+	}
+	free(kids);
+
+	// small streams live in the mini stream, interleaved sector by sector
+	u32 nmini = 0, maxper = 0, nsmall = 0;
+	for (i = 0; i < g_nents; i++)
+	{
+		cbffEntry *pe = &g_ents[i];
+		if (pe->type != STGTY_STREAM || pe->size >= MINI_CUTOFF || !strcmp(pe->name, "Filler"))
+			continue;
+		pe->mini = true;
+		u32 n = (pe->size + MINI_SIZE - 1) / MINI_SIZE;
+		nmini += n;
+		nsmall++;
+		if (n > maxper)
+			maxper = n;
+	}
+	u32 *minifat = (u32 *)calloc(nmini ? nmini : 1, sizeof(u32));
+	u32 *last = (u32 *)calloc(g_nents, sizeof(u32));
+	fdgBuf ministream = { NULL, 0, 0 };
+	buf_reserve(&ministream, (size_t)nmini * MINI_SIZE + 1);
+	ministream.len = (size_t)nmini * MINI_SIZE;
+	memset(ministream.data, 0, ministream.len);
+	u32 ms = 0;
+	for (u32 r = 0; r < maxper; r++)
+	{
+		for (i = 0; i < g_nents; i++)
+		{
+			cbffEntry *pe = &g_ents[i];
+			if (!pe->mini || r * MINI_SIZE >= pe->size)
+				continue;
+			if (r == 0)
+				pe->start = ms;
+			else
+				minifat[last[i]] = ms;
+			minifat[ms] = SECT_END;
+			last[i] = ms;
+
+			u32 chunk = pe->size - r * MINI_SIZE;
+			if (chunk > MINI_SIZE)
+				chunk = MINI_SIZE;
+			memcpy(ministream.data + (size_t)ms * MINI_SIZE, pe->data.data + r * MINI_SIZE, chunk);
+			ms++;
+		}
+	}
+	free(last);
+
+	// sector counts for everything but the filler
+	u32 dir_sects = (g_nents * DIR_ENT_SIZE + SECT_SIZE - 1) / SECT_SIZE;
+	u32 ms_sects = (u32)((ministream.len + SECT_SIZE - 1) / SECT_SIZE);
+	u32 mf_sects = (nmini * 4 + SECT_SIZE - 1) / SECT_SIZE;
+	u32 other = dir_sects + ms_sects + mf_sects;
+	for (i = 0; i < g_nents; i++)
+		if (g_ents[i].type == STGTY_STREAM && !g_ents[i].mini && strcmp(g_ents[i].name, "Filler"))
+			other += (g_ents[i].size + SECT_SIZE - 1) / SECT_SIZE;
+
+	// the filler makes up the rest of the requested FAT coverage
+	u32 filler_sects = 0;
+	if ((unsigned long long)pp->fat_sectors * DIF_PER_SECT > other)
+		filler_sects = pp->fat_sectors * DIF_PER_SECT - other;
+	// keep it a regular (not mini) stream
+	if (filler_sects < MINI_CUTOFF / SECT_SIZE)
+		filler_sects = MINI_CUTOFF / SECT_SIZE;
+	for (i = 0; i < g_nents; i++)
+		if (!strcmp(g_ents[i].name, "Filler"))
+			g_ents[i].size = filler_sects * SECT_SIZE;
+	u32 data_sects = other + filler_sects;
+
+	u32 nfat = 1, ndif = 0;
+	while (1)
+	{
+		ndif = (nfat > HDR_DIFAT) ? (nfat - HDR_DIFAT + DIF_PER_SECT - 1) / DIF_PER_SECT : 0;
+		if ((unsigned long long)nfat * FAT_PER_SECT >= (unsigned long long)data_sects + nfat + ndif)
+			break;
+		nfat++;
+	}
+	u32 total = nfat + ndif + data_sects;
+
+	// lay things out: FAT, DIFAT, then each stream contiguously
+	u32 *fat = (u32 *)malloc((size_t)nfat * FAT_PER_SECT * sizeof(u32));
+	if (!fat || !minifat)
+	{
+		fprintf(stderr, "fdgen: out of memory\n");
+		return 1;
+	}
+	for (i = 0; i < nfat * FAT_PER_SECT; i++)
+		fat[i] = SECT_FREE;
+	u32 cur = 0;
+	for (i = 0; i < nfat; i++)
+		fat[cur++] = SECT_FAT;
+	for (i = 0; i < ndif; i++)
+		fat[cur++] = SECT_DIF;
+
+	#define CHAIN(start, count) \
+		do { \
+			start = (count) ? cur : SECT_END; \
+			for (u32 k = 0; k < (count); k++, cur++) \
+				fat[cur] = (k + 1 < (count)) ? cur + 1 : SECT_END; \
+		} while (0)
+
+	u32 dir_start, ms_start, mf_start;
+	CHAIN(dir_start, dir_sects);
+	CHAIN(ms_start, ms_sects);
+	CHAIN(mf_start, mf_sects);
+	g_ents[root].start = ms_start;
+	g_ents[root].size = (u32)ministream.len;
+	for (i = 0; i < g_nents; i++)
+	{
+		cbffEntry *pe = &g_ents[i];
+		if (pe->type != STGTY_STREAM || pe->mini)
+			continue;
+		u32 n = (pe->size + SECT_SIZE - 1) / SECT_SIZE;
+		CHAIN(pe->start, n);
+	}
+	#undef CHAIN
+	if (cur != total)
+	{
+		fprintf(stderr, "fdgen: internal layout error (%u != %u)\n", cur, total);
+		return 1;
+	}
+
+	FILE *fp = fopen(out, "wb");
+	if (!fp)
+	{
+		perror(out);
+		return 1;
+	}
+
+	// header
+	fdgBuf b = { NULL, 0, 0 };
+	static const u8 sig[8] = { 0xd0, 0xcf, 0x11, 0xe0, 0xa1, 0xb1, 0x1a, 0xe1 };
+	buf_put(&b, sig, sizeof(sig));
+	u8 clsid[16];
+	memset(clsid, 0, sizeof(clsid));
+	buf_put(&b, clsid, sizeof(clsid));
+	buf_put16(&b, 0x003e);
+	buf_put16(&b, 0x0003);
+	buf_put16(&b, 0xfffe);
+	buf_put16(&b, 9);
+	buf_put16(&b, 6);
+	buf_put16(&b, 0);
+	buf_put32(&b, 0);
+	buf_put32(&b, 0);			// csectDir (v3)
+	buf_put32(&b, nfat);
+	buf_put32(&b, dir_start);
+	buf_put32(&b, 0);
+	buf_put32(&b, MINI_CUTOFF);
+	buf_put32(&b, mf_sects ? mf_start : SECT_END);
+	buf_put32(&b, mf_sects);
+	buf_put32(&b, ndif ? nfat : SECT_END);
+	buf_put32(&b, ndif);
+	for (i = 0; i < HDR_DIFAT; i++)
+		buf_put32(&b, (i < nfat) ? i : SECT_FREE);
+	fwrite(b.data, 1, b.len, fp);
+	b.len = 0;
+
+	// FAT
+	for (i = 0; i < nfat * FAT_PER_SECT; i++)
+		buf_put32(&b, fat[i]);
+	fwrite(b.data, 1, b.len, fp);
+	b.len = 0;
+
+	// DIFAT, each sector ends with the next one
+	u32 fi = HDR_DIFAT;
+	for (i = 0; i < ndif; i++)
+	{
+		for (j = 0; j < DIF_PER_SECT; j++)
+			buf_put32(&b, (fi < nfat) ? fi++ : SECT_FREE);
+		buf_put32(&b, (i + 1 < ndif) ? nfat + i + 1 : SECT_END);
+	}
+	fwrite(b.data, 1, b.len, fp);
+	b.len = 0;
+
+	// directory
+	for (i = 0; i < g_nents; i++)
+		put_dirent(&b, &g_ents[i]);
+	while (b.len % SECT_SIZE)
+	{
+		// unused entries are empty with no siblings
+		cbffEntry empty;
+		memset(&empty, 0, sizeof(empty));
+		empty.child = empty.right = SID_NONE;
+		empty.start = 0;
+		put_dirent(&b, &empty);
+	}
+	fwrite(b.data, 1, b.len, fp);
+	b.len = 0;
+
+	// mini stream and MiniFAT
+	buf_put(&b, ministream.data, ministream.len);
+	while (b.len % SECT_SIZE)
+		buf_put8(&b, 0);
+	for (i = 0; i < nmini; i++)
+		buf_put32(&b, minifat[i]);
+	while (b.len % SECT_SIZE)
+		buf_put32(&b, SECT_FREE);
+	fwrite(b.data, 1, b.len, fp);
+	b.len = 0;
+
+	// regular streams, in the same order they were laid out
+	u8 sect[SECT_SIZE];
+	for (i = 0; i < g_nents; i++)
+	{
+		cbffEntry *pe = &g_ents[i];
+		if (pe->type != STGTY_STREAM || pe->mini)
+			continue;
+		u32 n = (pe->size + SECT_SIZE - 1) / SECT_SIZE;
+		for (j = 0; j < n; j++)
+		{
+			memset(sect, 0, sizeof(sect));
+			if (pe->data.len > (size_t)j * SECT_SIZE)
+			{
+				size_t chunk = pe->data.len - (size_t)j * SECT_SIZE;
+				memcpy(sect, pe->data.data + (size_t)j * SECT_SIZE, (chunk > SECT_SIZE) ? SECT_SIZE : chunk);
+			}
+			else
+				memset(sect, (int)(j & 0xff), sizeof(sect));
+			fwrite(sect, 1, sizeof(sect), fp);
+		}
+	}
+
+	int ret = ferror(fp) ? 1 : 0;
+	if (fclose(fp) != 0)
+		ret = 1;
+	fprintf(stderr, "%s: %u sectors, %u FAT, %u DIFAT, %u directory entries, %u mini sectors in %u small streams\n",
+		out, total, nfat, ndif, g_nents, nmini, nsmall);
+
+	buf_free(&b);
+	buf_free(&ministream);
+	for (i = 0; i < g_nents; i++)
+		buf_free(&g_ents[i].data);
+	free(g_ents);
+	g_ents = NULL;
+	g_nents = 0;
+	free(fat);
+	free(minifat);
+	return ret;
+}
+
+
+/*
+ * portable document
+ */
+struct pdfParams
+{
+	u32 objects;		// total indirect objects
+	u32 streams;		// how many of them are Flate streams
+	u32 stream_kb;		// uncompressed size of each stream
+	bool xref_stream;	// cross reference stream instead of a table
+	u32 objstm;			// small objects per object stream, 0 for none
+};
+
+static bool deflate_buf(fdgBuf *in, fdgBuf *out)
+{
+	uLongf len = compressBound(in->len);
+	buf_reserve(out, len);
+	if (compress2(out->data + out->len, &len, in->data, in->len, Z_DEFAULT_COMPRESSION) != Z_OK)
+		return false;
+	out->len += len;
+	return true;
+}
+
+// the dictionary that makes up most objects, without "n 0 obj"
+static void put_dummy(fdgBuf *b, u32 n)
+{
+	buf_printf(b, "<< /Type /Dummy /Index %u /Prev %u 0 R /Name /Obj%u /Value %u.%02u "
+		"/Str (object %u) /Arr [ %u %u %u ] >>",
+		n, n - 1, n, rnd() % 1000, rnd() % 100, n, rnd() % 100, rnd() % 100, rnd() % 100);
+}
+
+// object num as an object stream holding count objects, hdr is "n1 off1 n2 off2 ..."
+static bool put_objstm(fdgBuf *b, u32 num, u32 count, fdgBuf *hdr, fdgBuf *body, fdgBuf *raw, fdgBuf *z)
+{
+	raw->len = 0;
+	buf_put(raw, hdr->data, hdr->len);
+	buf_put(raw, body->data, body->len);
+	z->len = 0;
+	if (!deflate_buf(raw, z))
+		return false;
+	buf_printf(b, "%u 0 obj\n<< /Type /ObjStm /N %u /First %lu /Filter /FlateDecode /Length %lu >>\nstream\n",
+		num, count, (unsigned long)hdr->len, (unsigned long)z->len);
+	buf_put(b, z->data, z->len);
+	buf_printf(b, "\nendstream\nendobj\n");
+	return true;
+}
+
+static int gen_pdf(const char *out, pdfParams *pp)
+{
+	if (pp->objects < 3)
+		pp->objects = 3;
+	if (pp->streams > pp->objects - 2)
+		pp->streams = pp->objects - 2;
+	// compressed objects are only listed in a cross reference stream, with
+	// a 2 byte index
+	if (pp->objstm)
+		pp->xref_stream = true;
+	if (pp->objstm > 0xffff)
+		pp->objstm = 0xffff;
+	u32 maxstm = pp->objstm ? (pp->objects + pp->objstm - 1) / pp->objstm : 0;
+
+	FILE *fp = fopen(out, "wb");
+	if (!fp)
+	{
+		perror(out);
+		return 1;
+	}
+
+	// object n is at offsets[n], the object streams come after the objects
+	// and the xref stream (if any) after those. a compressed object has its
+	// object stream in stm[n] and its index in offsets[n]
+	unsigned long long *offsets = (unsigned long long *)calloc(pp->objects + maxstm + 2, sizeof(unsigned long long));
+	u32 *stm = (u32 *)calloc(pp->objects + 1, sizeof(u32));
+	if (!offsets || !stm)
+	{
+		fprintf(stderr, "fdgen: out of memory\n");
+		free(offsets);
+		free(stm);
+		fclose(fp);
+		return 1;
+	}
+	unsigned long long pos = 0;
+	fdgBuf b = { NULL, 0, 0 };
+	fdgBuf raw = { NULL, 0, 0 };
+	fdgBuf z = { NULL, 0, 0 };
+	fdgBuf hdr = { NULL, 0, 0 };
+	fdgBuf body = { NULL, 0, 0 };
+	u32 nstm = 0, inStm = 0;
+
+	buf_printf(&b, "%%PDF-1.5\n%%\xe2\xe3\xcf\xd3\n");
+	#define FLUSH() \
+		do { fwrite(b.data, 1, b.len, fp); pos += b.len; b.len = 0; } while (0)
+	FLUSH();
+
+	u32 stride = pp->streams ? (pp->objects - 2) / pp->streams : 0;
+	for (u32 n = 1; n <= pp->objects; n++)
+	{
+		offsets[n] = pos + b.len;
+		if (n == 1)
+			buf_printf(&b, "1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+		else if (n == 2)
+			buf_printf(&b, "2 0 obj\n<< /Type /Pages /Kids [ ] /Count 0 >>\nendobj\n");
+		else if (stride && ((n - 3) % stride) == 0 && (n - 3) / stride < pp->streams)
+		{
+			// content-stream-ish text, compresses like the real thing
+			raw.len = 0;
+			while (raw.len < (size_t)pp->stream_kb * 1024)
+				buf_printf(&raw, "q 1 0 0 1 %u %u cm BT /F1 %u Tf (%08x) Tj ET Q\n",
+					rnd() % 612, rnd() % 792, 8 + rnd() % 16, rnd());
+			z.len = 0;
+			if (!deflate_buf(&raw, &z))
+			{
+				fprintf(stderr, "fdgen: compress failed\n");
+				return 1;
+			}
+			buf_printf(&b, "%u 0 obj\n<< /Length %lu /Filter /FlateDecode >>\nstream\n", n, (unsigned long)z.len);
+			buf_put(&b, z.data, z.len);
+			buf_printf(&b, "\nendstream\nendobj\n");
+		}
+		else if (pp->objstm)
+		{
+			stm[n] = pp->objects + 1 + nstm;
+			offsets[n] = inStm++;
+			buf_printf(&hdr, "%u %lu ", n, (unsigned long)body.len);
+			put_dummy(&body, n);
+			buf_printf(&body, "\n");
+		}
+		else
+		{
+			buf_printf(&b, "%u 0 obj\n", n);
+			put_dummy(&b, n);
+			buf_printf(&b, "\nendobj\n");
+		}
+
+		// write out a full object stream, or what's left at the end
+		if (inStm && (inStm == pp->objstm || n == pp->objects))
+		{
+			u32 sn = pp->objects + 1 + nstm++;
+			offsets[sn] = pos + b.len;
+			if (!put_objstm(&b, sn, inStm, &hdr, &body, &raw, &z))
+			{
+				fprintf(stderr, "fdgen: compress failed\n");
+				return 1;
+			}
+			hdr.len = body.len = 0;
+			inStm = 0;
+		}
+		if (b.len > 65536)
+			FLUSH();
+	}
+	FLUSH();
+
+	unsigned long long xref = pos;
+	if (!pp->xref_stream)
+	{
+		buf_printf(&b, "xref\n0 %u\n0000000000 65535 f \n", pp->objects + 1);
+		for (u32 n = 1; n <= pp->objects; n++)
+		{
+			buf_printf(&b, "%010llu 00000 n \n", offsets[n]);
+			if (b.len > 65536)
+				FLUSH();
+		}
+		buf_printf(&b, "trailer\n<< /Size %u /Root 1 0 R >>\n", pp->objects + 1);
+	}
+	else
+	{
+		// type, 4 byte offset (or object stream), 2 byte generation (or index)
+		u32 xn = pp->objects + nstm + 1;
+		offsets[xn] = pos;
+		raw.len = 0;
+		for (u32 n = 0; n <= xn; n++)
+		{
+			bool packed = (n && n <= pp->objects && stm[n]);
+			buf_put8(&raw, packed ? 2 : (n ? 1 : 0));
+			u32 off = packed ? stm[n] : (n ? (u32)offsets[n] : 0);
+			u8 x[4] = { (u8)(off >> 24), (u8)(off >> 16), (u8)(off >> 8), (u8)off };
+			buf_put(&raw, x, 4);
+			u16 gen = packed ? (u16)offsets[n] : (n ? 0 : 0xffff);
+			buf_put8(&raw, (u8)(gen >> 8));
+			buf_put8(&raw, (u8)gen);
+		}
+		z.len = 0;
+		if (!deflate_buf(&raw, &z))
+		{
+			fprintf(stderr, "fdgen: compress failed\n");
+			return 1;
+		}
+		buf_printf(&b, "%u 0 obj\n<< /Type /XRef /Size %u /W [ 1 4 2 ] /Root 1 0 R "
+			"/Filter /FlateDecode /Length %lu >>\nstream\n", xn, xn + 1, (unsigned long)z.len);
+		buf_put(&b, z.data, z.len);
+		buf_printf(&b, "\nendstream\nendobj\n");
+	}
+	buf_printf(&b, "startxref\n%llu\n%%%%EOF\n", xref);
+	FLUSH();
+	#undef FLUSH
+
+	int ret = ferror(fp) ? 1 : 0;
+	if (fclose(fp) != 0)
+		ret = 1;
+	fprintf(stderr, "%s: %u objects, %u Flate streams, %u object streams, %s\n", out, pp->objects, pp->streams,
+		nstm, pp->xref_stream ? "xref stream" : "xref table");
+
+	buf_free(&b);
+	buf_free(&raw);
+	buf_free(&z);
+	buf_free(&hdr);
+	buf_free(&body);
+	free(offsets);
+	free(stm);
+	return ret;
+}
+
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"usage: %s cbff [-f fat_sectors] [-d depth] [-w width] [-m mini_size] out\n"
+		"       %s xls [-f fat_sectors] [-s sst_strings] [-l sst_len] out\n"
+		"       %s pdf [-n objects] [-S streams] [-k stream_kb] [-x] [-o per_objstm] out\n",
+		argv0, argv0, argv0);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 3)
+		usage(argv[0]);
+
+	const char *kind = argv[1];
+	cbffParams cp = { 2048, 64, 16, 1000, 0, 64 };
+	pdfParams pp = { 100000, 8, 4096, false, 0 };
+	bool xls = !strcmp(kind, "xls");
+	if (xls)
+	{
+		cp.fat_sectors = 64;
+		cp.depth = 0;
+		cp.width = 2;
+		cp.sst_strings = 200000;
+	}
+
+	int c;
+	optind = 2;
+	while ((c = getopt(argc, argv, "f:d:w:m:s:l:n:S:k:xo:")) != -1)
+	{
+		switch (c)
+		{
+			case 'f': cp.fat_sectors = strtoul(optarg, NULL, 0); break;
+			case 'd': cp.depth = strtoul(optarg, NULL, 0); break;
+			case 'w': cp.width = strtoul(optarg, NULL, 0); break;
+			case 'm': cp.mini_size = strtoul(optarg, NULL, 0); break;
+			case 's': cp.sst_strings = strtoul(optarg, NULL, 0); break;
+			case 'l': cp.sst_len = strtoul(optarg, NULL, 0); break;
+			case 'n': pp.objects = strtoul(optarg, NULL, 0); break;
+			case 'S': pp.streams = strtoul(optarg, NULL, 0); break;
+			case 'k': pp.stream_kb = strtoul(optarg, NULL, 0); break;
+			case 'x': pp.xref_stream = true; break;
+			case 'o': pp.objstm = strtoul(optarg, NULL, 0); break;
+			default: usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+	const char *out = argv[optind];
+
+	if (cp.mini_size >= MINI_CUTOFF)
+		cp.mini_size = MINI_CUTOFF - 1;
+
+	if (!strcmp(kind, "cbff") || xls)
+		return gen_cbff(out, &cp);
+	if (!strcmp(kind, "pdf"))
+		return gen_pdf(out, &pp);
+	usage(argv[0]);
+	return 1;
+}
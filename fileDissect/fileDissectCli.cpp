@@ -0,0 +1,620 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectCli.cpp:
+ * headless application code
+ *
+ * load plugins, dissect each file named on the command line and print the
+ * resulting tree. useful for scripting, batch runs and profiling.
+ *
+ * with -j, files are spread over a pool of worker threads. each worker owns
+ * a queue of files (biggest first) and steals from the others when it runs
+ * dry, so one huge file only ever holds up the worker stuck with it. output
+ * is buffered per file and written in command line order.
+ */
+
+#include "fileDissect.h"		// wxWidgets base
+#include "fileDissectCli.h"
+#include <wx/filename.h>
+#include <wx/dir.h>
+
+#ifndef __WXMSW__
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+
+// implement it
+IMPLEMENT_APP_CONSOLE(fileDissectCli);
+
+
+bool fileDissectCli::OnInit()
+{
+	m_formats = NULL;
+	m_nodes = NULL;
+	m_window = 0;
+	m_jobs = 1;
+	m_bench = false;
+	m_shallow = false;
+	m_workers = NULL;
+	m_nWorkers = 0;
+	m_results = NULL;
+	m_doneLock = NULL;
+	m_doneCond = NULL;
+
+	// everything goes to stderr, stdout is for the dissection
+	m_log = new wxLogStderr();
+	delete wxLog::SetActiveTarget(m_log);
+
+	wxCmdLineParser parser(argc, argv);
+	parser.SetDesc(g_cliCmdLineDesc);
+	parser.SetSwitchChars(wxT("-"));
+	if (parser.Parse(true) != 0)
+		return false;
+
+	if (parser.Found(wxT("q")))
+		wxLog::SetLogLevel(wxLOG_Error);
+	else if (!parser.Found(wxT("v")))
+		wxLog::SetLogLevel(wxLOG_Warning);
+	wxLog::SetTimestamp(NULL);
+
+	parser.Found(wxT("t"), &m_type);
+	m_bench = parser.Found(wxT("b"));
+	m_shallow = parser.Found(wxT("s"));
+	if (parser.Found(wxT("w"), &m_window) && m_window < 1)
+	{
+		wxLogError(wxT("Window size must be at least 1 MB"));
+		return false;
+	}
+	if (parser.Found(wxT("j"), &m_jobs) && m_jobs < 0)
+	{
+		wxLogError(wxT("Number of jobs can't be negative"));
+		return false;
+	}
+	if (m_jobs == 0)
+	{
+		m_jobs = wxThread::GetCPUCount();
+		if (m_jobs < 1)
+			m_jobs = 1;
+	}
+
+	size_t pcount = parser.GetParamCount();
+	for (size_t i = 0; i < pcount; i++)
+		AddInput(parser.GetParam(i));
+
+	// load the same plugins the GUI does
+	m_nodes = new fileDissectNodes();
+	m_formats = new fileDissectFmts();
+	m_formats->LoadPlugins(m_log, m_nodes);
+	return true;
+}
+
+
+// directories are expanded to every file below them, in a stable order
+void fileDissectCli::AddInput(const wxString &param)
+{
+	if (param == wxT("-") || !wxDirExists(param))
+	{
+		m_files.Add(param);
+		return;
+	}
+
+	wxArrayString found;
+	wxDir::GetAllFiles(param, &found);
+	found.Sort();
+	for (size_t i = 0; i < found.GetCount(); i++)
+		m_files.Add(found[i]);
+}
+
+
+int fileDissectCli::OnRun()
+{
+	int ret = 0;
+
+	size_t nthreads = (size_t)m_jobs;
+	if (nthreads > m_files.GetCount())
+		nthreads = m_files.GetCount();
+	if (nthreads > 1)
+		return RunParallel(nthreads);
+
+	fileDissectCliWorker w(this, 0, 0);
+	for (size_t i = 0; i < m_files.GetCount(); i++)
+	{
+		if (!DissectFile(&w, m_files[i], stdout))
+			ret = 1;
+	}
+	return ret;
+}
+
+
+int fileDissectCli::OnExit()
+{
+	// plugins hold m_nodes, so they go first
+	if (m_formats)
+		delete m_formats;
+	if (m_nodes)
+		delete m_nodes;
+	return 0;
+}
+
+
+// sort helper for handing out the biggest files first
+struct fileDissectCliJob
+{
+	wxFileOffset size;
+	size_t idx;
+};
+
+static int CompareJobs(const void *a, const void *b)
+{
+	const fileDissectCliJob *pa = (const fileDissectCliJob *)a;
+	const fileDissectCliJob *pb = (const fileDissectCliJob *)b;
+
+	if (pa->size != pb->size)
+		return (pa->size > pb->size) ? -1 : 1;
+	// keep it deterministic
+	return (pa->idx < pb->idx) ? -1 : (pa->idx > pb->idx);
+}
+
+
+int fileDissectCli::RunParallel(size_t nthreads)
+{
+	size_t nfiles = m_files.GetCount();
+	fileDissectCliThread **threads = NULL;
+	fileDissectCliJob *jobs = NULL;
+	size_t nstarted = 0;
+	int ret = 0;
+
+	m_results = (fileDissectCliResult *)calloc(nfiles, sizeof(fileDissectCliResult));
+	m_workers = (fileDissectCliWorker **)calloc(nthreads, sizeof(fileDissectCliWorker *));
+	threads = (fileDissectCliThread **)calloc(nthreads, sizeof(fileDissectCliThread *));
+	jobs = (fileDissectCliJob *)calloc(nfiles, sizeof(fileDissectCliJob));
+	if (!m_results || !m_workers || !threads || !jobs)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for batch state"), wxT("fileDissectCli::RunParallel()"));
+		ret = 1;
+		goto cleanup;
+	}
+
+	// biggest first, dealt out round robin
+	for (size_t i = 0; i < nfiles; i++)
+	{
+		wxStructStat st;
+		jobs[i].idx = i;
+		jobs[i].size = 0;
+		if (m_files[i] != wxT("-") && wxStat(m_files[i], &st) == 0)
+			jobs[i].size = st.st_size;
+	}
+	qsort(jobs, nfiles, sizeof(fileDissectCliJob), CompareJobs);
+
+	for (m_nWorkers = 0; m_nWorkers < nthreads; m_nWorkers++)
+		m_workers[m_nWorkers] = new fileDissectCliWorker(this, m_nWorkers, nfiles / nthreads + 1);
+	for (size_t i = 0; i < nfiles; i++)
+	{
+		if (!m_workers[i % nthreads]->Push(jobs[i].idx))
+		{
+			wxLogError(wxT("%s: Unable to queue file"), m_files[jobs[i].idx].c_str());
+			m_results[jobs[i].idx].done = true;
+		}
+	}
+
+	m_doneLock = new wxMutex();
+	m_doneCond = new wxCondition(*m_doneLock);
+
+	for (size_t i = 0; i < nthreads; i++)
+	{
+		threads[i] = new fileDissectCliThread(m_workers[i]);
+		if (threads[i]->Create() != wxTHREAD_NO_ERROR
+			|| threads[i]->Run() != wxTHREAD_NO_ERROR)
+		{
+			// the others will pick up its queue
+			wxLogError(wxT("%s: Unable to start worker thread %u"), wxT("fileDissectCli::RunParallel()"),
+				(unsigned int)i);
+			delete threads[i];
+			threads[i] = NULL;
+		}
+		else
+			nstarted++;
+	}
+	// no threads at all, do it the slow way
+	if (nstarted < 1)
+		RunWorker(m_workers[0]);
+
+	// write everything out in order as it completes
+	for (size_t next = 0; next < nfiles; next++)
+	{
+		{
+			wxMutexLocker lock(*m_doneLock);
+			while (!m_results[next].done)
+				m_doneCond->Wait();
+		}
+
+		FILE *fp = m_results[next].fp;
+		if (!m_results[next].ok)
+			ret = 1;
+		if (fp)
+		{
+			char buf[65536];
+			size_t len;
+
+			rewind(fp);
+			while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+				fwrite(buf, 1, len, stdout);
+			fclose(fp);
+			m_results[next].fp = NULL;
+		}
+	}
+	fflush(stdout);
+
+	for (size_t i = 0; i < nthreads; i++)
+	{
+		if (threads[i])
+		{
+			threads[i]->Wait();
+			delete threads[i];
+		}
+	}
+
+cleanup:
+	if (m_workers)
+	{
+		for (size_t i = 0; i < m_nWorkers; i++)
+			delete m_workers[i];
+		free(m_workers);
+		m_workers = NULL;
+		m_nWorkers = 0;
+	}
+	if (m_doneCond)
+		delete m_doneCond;
+	if (m_doneLock)
+		delete m_doneLock;
+	m_doneCond = NULL;
+	m_doneLock = NULL;
+	if (m_results)
+		free(m_results);
+	m_results = NULL;
+	if (threads)
+		free(threads);
+	if (jobs)
+		free(jobs);
+	return ret;
+}
+
+
+// own queue first, then steal from the back of everyone else's
+bool fileDissectCli::NextFile(fileDissectCliWorker *w, size_t *pidx)
+{
+	if (w->PopFront(pidx))
+		return true;
+	for (size_t i = 1; i < m_nWorkers; i++)
+	{
+		fileDissectCliWorker *victim = m_workers[(w->m_id + i) % m_nWorkers];
+		if (victim->PopBack(pidx))
+			return true;
+	}
+	return false;
+}
+
+
+void fileDissectCli::RunWorker(fileDissectCliWorker *w)
+{
+	size_t idx;
+
+	while (NextFile(w, &idx))
+	{
+		bool ok = false;
+		FILE *fp = tmpfile();
+		if (!fp)
+			wxLogError(wxT("%s: Unable to create temporary output file"), m_files[idx].c_str());
+		else
+			ok = DissectFile(w, m_files[idx], fp);
+
+		wxMutexLocker lock(*m_doneLock);
+		m_results[idx].fp = fp;
+		m_results[idx].ok = ok;
+		m_results[idx].done = true;
+		m_doneCond->Broadcast();
+	}
+}
+
+
+wxThread::ExitCode fileDissectCliThread::Entry()
+{
+	m_worker->m_cli->RunWorker(m_worker);
+	return 0;
+}
+
+
+/*
+ * the first worker uses the shared instances, the rest get their own from
+ * the module's factory. either way a module may have to be loaded, so that
+ * (and plugin construction, which loads sub-plugins) is serialized.
+ */
+fileDissectPlugin *fileDissectCli::GetPlugin(fileDissectCliWorker *w, int fmt)
+{
+	if ((size_t)fmt >= w->m_nPlugins)
+		return NULL;
+	if (w->m_plugins[fmt])
+		return w->m_plugins[fmt];
+
+	wxMutexLocker lock(m_createLock);
+	fileDissectPlugin__Module *pm = m_formats->GetFormat(fmt);
+	if (w->m_id == 0)
+		w->m_plugins[fmt] = pm->GetInstance();
+	else if (pm->Load())
+		w->m_plugins[fmt] = pm->m_create_instance(m_log, w->m_nodes);
+	return w->m_plugins[fmt];
+}
+
+
+bool fileDissectCli::DissectFile(fileDissectCliWorker *w, const wxString &fname, FILE *fp)
+{
+	fileDissectCliPhases phases;
+	wxFileMap file;
+	bool opened;
+
+	if (fname == wxT("-"))
+		opened = file.OpenStream(fileno(stdin));
+	else if (m_window)
+		opened = file.OpenWindowed(fname.c_str(), (size_t)m_window * 1024 * 1024);
+	else
+		opened = file.Open(fname.c_str());
+	if (!opened)
+	{
+		wxLogError(wxT("%s: Unable to open file"), fname.c_str());
+		if (m_bench)
+			WriteBench(fp, fname, NULL, NULL, 0, &phases);
+		return false;
+	}
+	phases.Phase("open");
+
+	// an explicit type wins, otherwise see if we have a plugin that recognizes it
+	int fmt;
+	if (!m_type.IsEmpty())
+		fmt = m_formats->FindFormatForExt(m_type.c_str());
+	else
+		fmt = m_formats->FindFormatForFile(&file, wxFileName(fname).GetExt().c_str());
+	fileDissectPlugin *plugin = NULL;
+	if (fmt >= 0)
+		plugin = GetPlugin(w, fmt);
+	if (!plugin)
+	{
+		wxLogError(wxT("%s: No plug-ins support this file type!"), fname.c_str());
+		if (m_bench)
+			WriteBench(fp, fname, NULL, &file, 0, &phases);
+		return false;
+	}
+	phases.Phase("select");
+
+	wxLogVerbose(wxT("Dissecting \"%s\" using the \"%s\" plug-in."), fname.c_str(), plugin->m_description);
+	w->m_nodes->DeleteAllItems();
+	plugin->m_file = &file;
+	if (m_bench)
+		plugin->m_phases = &phases;
+	file.Advise(wxFM_ADVISE_SEQUENTIAL);
+	plugin->Dissect();
+	plugin->m_phases = NULL;
+	// whatever the plugin didn't account for itself
+	phases.Phase("dissect");
+
+	size_t nodes = w->m_nodes->GetCount();
+	if (!m_bench)
+	{
+		fprintf(fp, "== %s (%s)\n", (const char *)fname.mb_str(), 
+			(const char *)wxString(plugin->m_description).mb_str());
+		DumpNodes(w->m_nodes, fp);
+	}
+
+	w->m_nodes->DeleteAllItems();
+	plugin->CloseFile();
+	plugin->m_file = NULL;
+	phases.Phase("close");
+
+	if (m_bench)
+		WriteBench(fp, fname, plugin, &file, nodes, &phases);
+	return true;
+}
+
+
+static void WriteJSONString(FILE *fp, const char *str)
+{
+	fputc('"', fp);
+	for (const unsigned char *p = (const unsigned char *)str; *p; p++)
+	{
+		if (*p == '"' || *p == '\\')
+			fprintf(fp, "\\%c", *p);
+		else if (*p < 0x20)
+			fprintf(fp, "\\u%04x", *p);
+		else
+			fputc(*p, fp);
+	}
+	fputc('"', fp);
+}
+
+
+/*
+ * one JSON object per line, e.g.
+ * {"file":"a.xls","plugin":"Compound Binary File","matched":true,"size":1234,"nodes":56,
+ *  "phases":{"open":0.012,"select":0.003,"header":0.020,...},"total_ms":1.5,"peak_rss_kb":5120}
+ * matched only says a plugin took the file, plugins don't report whether
+ * the dissection went well. peak RSS is the whole process' high water mark
+ * so far.
+ */
+void fileDissectCli::WriteBench(FILE *fp, const wxString &fname, fileDissectPlugin *plugin, wxFileMap *file,
+	size_t nodes, fileDissectCliPhases *phases)
+{
+	fprintf(fp, "{\"file\":");
+	WriteJSONString(fp, (const char *)fname.mb_str(wxConvUTF8));
+	if (plugin)
+	{
+		fprintf(fp, ",\"plugin\":");
+		WriteJSONString(fp, (const char *)wxString(plugin->m_description).mb_str(wxConvUTF8));
+	}
+	fprintf(fp, ",\"matched\":%s", plugin ? "true" : "false");
+	if (file)
+		fprintf(fp, ",\"size\":%lld", (long long)file->Length());
+	fprintf(fp, ",\"nodes\":%lu,\"phases\":{", (unsigned long)nodes);
+
+	double total = 0;
+	for (size_t i = 0; i < phases->m_count; i++)
+	{
+		fprintf(fp, "%s\"%s\":%.3f", i ? "," : "", phases->m_names[i], phases->m_ms[i]);
+		total += phases->m_ms[i];
+	}
+	fprintf(fp, "},\"total_ms\":%.3f", total);
+
+#ifndef __WXMSW__
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+		fprintf(fp, ",\"peak_rss_kb\":%ld", (long)ru.ru_maxrss);
+#endif
+	fprintf(fp, "}\n");
+}
+
+
+fileDissectCliPhases::fileDissectCliPhases(void)
+{
+	m_count = 0;
+	m_last = Now();
+}
+
+// time since the previous mark goes to this phase
+void fileDissectCliPhases::Phase(const char *name)
+{
+	double now = Now();
+	if (m_count < CLI_MAX_PHASES)
+	{
+		m_names[m_count] = name;
+		m_ms[m_count] = now - m_last;
+		m_count++;
+	}
+	m_last = now;
+}
+
+// milliseconds, from whatever epoch
+double fileDissectCliPhases::Now(void)
+{
+#ifdef __WXMSW__
+	return wxGetLocalTimeMillis().ToDouble();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (double)tv.tv_sec * 1000.0 + (double)tv.tv_usec / 1000.0;
+#endif
+}
+
+
+fileDissectCliWorker::fileDissectCliWorker(fileDissectCli *cli, size_t id, size_t nfiles)
+{
+	m_cli = cli;
+	m_id = id;
+	m_nPlugins = cli->m_formats->GetFormatCount();
+	m_plugins = NULL;
+	if (m_nPlugins > 0)
+		m_plugins = (fileDissectPlugin **)calloc(m_nPlugins, sizeof(fileDissectPlugin *));
+	if (!m_plugins)
+		m_nPlugins = 0;
+	m_nodes = (id == 0) ? cli->m_nodes : new fileDissectNodes();
+
+	m_queue = NULL;
+	m_head = m_tail = 0;
+	if (nfiles > 0)
+		m_queue = (size_t *)calloc(nfiles, sizeof(size_t));
+}
+
+fileDissectCliWorker::~fileDissectCliWorker(void)
+{
+	// our own plugins hold m_nodes, so they go first
+	if (m_id != 0)
+	{
+		for (size_t i = 0; i < m_nPlugins; i++)
+		{
+			if (m_plugins[i])
+				delete m_plugins[i];
+		}
+		delete m_nodes;
+	}
+	if (m_plugins)
+		free(m_plugins);
+	if (m_queue)
+		free(m_queue);
+}
+
+bool fileDissectCliWorker::Push(size_t idx)
+{
+	wxMutexLocker lock(m_lock);
+	if (!m_queue)
+		return false;
+	m_queue[m_tail++] = idx;
+	return true;
+}
+
+bool fileDissectCliWorker::PopFront(size_t *pidx)
+{
+	wxMutexLocker lock(m_lock);
+	if (m_head >= m_tail)
+		return false;
+	*pidx = m_queue[m_head++];
+	return true;
+}
+
+bool fileDissectCliWorker::PopBack(size_t *pidx)
+{
+	wxMutexLocker lock(m_lock);
+	if (m_head >= m_tail)
+		return false;
+	*pidx = m_queue[--m_tail];
+	return true;
+}
+
+
+// print the tree, one node per line, indented by depth
+void fileDissectCli::DumpNodes(fileDissectNodes *nodes, FILE *fp)
+{
+	wxTreeItemId id = nodes->GetRootItem();
+	int depth = 0;
+
+	// walk it without recursing, these can get deep
+	while (id.IsOk())
+	{
+		fprintf(fp, "%*s%s", depth * 2, "", (const char *)nodes->GetItemText(id).mb_str());
+
+		wxFileOffset start, end;
+		fdTIData *pTID;
+		if (nodes->GetItemRange(id, start, end))
+			fprintf(fp, " [0x%llx-0x%llx]", (unsigned long long)start, (unsigned long long)end);
+		else if ((pTID = (fdTIData *)nodes->GetItemData(id)))
+		{
+			for (fdTIData::iterator i = pTID->begin();
+				i != pTID->end();
+				i++)
+			{
+				fileDissectSel *pSel = *i;
+				fprintf(fp, " [0x%llx-0x%llx]",
+					(unsigned long long)pSel->m_start, (unsigned long long)pSel->m_end);
+			}
+		}
+		fputc('\n', fp);
+
+		// next node in pre-order
+		if (!m_shallow)
+			nodes->LoadChildren(id);
+		wxTreeItemId next = nodes->GetFirstChild(id);
+		if (next.IsOk())
+		{
+			depth++;
+			id = next;
+			continue;
+		}
+		while (id.IsOk())
+		{
+			next = nodes->GetNextSibling(id);
+			if (next.IsOk())
+				break;
+			id = nodes->GetItemParent(id);
+			depth--;
+		}
+		id = next;
+	}
+}
@@ -0,0 +1,153 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectCli.h:
+ * headless (command line) application declarations
+ */
+#ifndef __fileDissectCli_h_
+#define __fileDissectCli_h_
+
+#include "fileDissect.h"		// wxWidgets base
+#include <wx/cmdline.h>			// command line
+#include <wx/thread.h>			// batch workers
+
+#include "fileDissectFmts.h"
+#include "fileDissectNodes.h"
+#include "wxFileMap.h"
+
+#define CLI_NAME 	wxT("fd-cli")
+
+class fileDissectCli;
+
+/*
+ * everything one batch worker needs to itself. plugin instances keep per
+ * file state, so each worker gets its own from the module's factory (the
+ * first worker just uses the shared ones).
+ */
+class fileDissectCliWorker
+{
+public:
+	fileDissectCliWorker(fileDissectCli *cli, size_t id, size_t nfiles);
+	~fileDissectCliWorker(void);
+
+	// work queue, the owner takes from the front and thieves from the back
+	bool Push(size_t idx);
+	bool PopFront(size_t *pidx);
+	bool PopBack(size_t *pidx);
+
+	fileDissectCli *m_cli;
+	size_t m_id;
+	fileDissectNodes *m_nodes;
+	fileDissectPlugin **m_plugins;	// indexed like fileDissectFmts::GetFormat()
+	size_t m_nPlugins;
+
+private:
+	wxMutex m_lock;
+	size_t *m_queue;
+	size_t m_head;
+	size_t m_tail;
+};
+
+class fileDissectCliThread : public wxThread
+{
+public:
+	fileDissectCliThread(fileDissectCliWorker *worker)
+		: wxThread(wxTHREAD_JOINABLE), m_worker(worker) { };
+	virtual ExitCode Entry();
+
+private:
+	fileDissectCliWorker *m_worker;
+};
+
+// --bench timing, plugins report their own phases through this too
+#define CLI_MAX_PHASES	32
+
+class fileDissectCliPhases : public fileDissectPhaseSink
+{
+public:
+	fileDissectCliPhases(void);
+	virtual void Phase(const char *name);
+	static double Now(void);
+
+	const char *m_names[CLI_MAX_PHASES];
+	double m_ms[CLI_MAX_PHASES];
+	size_t m_count;
+
+private:
+	double m_last;
+};
+
+// where a file's output ended up, filled in by whichever worker did it
+struct fileDissectCliResult
+{
+	FILE *fp;
+	bool ok;
+	bool done;
+};
+
+
+/*
+ * console application, dissects files and dumps the tree to stdout
+ */
+class fileDissectCli : public wxAppConsole
+{
+public:
+	bool OnInit();
+	int OnRun();
+	int OnExit();
+
+	bool DissectFile(fileDissectCliWorker *w, const wxString &fname, FILE *fp);
+	void DumpNodes(fileDissectNodes *nodes, FILE *fp);
+	void WriteBench(FILE *fp, const wxString &fname, fileDissectPlugin *plugin, wxFileMap *file,
+		size_t nodes, fileDissectCliPhases *phases);
+
+	// batch mode
+	void RunWorker(fileDissectCliWorker *w);
+
+	fileDissectFmts *m_formats;		// supported file formats
+	fileDissectNodes *m_nodes;		// dissection output (shared plugins)
+	wxLog *m_log;					// logging object
+
+private:
+	void AddInput(const wxString &param);
+	int RunParallel(size_t nthreads);
+	bool NextFile(fileDissectCliWorker *w, size_t *pidx);
+	fileDissectPlugin *GetPlugin(fileDissectCliWorker *w, int fmt);
+
+	wxArrayString m_files;			// files to dissect
+	long m_window;					// window size for windowed mapping (MB), 0 to map it all
+	wxString m_type;				// extension to use instead of the file's own
+	long m_jobs;					// worker threads, 0 for one per CPU
+	bool m_bench;					// report timings instead of the tree
+	bool m_shallow;					// leave lazily built nodes collapsed
+
+	// batch state
+	fileDissectCliWorker **m_workers;
+	size_t m_nWorkers;
+	fileDissectCliResult *m_results;
+	wxMutex *m_doneLock;
+	wxCondition *m_doneCond;
+	wxMutex m_createLock;			// module loading and plugin construction
+};
+
+
+/* command line parameters */
+static const wxCmdLineEntryDesc g_cliCmdLineDesc[] =
+{
+	{ wxCMD_LINE_SWITCH, wxT("h"), wxT("help"), wxT("show this help message"), wxCMD_LINE_VAL_NONE, wxCMD_LINE_OPTION_HELP },
+	{ wxCMD_LINE_SWITCH, wxT("q"), wxT("quiet"), wxT("only report errors"), wxCMD_LINE_VAL_NONE, 0 },
+	{ wxCMD_LINE_SWITCH, wxT("v"), wxT("verbose"), wxT("report informational messages too"), wxCMD_LINE_VAL_NONE, 0 },
+	{ wxCMD_LINE_OPTION, wxT("w"), wxT("window"), wxT("map input in windows of this many MB"), wxCMD_LINE_VAL_NUMBER, 0 },
+	{ wxCMD_LINE_OPTION, wxT("t"), wxT("type"), wxT("dissect as this file extension (e.g. xls)"), wxCMD_LINE_VAL_STRING, 0 },
+	{ wxCMD_LINE_SWITCH, wxT("s"), wxT("shallow"), wxT("skip detail nodes that are only built on demand (e.g. FAT entries)"), wxCMD_LINE_VAL_NONE, 0 },
+	{ wxCMD_LINE_SWITCH, wxT("b"), wxT("bench"), wxT("print per file timings as JSON instead of the tree"), wxCMD_LINE_VAL_NONE, 0 },
+	{ wxCMD_LINE_OPTION, wxT("j"), wxT("jobs"), wxT("dissect this many files at once (0 for one per CPU)"), wxCMD_LINE_VAL_NUMBER, 0 },
+	{ wxCMD_LINE_PARAM, NULL, NULL, wxT("input file or directory (- for stdin)"), wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_MULTIPLE },
+	{ wxCMD_LINE_NONE, NULL, NULL, NULL, wxCMD_LINE_VAL_NONE, 0 }
+};
+
+
+DECLARE_APP(fileDissectCli);
+
+#endif
@@ -11,6 +11,9 @@
 #include <wx/listimpl.cpp>
 WX_DEFINE_PLUGINLIST(fileDissectPlugin);
 
+// a matching extension is worth a little, but never more than real magic
+#define FD_SNIFF_EXT_SCORE	10
+
 
 // default class constructor
 fileDissectFmts::fileDissectFmts(void)
@@ -19,10 +22,19 @@ fileDissectFmts::fileDissectFmts(void)
 
 	m_log = 0;
 	m_tree = 0;
+	m_modules = NULL;
+	m_nModules = 0;
+	m_sigs = NULL;
+	m_sigdata = NULL;
+}
+
+fileDissectFmts::~fileDissectFmts(void)
+{
+	FreeSniffer();
 }
 
 // scan the module directory
-void fileDissectFmts::LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree)
+void fileDissectFmts::LoadPlugins(wxLog *plog, fileDissectNodes *tree)
 {
 	m_log = plog;
 	m_tree = tree;
@@ -34,34 +46,262 @@ void fileDissectFmts::LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree)
 	path += wxFileName::GetPathSeparator();
 	
 	fileDissectFmtsBase::LoadPlugins(path, plog, tree);
+	BuildSniffer();
 }
 
 
-// look for a plugin that reports to suppor this
-fileDissectPlugin *fileDissectFmts::FindPluginForExt(const wxChar *extension)
+// called for freshly loaded modules, the results end up in the manifest
+void fileDissectFmts::Describe(fileDissectPlugin__Module *pm)
 {
-#ifdef CHECK_FOR_DUPLICATE_EXTENSION_SUPPORT
-	fileDissectPlugin *found = NULL;
-#endif
+	fileDissectPlugin *p = pm->m_instance;
+
+	if (p->m_extensions)
+		pm->AddManifest(wxT("extensions"), p->m_extensions);
+
+	if (!p->m_signatures)
+		return;
+	for (const fileDissectSig *ps = p->m_signatures; ps->m_bytes; ps++)
+	{
+		wxString line = wxString::Format(wxT("%d %lu %lu %d "), ps->m_where,
+			(unsigned long)ps->m_offset, (unsigned long)ps->m_range, ps->m_score);
+		for (size_t j = 0; j < ps->m_len; j++)
+			line += wxString::Format(wxT("%02x"), (wxByte)ps->m_bytes[j]);
+		pm->AddManifest(wxT("signature"), line);
+	}
+}
+
+
+static int hexval(wxChar ch)
+{
+	if (ch >= wxT('0') && ch <= wxT('9'))
+		return ch - wxT('0');
+	if (ch >= wxT('a') && ch <= wxT('f'))
+		return ch - wxT('a') + 10;
+	if (ch >= wxT('A') && ch <= wxT('F'))
+		return ch - wxT('A') + 10;
+	return -1;
+}
+
+
+void fileDissectFmts::FreeSniffer(void)
+{
+	m_sniffer.Clear();
+	if (m_modules)
+		free(m_modules);
+	if (m_sigs)
+		free(m_sigs);
+	if (m_sigdata)
+		free(m_sigdata);
+	m_modules = NULL;
+	m_nModules = 0;
+	m_sigs = NULL;
+	m_sigdata = NULL;
+}
+
+
+/*
+ * compile every plugin's signatures into one matcher. they come from the
+ * manifest, so this works without loading any module.
+ */
+void fileDissectFmts::BuildSniffer(void)
+{
+	FreeSniffer();
+	if (m_list.size() < 1)
+		return;
+
+	// size everything up first, the sniffer keeps pointers into m_sigs
+	size_t nsigs = 0, nbytes = 0;
 	for (fileDissectFmtsBase::iterator i = m_list.begin();
 		i != m_list.end();
 		i++)
 	{
-		fileDissectPlugin *p = (*i)->m_instance;
+		wxArrayString &mf = (*i)->m_manifest;
+		for (size_t j = 0; j < mf.GetCount(); j++)
+		{
+			if (mf[j].BeforeFirst(wxT('\t')) != wxT("signature"))
+				continue;
+			nsigs++;
+			nbytes += mf[j].AfterLast(wxT(' ')).Len() / 2;
+		}
+	}
+
+	m_modules = (fileDissectPlugin__Module **)calloc(m_list.size(), sizeof(fileDissectPlugin__Module *));
+	m_sigs = (fileDissectSig *)calloc(nsigs + m_list.size(), sizeof(fileDissectSig));
+	m_sigdata = (char *)malloc(nbytes + 1);
+	if (!m_modules || !m_sigs || !m_sigdata)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for signatures"),
+			wxT("fileDissectFmts::BuildSniffer()"));
+		FreeSniffer();
+		return;
+	}
 
-		if (p->SupportsExtension(extension))
+	fileDissectSig *ps = m_sigs;
+	char *pd = m_sigdata;
+	for (fileDissectFmtsBase::iterator i = m_list.begin();
+		i != m_list.end();
+		i++)
+	{
+		fileDissectSig *first = ps;
+		wxArrayString &mf = (*i)->m_manifest;
+		for (size_t j = 0; j < mf.GetCount(); j++)
 		{
-#ifdef CHECK_FOR_DUPLICATE_EXTENSION_SUPPORT
-			if (found)
-				// wtf!
-				;
-#endif
-			// make a new one, it will be deleted by the parent
-			// return (*i)->m_create_instance(m_log, m_tree);
-
-			return p;
+			if (mf[j].BeforeFirst(wxT('\t')) != wxT("signature"))
+				continue;
+
+			wxString val = mf[j].AfterFirst(wxT('\t'));
+			wxString hex = val.AfterLast(wxT(' '));
+			int where, score;
+			unsigned long offset, range;
+			if (wxSscanf(val.c_str(), wxT("%d %lu %lu %d"), &where, &offset, &range, &score) != 4
+				|| hex.Len() < 2 || (hex.Len() % 2) != 0)
+			{
+				wxLogError(wxT("%s: Invalid signature for \"%s\" in plugin manifest"),
+					wxT("fileDissectFmts::BuildSniffer()"), (*i)->m_filename.c_str());
+				continue;
+			}
+
+			size_t len = hex.Len() / 2, k;
+			for (k = 0; k < len; k++)
+			{
+				int hi = hexval(hex[k * 2]), lo = hexval(hex[k * 2 + 1]);
+				if (hi < 0 || lo < 0)
+					break;
+				pd[k] = (char)((hi << 4) | lo);
+			}
+			if (k < len)
+				continue;
+
+			ps->m_bytes = pd;
+			ps->m_len = len;
+			ps->m_where = where;
+			ps->m_offset = (size_t)offset;
+			ps->m_range = (size_t)range;
+			ps->m_score = score;
+			ps++;
+			pd += len;
 		}
+		// terminate this plugin's list
+		ps++;
+
+		if (!m_sniffer.AddSignatures(first, (int)m_nModules))
+			break;
+		m_modules[m_nModules++] = *i;
+	}
+	m_sniffer.Compile();
+}
+
+
+// does an extension list like "*.xls;*.doc" from the manifest cover this one?
+static bool ExtensionMatches(const wxString &exts, const wxChar *extension)
+{
+	if (!extension || exts.IsEmpty())
+		return false;
+
+	wxString name(wxT("."));
+	name += extension;
+
+	wxString rest = exts;
+	while (!rest.IsEmpty())
+	{
+		wxString pat = rest.BeforeFirst(wxT(';'));
+		rest = rest.AfterFirst(wxT(';'));
+		if (!pat.IsEmpty() && ::wxMatchWild(pat, name, false))
+			return true;
+	}
+	return false;
+}
+
+
+// look for a plugin that reports to suppor this
+int fileDissectFmts::FindFormatForExt(const wxChar *extension)
+{
+	for (size_t i = 0; i < m_nModules; i++)
+	{
+		if (ExtensionMatches(m_modules[i]->GetManifest(wxT("extensions")), extension))
+			return (int)i;
 	}
 	// not found
-	return NULL;
+	return -1;
+}
+
+
+/*
+ * score every plugin against the start and end of the file in one pass each
+ * and take the best. if nothing recognizes the content, fall back to the
+ * extension like we always did.
+ */
+int fileDissectFmts::FindFormatForFile(wxFileMap *file, const wxChar *extension)
+{
+	int best = -1;
+
+	if (file && m_nModules > 0 && m_sniffer.GetSignatureCount() > 0)
+	{
+		int *scores = (int *)calloc(m_nModules, sizeof(int));
+		bool *hits = (bool *)calloc(m_sniffer.GetSignatureCount(), sizeof(bool));
+		if (!scores || !hits)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for scores"),
+				wxT("fileDissectFmts::FindFormatForFile()"));
+			if (scores)
+				free(scores);
+			if (hits)
+				free(hits);
+			return FindFormatForExt(extension);
+		}
+
+		wxFileOffset flen = file->Length();
+		wxFileOffset head = (wxFileOffset)m_sniffer.GetHeadSize();
+		wxFileOffset tail = (wxFileOffset)m_sniffer.GetTailSize();
+
+		// small files get scanned once
+		if (head + tail >= flen)
+		{
+			head = flen;
+			tail = 0;
+		}
+		if (head > 0)
+			m_sniffer.Score(file->View(0, (size_t)head), (size_t)head, 0, flen, scores, hits);
+		if (tail > 0)
+			m_sniffer.Score(file->View(flen - tail, (size_t)tail), (size_t)tail, flen - tail, flen,
+				scores, hits);
+
+		int best_score = 0;
+		for (size_t i = 0; i < m_nModules; i++)
+		{
+			if (scores[i] < 1)
+				continue;
+			if (ExtensionMatches(m_modules[i]->GetManifest(wxT("extensions")), extension))
+				scores[i] += FD_SNIFF_EXT_SCORE;
+			if (scores[i] > best_score)
+			{
+				best_score = scores[i];
+				best = (int)i;
+			}
+		}
+		free(scores);
+		free(hits);
+	}
+
+	if (best < 0)
+		return FindFormatForExt(extension);
+	return best;
+}
+
+
+// the same, but hand back the (loaded on demand) shared instance
+fileDissectPlugin *fileDissectFmts::FindPluginForExt(const wxChar *extension)
+{
+	int idx = FindFormatForExt(extension);
+	if (idx < 0)
+		return NULL;
+	return m_modules[idx]->GetInstance();
+}
+
+fileDissectPlugin *fileDissectFmts::FindPluginForFile(wxFileMap *file, const wxChar *extension)
+{
+	int idx = FindFormatForFile(file, extension);
+	if (idx < 0)
+		return NULL;
+	return m_modules[idx]->GetInstance();
 }
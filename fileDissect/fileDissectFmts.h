@@ -10,6 +10,8 @@
 
 #include "fileDissectPlugin.h"
 #include "wxPluginLoader.h"
+#include "fileDissectSniff.h"
+#include "wxFileMap.h"
 
 WX_DECLARE_PLUGINLIST(fileDissectPlugin, fileDissectFmtsBase);
 
@@ -17,11 +19,34 @@ class fileDissectFmts : public fileDissectFmtsBase
 {
 public:
 	fileDissectFmts(void);
-	void LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree);
+	~fileDissectFmts(void);
+	void LoadPlugins(wxLog *plog, fileDissectNodes *tree);
+	void Describe(fileDissectPlugin__Module *pm);
 	fileDissectPlugin *FindPluginForExt(const wxChar *extension);
+	// by content first, the extension only breaks ties (or may be NULL)
+	fileDissectPlugin *FindPluginForFile(wxFileMap *file, const wxChar *extension);
+
+	// same lookups without loading anything, -1 if nothing fits. callers
+	// that want their own plugin instances use these with GetFormat()
+	int FindFormatForExt(const wxChar *extension);
+	int FindFormatForFile(wxFileMap *file, const wxChar *extension);
+	size_t GetFormatCount(void) const { return m_nModules; }
+	fileDissectPlugin__Module *GetFormat(size_t idx) { return m_modules[idx]; }
 
 	wxLog *m_log;
-	fileDissectTreeCtrl *m_tree;
+	fileDissectNodes *m_tree;
+
+private:
+	void BuildSniffer(void);
+	void FreeSniffer(void);
+
+	fileDissectSniffer m_sniffer;
+	// sniffer owner index -> module
+	fileDissectPlugin__Module **m_modules;
+	size_t m_nModules;
+	// signatures decoded from the manifest
+	fileDissectSig *m_sigs;
+	char *m_sigdata;
 };
 
 #endif
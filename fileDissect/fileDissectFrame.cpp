@@ -35,6 +35,7 @@ fileDissectFrame::fileDissectFrame (const wxString &title)
 	m_file = NULL;
 	m_plugin = NULL;
 	m_formats = NULL;
+	m_nodes = new fileDissectNodes();
 
 	InitGUI(title);
 	InitFormats();
@@ -65,6 +66,9 @@ void fileDissectFrame::InitGUI(const wxString& WXUNUSED(title))
 	m_menubar->Append(m_mnuTools, wxT("&Tools"));
 	SetMenuBar(m_menubar);
 
+	// what the highlighted bytes belong to, if the plugin can tell
+	CreateStatusBar();
+
 	// init the panel..
 	m_panel = new wxPanel(this);
 
@@ -121,7 +125,7 @@ void fileDissectFrame::InitGUI(const wxString& WXUNUSED(title))
 void fileDissectFrame::InitFormats(void)
 {
 	m_formats = new fileDissectFmts();
-	m_formats->LoadPlugins(m_log, m_tree);
+	m_formats->LoadPlugins(m_log, m_nodes);
 	m_strWildcard = wxT("All Files (*.*)|*.*");
 
 	// build the file list based on modules
@@ -130,22 +134,24 @@ void fileDissectFrame::InitFormats(void)
 		i != m_formats->end();
 		i++)
 	{
-		fileDissectPlugin *p = (*i)->m_instance;
+		// straight from the manifest, this doesn't load anything
+		wxString exts = (*i)->GetManifest(wxT("extensions"));
+		wxString desc = (*i)->GetManifest(wxT("description"));
 
-		if (p->m_extensions)
+		if (!exts.IsEmpty())
 		{
 			if (!strExts.IsEmpty())
 				strExts += wxT(";");
-			strExts += p->m_extensions;
+			strExts += exts;
 		}
 		else
 			strExts += wxT("*.*");
 
-		if (p->m_description)
+		if (!desc.IsEmpty())
 		{
 			if (!m_strWildcard.empty())
 				m_strWildcard += wxT("|");
-			m_strWildcard += p->m_description;
+			m_strWildcard += desc;
 			m_strWildcard += wxT(" (");
 			m_strWildcard += strExts;
 			m_strWildcard += wxT(")|");
@@ -161,6 +167,7 @@ fileDissectFrame::~fileDissectFrame(void)
 		delete m_file;
 	if (m_formats)
 		delete m_formats;
+	delete m_nodes;
 }
 
 
@@ -199,7 +206,13 @@ void fileDissectFrame::OpenFile(wxString& fname)
 		// error message is logged
 		return;
 
+	// the hex view needs the whole file in view at once
 	wxFileOffset len = m_file->Length();
+	if (m_file->IsWindowed())
+	{
+		wxLogWarning(wxT("File is too large to display, only the dissection is available."));
+		len = 0;
+	}
 	m_contents->SetData(m_file->GetBaseAddress(), len);
 
 	// update the menu items that require an open file
@@ -226,7 +239,9 @@ void fileDissectFrame::CloseFile(void)
 		delete m_file;
 		m_file = NULL;
 		m_tree->DeleteAllItems();
+		m_nodes->DeleteAllItems();
 		m_contents->SetData(NULL, 0);
+		SetStatusText(wxEmptyString);
 		if (m_plugin)
 			m_plugin->CloseFile();
 
@@ -281,7 +296,7 @@ void fileDissectFrame::OnNodeExpandChildren(wxCommandEvent& WXUNUSED(event))
 {
 	wxTreeItemId id = m_tree->GetSelection();
 
-	m_tree->ExpandAllChildren(id);
+	m_tree->ExpandAllBelow(id);
 }
 
 
@@ -305,17 +320,18 @@ void fileDissectFrame::HighlightItem(wxTreeItemId &id)
 	// clear the hexview selection
 	m_contents->ClearSelection();
 
-	fdTIData *pTID = (fdTIData *)m_tree->GetItemData(id);
-	if (!pTID)
+	fileDissectSelList sel;
+	if (!m_tree->GetNodeSelection(id, sel))
 	{
+		SetStatusText(wxEmptyString);
 		m_contents->Redraw();
 		return;
 	}
 
 	// update the selection based on the node data
 	wxFileOffset start = m_file->Length();
-	for (fdTIData::iterator i = pTID->begin();
-		i != pTID->end();
+	for (fileDissectSelList::iterator i = sel.begin();
+		i != sel.end();
 		i++)
 	{
 		fileDissectSel *pSel = *i;
@@ -326,6 +342,12 @@ void fileDissectFrame::HighlightItem(wxTreeItemId &id)
 	}
 	m_contents->GotoOffset(start);
 
+	wxString desc;
+	if (m_plugin && m_plugin->DescribeOffset(start, desc))
+		SetStatusText(wxString::Format(wxT("0x%lx: %s"), (unsigned long)start, desc.c_str()));
+	else
+		SetStatusText(wxEmptyString);
+
 	// refresh hexview
 	m_contents->Redraw();
 }
@@ -350,22 +372,30 @@ void fileDissectFrame::UpdateDisplay(void)
 
 	// refresh the tree
 	m_tree->DeleteAllItems();
+	m_nodes->DeleteAllItems();
 	if (!m_file)
 		return;
 
-	// see if we have a plugin that can dissect this file extension
+	// see if we have a plugin that recognizes this file
 	wxFileName fname(m_file->m_filename);
-	m_plugin = m_formats->FindPluginForExt(fname.GetExt().c_str());
+	m_plugin = m_formats->FindPluginForFile(m_file, fname.GetExt().c_str());
 	if (!m_plugin)
 	{
-		wxLogError(wxT("No plug-ins support this file extension!"));
+		wxLogError(wxT("No plug-ins support this file type!"));
 		return;
 	}
 
 	// pass the file and some UI elements off to the plugin
 	wxLogMessage(wxT("Dissecting using the \"%s\" plug-in."), m_plugin->m_description);
 	m_plugin->m_file = m_file;
+	m_file->Advise(wxFM_ADVISE_SEQUENTIAL);
 	m_plugin->Dissect();
+
+	// from here on it's the user poking around in the hex view
+	m_file->Advise(wxFM_ADVISE_RANDOM);
+
+	// show the results
+	m_tree->LoadNodes(m_nodes);
 }
 
 
@@ -373,5 +403,5 @@ void fileDissectFrame::OnToolsRescan(wxCommandEvent& WXUNUSED(event))
 {
 	if (m_plugin)
 		m_plugin = NULL;
-	m_formats->LoadPlugins(m_log, m_tree);
+	m_formats->LoadPlugins(m_log, m_nodes);
 }
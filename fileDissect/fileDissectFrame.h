@@ -73,6 +73,7 @@ public:
 	// data items passed down to plugins
 	wxFileMap *m_file;				// mapped file
 	wxLogTextCtrl *m_log;			// logging object
+	fileDissectNodes *m_nodes;		// dissection output
 	fileDissectTreeCtrl *m_tree;		// custom tree view control
 
  private:
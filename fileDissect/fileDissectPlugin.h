@@ -12,32 +12,68 @@
 #define __fileDissectPlugin_h__
 
 #include "fileDissect.h"		// wxWidgets base
-#include "fileDissectTree.h"	// custom TreeCtrl
+#include "fileDissectNodes.h"	// dissection node model
 #include "wxFileMap.h"			// memory mapped files
 
 
-#define FD_PLUGIN_VERSION			0x0001
+#define FD_PLUGIN_VERSION			0x0002
 
 #ifdef __WXMSW__
 #define DECLARE_FD_PLUGIN(class_name) \
-	extern "C" __declspec (dllexport) fileDissectPlugin *create_instance(wxLog *plog, fileDissectTreeCtrl *tree) \
+	extern "C" __declspec (dllexport) fileDissectPlugin *create_instance(wxLog *plog, fileDissectNodes *tree) \
 	{ return (fileDissectPlugin *)new class_name(plog, tree); }
 #else
 #define DECLARE_FD_PLUGIN(class_name) \
-	extern "C" fileDissectPlugin *create_instance(wxLog *plog, fileDissectTreeCtrl *tree) \
+	extern "C" fileDissectPlugin *create_instance(wxLog *plog, fileDissectNodes *tree) \
 	{ return (fileDissectPlugin *)new class_name(plog, tree); }
 #endif
 
 
+/*
+ * magic bytes identifying a format
+ *
+ * FD_SIG_HEAD signatures must start within [m_offset, m_offset + m_range] of
+ * the beginning of the file, FD_SIG_TAIL ones must lie entirely within the
+ * last m_range bytes. a plugin's list ends with an entry whose m_bytes is NULL.
+ */
+#define FD_SIG_HEAD		0x01
+#define FD_SIG_TAIL		0x02
+
+struct fileDissectSig
+{
+	const char *m_bytes;
+	size_t m_len;
+	int m_where;
+	size_t m_offset;
+	size_t m_range;
+	int m_score;
+};
+
+/*
+ * optional timing hook. plugins call Phase() as they finish each stage of a
+ * dissection and whoever set m_phases (fd-cli --bench) gets told.
+ */
+class fileDissectPhaseSink
+{
+public:
+	virtual ~fileDissectPhaseSink(void)
+	{
+	};
+	virtual void Phase(const char *name) = 0;
+};
+
+
 class fileDissectPlugin
 {
 public:
 	fileDissectPlugin(void)
 		: m_description(0), 
 		  m_extensions(0), 
+		  m_signatures(0), 
 		  m_log(0), 
 		  m_tree(0), 
 		  m_file(0),
+		  m_phases(0),
 		  m_version(FD_PLUGIN_VERSION)
 	{
 	};
@@ -45,18 +81,33 @@ public:
 	{
 	};
 
-	// do we support this file?
-	virtual bool SupportsExtension(const wxChar *extension) = 0;
 	virtual void Dissect(void) = 0;
 	virtual void CloseFile(void) = 0;
+	// optional, what the byte at off is part of (the frame shows it in the
+	// status bar for the first byte of a highlighted node)
+	virtual bool DescribeOffset(wxFileOffset WXUNUSED(off), wxString &WXUNUSED(desc))
+	{
+		return false;
+	};
 
 	wxChar *m_description;
+	// "*.ext;*.ext" the plugin claims, read into the manifest so the
+	// module doesn't have to be loaded to match a file name
 	wxChar *m_extensions;
+	const fileDissectSig *m_signatures;
 
 	// passed from app
 	wxLog *m_log;
-	fileDissectTreeCtrl *m_tree;
+	fileDissectNodes *m_tree;
 	wxFileMap *m_file;
+	fileDissectPhaseSink *m_phases;
+
+protected:
+	void Phase(const char *name)
+	{
+		if (m_phases)
+			m_phases->Phase(name);
+	};
 
 private:
 	unsigned long m_version;
@@ -0,0 +1,257 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectSniff.cpp:
+ * content based format detection
+ */
+#include "fileDissectSniff.h"
+
+
+fileDissectSniffer::fileDissectSniffer(void)
+{
+	m_sigs = NULL;
+	m_nSigs = m_allocSigs = 0;
+	m_goto = m_out = m_dict = NULL;
+	m_nStates = m_allocStates = 0;
+	m_headMax = m_tailMax = 0;
+	m_compiled = false;
+}
+
+fileDissectSniffer::~fileDissectSniffer(void)
+{
+	Clear();
+}
+
+
+void fileDissectSniffer::Clear(void)
+{
+	if (m_sigs)
+		free(m_sigs);
+	m_sigs = NULL;
+	m_nSigs = m_allocSigs = 0;
+
+	if (m_goto)
+		free(m_goto);
+	if (m_out)
+		free(m_out);
+	if (m_dict)
+		free(m_dict);
+	m_goto = m_out = m_dict = NULL;
+	m_nStates = m_allocStates = 0;
+
+	m_headMax = m_tailMax = 0;
+	m_compiled = false;
+}
+
+
+bool fileDissectSniffer::AddSignatures(const fileDissectSig *sigs, int owner)
+{
+	if (!sigs)
+		return true;
+
+	for (const fileDissectSig *ps = sigs; ps->m_bytes; ps++)
+	{
+		if (ps->m_len < 1)
+			continue;
+
+		if (m_nSigs >= m_allocSigs)
+		{
+			wxUint32 nalloc = m_allocSigs ? m_allocSigs * 2 : 16;
+			sniffSig *pn = (sniffSig *)realloc(m_sigs, nalloc * sizeof(sniffSig));
+			if (!pn)
+			{
+				wxLogError(wxT("%s: Unable to allocate memory for signatures"),
+					wxT("fileDissectSniffer::AddSignatures()"));
+				return false;
+			}
+			m_sigs = pn;
+			m_allocSigs = nalloc;
+		}
+		m_sigs[m_nSigs].sig = ps;
+		m_sigs[m_nSigs].owner = owner;
+		m_sigs[m_nSigs].next = 0;
+		m_nSigs++;
+	}
+	m_compiled = false;
+	return true;
+}
+
+
+wxUint32 fileDissectSniffer::NewState(void)
+{
+	if (m_nStates >= m_allocStates)
+	{
+		wxUint32 nalloc = m_allocStates ? m_allocStates * 2 : 64;
+		wxUint32 *pg = (wxUint32 *)realloc(m_goto, nalloc * 256 * sizeof(wxUint32));
+		if (!pg)
+			return 0;
+		m_goto = pg;
+		wxUint32 *po = (wxUint32 *)realloc(m_out, nalloc * sizeof(wxUint32));
+		if (!po)
+			return 0;
+		m_out = po;
+		wxUint32 *pd = (wxUint32 *)realloc(m_dict, nalloc * sizeof(wxUint32));
+		if (!pd)
+			return 0;
+		m_dict = pd;
+		m_allocStates = nalloc;
+	}
+	memset(m_goto + m_nStates * 256, 0, 256 * sizeof(wxUint32));
+	m_out[m_nStates] = 0;
+	m_dict[m_nStates] = 0;
+	return m_nStates++;
+}
+
+
+/*
+ * build the automaton from scratch. while the trie is being built a zero
+ * transition means "none" (nothing ever goes back to the root). afterwards
+ * every transition is filled in, so scanning is one table lookup per byte.
+ */
+bool fileDissectSniffer::Compile(void)
+{
+	m_nStates = 0;
+	m_headMax = m_tailMax = 0;
+	m_compiled = false;
+	if (NewState() != 0)
+		goto oom;
+
+	for (wxUint32 i = 0; i < m_nSigs; i++)
+	{
+		const fileDissectSig *ps = m_sigs[i].sig;
+		const wxByte *pb = (const wxByte *)ps->m_bytes;
+		wxUint32 st = 0;
+
+		for (size_t j = 0; j < ps->m_len; j++)
+		{
+			wxUint32 nst = m_goto[st * 256 + pb[j]];
+			if (!nst)
+			{
+				nst = NewState();
+				if (!nst)
+					goto oom;
+				m_goto[st * 256 + pb[j]] = nst;
+			}
+			st = nst;
+		}
+		m_sigs[i].next = m_out[st];
+		m_out[st] = i + 1;
+
+		// remember how much data the windows need to cover
+		if (ps->m_where & FD_SIG_HEAD)
+		{
+			size_t need = ps->m_offset + ps->m_range + ps->m_len;
+			if (need > m_headMax)
+				m_headMax = need;
+		}
+		if (ps->m_where & FD_SIG_TAIL)
+		{
+			if (ps->m_range > m_tailMax)
+				m_tailMax = ps->m_range;
+		}
+	}
+
+	{
+		// breadth first, so a state's failure target is always done before it
+		wxUint32 *fail = (wxUint32 *)calloc(m_nStates, sizeof(wxUint32));
+		wxUint32 *queue = (wxUint32 *)malloc(m_nStates * sizeof(wxUint32));
+		wxUint32 qhead = 0, qtail = 0;
+		if (!fail || !queue)
+		{
+			if (fail)
+				free(fail);
+			if (queue)
+				free(queue);
+			goto oom;
+		}
+
+		for (int c = 0; c < 256; c++)
+		{
+			wxUint32 nst = m_goto[c];
+			if (nst)
+				queue[qtail++] = nst;
+		}
+		while (qhead < qtail)
+		{
+			wxUint32 st = queue[qhead++];
+			wxUint32 f = fail[st];
+
+			m_dict[st] = m_out[f] ? f : m_dict[f];
+			for (int c = 0; c < 256; c++)
+			{
+				wxUint32 nst = m_goto[st * 256 + c];
+				if (nst)
+				{
+					fail[nst] = m_goto[f * 256 + c];
+					queue[qtail++] = nst;
+				}
+				else
+					m_goto[st * 256 + c] = m_goto[f * 256 + c];
+			}
+		}
+		free(fail);
+		free(queue);
+	}
+
+	m_compiled = true;
+	return true;
+
+oom:
+	wxLogError(wxT("%s: Unable to allocate memory for the signature automaton"),
+		wxT("fileDissectSniffer::Compile()"));
+	m_nStates = 0;
+	return false;
+}
+
+
+bool fileDissectSniffer::Matches(const sniffSig *ps, wxFileOffset start, wxFileOffset filelen) const
+{
+	const fileDissectSig *sig = ps->sig;
+
+	if (sig->m_where & FD_SIG_HEAD)
+	{
+		if (start >= (wxFileOffset)sig->m_offset
+			&& start <= (wxFileOffset)(sig->m_offset + sig->m_range))
+			return true;
+	}
+	if (sig->m_where & FD_SIG_TAIL)
+	{
+		if (start >= filelen - (wxFileOffset)sig->m_range)
+			return true;
+	}
+	return false;
+}
+
+
+void fileDissectSniffer::Score(const wxByte *data, size_t len, wxFileOffset base, wxFileOffset filelen,
+	int *scores, bool *hits) const
+{
+	if (!m_compiled || !data)
+		return;
+
+	wxUint32 st = 0;
+	for (size_t i = 0; i < len; i++)
+	{
+		st = m_goto[st * 256 + data[i]];
+		if (!m_out[st] && !m_dict[st])
+			continue;
+
+		// every signature ending here, then down the dictionary links
+		for (wxUint32 ost = st; ost; ost = m_dict[ost])
+		{
+			for (wxUint32 si = m_out[ost]; si; si = m_sigs[si - 1].next)
+			{
+				const sniffSig *ps = &m_sigs[si - 1];
+				if (hits[si - 1])
+					continue;
+
+				wxFileOffset start = base + (wxFileOffset)(i + 1) - (wxFileOffset)ps->sig->m_len;
+				if (!Matches(ps, start, filelen))
+					continue;
+				hits[si - 1] = true;
+				scores[ps->owner] += ps->sig->m_score;
+			}
+		}
+	}
+}
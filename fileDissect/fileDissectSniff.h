@@ -0,0 +1,70 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectSniff.h:
+ * content based format detection
+ *
+ * every signature from every loaded plugin is compiled into one Aho-Corasick
+ * automaton. scoring a file is then a single pass over its head and tail
+ * windows, no matter how many plugins or signatures there are.
+ */
+#ifndef __fileDissectSniff_h__
+#define __fileDissectSniff_h__
+
+#include "fileDissectPlugin.h"
+
+
+class fileDissectSniffer
+{
+public:
+	fileDissectSniffer(void);
+	~fileDissectSniffer(void);
+
+	void Clear(void);
+	// signatures are not copied, they must outlive the sniffer
+	bool AddSignatures(const fileDissectSig *sigs, int owner);
+	bool Compile(void);
+
+	// how much of the start/end of a file is worth looking at
+	size_t GetHeadSize(void) const { return m_headMax; }
+	size_t GetTailSize(void) const { return m_tailMax; }
+
+	// add the scores of the signatures found in data (which sits at offset
+	// base of a filelen byte file) to scores[owner]. hits has one flag per
+	// signature so a signature seen in both windows only counts once.
+	void Score(const wxByte *data, size_t len, wxFileOffset base, wxFileOffset filelen,
+		int *scores, bool *hits) const;
+	size_t GetSignatureCount(void) const { return m_nSigs; }
+
+private:
+	struct sniffSig
+	{
+		const fileDissectSig *sig;
+		int owner;
+		// next signature ending in the same state
+		wxUint32 next;
+	};
+
+	wxUint32 NewState(void);
+	bool Matches(const sniffSig *ps, wxFileOffset start, wxFileOffset filelen) const;
+
+	sniffSig *m_sigs;
+	wxUint32 m_nSigs;
+	wxUint32 m_allocSigs;
+
+	// goto function, 256 entries per state. state 0 is the root
+	wxUint32 *m_goto;
+	// first signature ending here (index + 1) and the nearest state on the
+	// failure chain that also ends a signature
+	wxUint32 *m_out;
+	wxUint32 *m_dict;
+	wxUint32 m_nStates;
+	wxUint32 m_allocStates;
+
+	size_t m_headMax;
+	size_t m_tailMax;
+	bool m_compiled;
+};
+
+#endif
@@ -11,6 +11,7 @@
 
 BEGIN_EVENT_TABLE(fileDissectTreeCtrl, wxTreeCtrl)
   EVT_TREE_ITEM_COLLAPSING(IDC_TREE, fileDissectTreeCtrl::OnItemCollapsing)
+  EVT_TREE_ITEM_EXPANDING(IDC_TREE, fileDissectTreeCtrl::OnItemExpanding)
   EVT_TREE_ITEM_MENU(IDC_TREE, fileDissectTreeCtrl::OnItemMenu)
   EVT_TREE_ITEM_RIGHT_CLICK(IDC_TREE, fileDissectTreeCtrl::OnRightClick)
   EVT_TREE_SEL_CHANGED(IDC_TREE, fileDissectTreeCtrl::OnSelChanged)
@@ -27,10 +28,170 @@ fileDissectTreeCtrl::fileDissectTreeCtrl(wxWindow *parent, const wxWindowID id,
 			     long style)
   : wxTreeCtrl(parent, id, pos, size, style)
 {
+	m_nodes = NULL;
 	// CreateImageList(24);
 }
 
 
+// rebuild the control from a dissection
+void fileDissectTreeCtrl::LoadNodes(fileDissectNodes *nodes)
+{
+	DeleteAllItems();
+	m_nodes = nodes;
+	if (!m_nodes)
+		return;
+
+	wxTreeItemId node = m_nodes->GetRootItem();
+	if (!node.IsOk())
+		return;
+
+	// only the root and whatever the plugin expanded get created now
+	wxTreeItemId root = AddRoot(m_nodes->GetItemText(node), -1, -1, new fdTINodeRef(node));
+	if (m_nodes->HasChildren(node))
+		SetItemHasChildren(root);
+	if (m_nodes->IsExpanded(node))
+	{
+		LoadChildren(root);
+		Expand(root);
+	}
+
+	wxTreeItemId sel = FindNode(m_nodes->GetSelection());
+	if (sel.IsOk())
+		SelectItem(sel);
+}
+
+
+// create the items below an item, if we haven't already
+void fileDissectTreeCtrl::LoadChildren(const wxTreeItemId &id)
+{
+	fdTINodeRef *pRef = (fdTINodeRef *)GetItemData(id);
+	if (!m_nodes || !pRef || pRef->m_loaded)
+		return;
+	pRef->m_loaded = true;
+
+	if (pRef->m_count)
+		AddChildren(id, pRef->m_node, pRef->m_base, pRef->m_count);
+	else
+	{
+		// the plugin may not have built them yet either
+		m_nodes->LoadChildren(pRef->m_node);
+		AddChildren(id, m_nodes->GetFirstChild(pRef->m_node), 0, m_nodes->GetChildrenCount(pRef->m_node));
+	}
+}
+
+
+void fileDissectTreeCtrl::AddChildren(const wxTreeItemId &parent, wxTreeItemId node, size_t base, size_t count)
+{
+	size_t i, j;
+
+	if (count > FDT_GROUP_SIZE)
+	{
+		// too many, add groups (of groups) instead
+		size_t span = FDT_GROUP_SIZE;
+		while ((count + span - 1) / span > FDT_GROUP_SIZE)
+			span *= FDT_GROUP_SIZE;
+
+		for (i = 0; i < count && node.IsOk(); i += span)
+		{
+			size_t n = (count - i < span) ? count - i : span;
+			wxTreeItemId id = AppendItem(parent, 
+				wxString::Format(wxT("[%lu - %lu]"), (unsigned long)(base + i), (unsigned long)(base + i + n - 1)),
+				-1, -1, new fdTINodeRef(node, n, base + i));
+			SetItemHasChildren(id);
+
+			for (j = 0; j < n && node.IsOk(); j++)
+				node = m_nodes->GetNextSibling(node);
+		}
+		return;
+	}
+
+	for (i = 0; i < count && node.IsOk(); i++)
+	{
+		wxTreeItemId id = AppendItem(parent, m_nodes->GetItemText(node), -1, -1, new fdTINodeRef(node));
+		if (m_nodes->HasChildren(node))
+		{
+			SetItemHasChildren(id);
+			if (m_nodes->IsExpanded(node))
+			{
+				LoadChildren(id);
+				Expand(id);
+			}
+		}
+		node = m_nodes->GetNextSibling(node);
+	}
+}
+
+
+// find (creating as needed) the item for a node
+wxTreeItemId fileDissectTreeCtrl::FindNode(const wxTreeItemId &node)
+{
+	if (!m_nodes || !node.IsOk())
+		return wxTreeItemId();
+
+	wxTreeItemId parent = m_nodes->GetItemParent(node);
+	if (!parent.IsOk())
+		return GetRootItem();
+
+	wxTreeItemId id = FindNode(parent);
+	while (id.IsOk())
+	{
+		LoadChildren(id);
+
+		wxTreeItemIdValue cookie;
+		wxTreeItemId child;
+		for (child = GetFirstChild(id, cookie); child.IsOk(); child = GetNextChild(id, cookie))
+		{
+			fdTINodeRef *pRef = (fdTINodeRef *)GetItemData(child);
+			if (!pRef->m_count)
+			{
+				if (pRef->m_node == node)
+					return child;
+				continue;
+			}
+
+			// is it in this group?
+			wxTreeItemId cur = pRef->m_node;
+			size_t i;
+			for (i = 0; i < pRef->m_count && cur.IsOk() && cur != node; i++)
+				cur = m_nodes->GetNextSibling(cur);
+			if (cur == node && i < pRef->m_count)
+				break;
+		}
+		id = child;
+	}
+	return wxTreeItemId();
+}
+
+
+// get the selected bytes behind a control item
+bool fileDissectTreeCtrl::GetNodeSelection(const wxTreeItemId &id, fileDissectSelList &sel)
+{
+	if (!m_nodes || !id.IsOk())
+		return false;
+
+	fdTINodeRef *pRef = (fdTINodeRef *)GetItemData(id);
+	if (!pRef || pRef->m_count)
+		return false;
+	return m_nodes->GetItemSelection(pRef->m_node, sel);
+}
+
+
+// wxTreeCtrl::ExpandAllChildren doesn't know the children are created lazily
+void fileDissectTreeCtrl::ExpandAllBelow(const wxTreeItemId &id)
+{
+	if (!id.IsOk() || !ItemHasChildren(id))
+		return;
+
+	LoadChildren(id);
+	Expand(id);
+
+	wxTreeItemIdValue cookie;
+	wxTreeItemId child;
+	for (child = GetFirstChild(id, cookie); child.IsOk(); child = GetNextChild(id, cookie))
+		ExpandAllBelow(child);
+}
+
+
 #if 0
 // create the image list
 void fileDissectTreeCtrl::CreateImageList(int WXUNUSED(size))
@@ -52,6 +213,12 @@ void fileDissectTreeCtrl::OnItemCollapsing(wxTreeEvent& event)
 	}
 }
 
+// item expand event handler, create the children now
+void fileDissectTreeCtrl::OnItemExpanding(wxTreeEvent& event)
+{
+	LoadChildren(event.GetItem());
+}
+
 // context menu event
 void fileDissectTreeCtrl::OnItemMenu(wxTreeEvent& event)
 {
@@ -68,7 +235,8 @@ void fileDissectTreeCtrl::OnItemMenu(wxTreeEvent& event)
 		pm->Enable(false);
 
 	pm = mnuPopup.Append(IDM_NODE_HIGHLIGHT, wxT("&Highlight"));
-	if (!GetItemData(id))
+	fdTINodeRef *pRef = (fdTINodeRef *)GetItemData(id);
+	if (!m_nodes || !pRef || pRef->m_count || !m_nodes->HasItemSelection(pRef->m_node))
 		pm->Enable(false);
 
 	wxPoint pt = event.GetPoint();
@@ -11,6 +11,28 @@
 #include "fileDissect.h"		// wxWidgets base
 #include <wx/treectrl.h> 		// tree control
 #include "fileDissectItemData.h"
+#include "fileDissectNodes.h"		// dissection node model
+
+
+/*
+ * gui tree items just point back at the node they were built from. items
+ * are only created when their parent is expanded, and huge sibling lists
+ * are split into groups so expanding one never creates more than
+ * FDT_GROUP_SIZE items at a time.
+ */
+#define FDT_GROUP_SIZE	1000
+
+class fdTINodeRef : public wxTreeItemData
+{
+public:
+	fdTINodeRef(const wxTreeItemId &node, size_t count = 0, size_t base = 0)
+		: m_node(node), m_count(count), m_base(base), m_loaded(false) { }
+
+	wxTreeItemId m_node;	// the node, or the first node of a group
+	size_t m_count;			// nodes in a group, 0 for a single node
+	size_t m_base;			// index of the first node of a group
+	bool m_loaded;			// have the child items been created?
+};
 
 
 /* 
@@ -21,12 +43,18 @@ class fileDissectTreeCtrl : public wxTreeCtrl
  public:
    fileDissectTreeCtrl()
      {
+       m_nodes = NULL;
      }
    
    fileDissectTreeCtrl(wxWindow *parent, const wxWindowID id,
 	      const wxPoint& pos, const wxSize& size,
 	      long style);
 
+   // mirror a dissection into the control
+   void LoadNodes(fileDissectNodes *nodes);
+   bool GetNodeSelection(const wxTreeItemId &id, fileDissectSelList &sel);
+   void ExpandAllBelow(const wxTreeItemId &id);
+
 #if 0
    // images..
    void CreateImageList(int);
@@ -34,10 +62,18 @@ class fileDissectTreeCtrl : public wxTreeCtrl
 
    // event handlers
    void OnItemCollapsing(wxTreeEvent& event);
+   void OnItemExpanding(wxTreeEvent& event);
    void OnItemMenu(wxTreeEvent& event);
    void OnRightClick(wxTreeEvent& event);
    void OnSelChanged(wxTreeEvent& event);
 
+   fileDissectNodes *m_nodes;
+
+ private:
+   void LoadChildren(const wxTreeItemId &id);
+   void AddChildren(const wxTreeItemId &parent, wxTreeItemId node, size_t base, size_t count);
+   wxTreeItemId FindNode(const wxTreeItemId &node);
+
    DECLARE_DYNAMIC_CLASS(fileDissectTreeCtrl)
    DECLARE_EVENT_TABLE()
 };
@@ -7,9 +7,6 @@
  */
 #include "cbff.h"
 
-#include <wx/listimpl.cpp>
-WX_DEFINE_LIST(visitedSectors);
-
 
 // windows raises exceptions on integer overflow in calloc!
 #ifdef __WIN32__
@@ -19,16 +16,74 @@ void *my_calloc(size_t nmemb, size_t size);
 #endif
 
 
-// TODO: support Double-Indirect Fat
+static void cbffAnnotateByteOrder(wxUint64 value, wxString &dest)
+{
+	switch (value)
+	{
+		case CBFF_LITTLE_ENDIAN:
+			dest = wxT("Little Endian");
+			break;
+		default:
+			dest = wxT("Unknown");
+			break;
+	}
+}
+
+static void cbffAnnotateShift(wxUint64 value, wxString &dest)
+{
+	if (value < 32)
+		dest = wxString::Format(wxT("%lu bytes"), 1UL << value);
+}
+
+// everything in the header but the FAT sectors, which get their own node
+static const fdField cbff_header_fields[] =
+{
+	FD_FIELD(StructuredStorageHeader, _abSig, wxT("Signature"), FDF_BYTES),
+	FD_FIELD(StructuredStorageHeader, _clid, wxT("CLSID"), FDF_GUID),
+	FD_FIELD(StructuredStorageHeader, _uMinorVersion, wxT("Minor Version"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _uDllVersion, wxT("Major Version"), FDF_HEX),
+	FD_FIELD_A(StructuredStorageHeader, _uByteOrder, wxT("Byte Order"), FDF_HEX, cbffAnnotateByteOrder),
+	FD_FIELD_A(StructuredStorageHeader, _uSectorShift, wxT("Sector Shift"), FDF_HEX, cbffAnnotateShift),
+	FD_FIELD_A(StructuredStorageHeader, _uMiniSectorShift, wxT("MiniSector Shift"), FDF_HEX, cbffAnnotateShift),
+	FD_FIELD(StructuredStorageHeader, _usReserved, wxT("Reserved"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _ulReserved1, wxT("Reserved"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _ulReserved2, wxT("Reserved"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _csectFat, wxT("FAT Sector Count"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _sectDirStart, wxT("Directory Start Sector"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _signature, wxT("Transaction Signature"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _ulMiniSectorCutoff, wxT("Mini-sector Cut-Off"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _sectMiniFatStart, wxT("Mini-FAT Sector"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _csectMiniFat, wxT("Mini-FAT Count"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _sectDifStart, wxT("DIF Sector"), FDF_HEX),
+	FD_FIELD(StructuredStorageHeader, _csectDif, wxT("DIF Count"), FDF_HEX),
+	FD_FIELD_END
+};
+
+// the header signature is always at the very start
+static const fileDissectSig cbff_signatures[] =
+{
+	{ (const char *)cbff_signature, sizeof(cbff_signature), FD_SIG_HEAD, 0, 0, 100 },
+	{ (const char *)cbff_betaSig, sizeof(cbff_betaSig), FD_SIG_HEAD, 0, 0, 100 },
+	{ NULL, 0, 0, 0, 0, 0 }
+};
 
-cbff::cbff(wxLog *plog, fileDissectTreeCtrl *tree)
+cbff::cbff(wxLog *plog, fileDissectNodes *tree)
 {
 	m_description = wxT("Compound Binary File");
 	// TODO: build from stream plugins
 	m_extensions = wxT("*.xls;*.doc;*.ppt");
+	m_signatures = cbff_signatures;
 
 	InitFileData();
 
+	m_jobs = NULL;
+	m_nJobs = 0;
+	m_jobStreams = NULL;
+	m_nJobStreams = m_nextStream = 0;
+	m_jobThreads = NULL;
+	m_nJobThreads = 0;
+	m_ownerJob = -1;
+
 	m_log = plog;
 	wxLog::SetActiveTarget(m_log);
 	m_tree = tree;
@@ -44,13 +99,33 @@ void cbff::InitFileData(void)
 	m_sectorSize = m_miniSectorSize = 0;
 
 	m_FAT = 0;
+	m_FATSects = 0;
+	m_DIF = 0;
+	m_DIFOffsets = 0;
+	m_nDIFSects = 0;
 
 	m_MiniFAT = 0;
 	m_MiniFATOffsets = 0;
 
+	m_FATStamps = m_MiniFATStamps = 0;
+	m_FATGen = m_MiniFATGen = 0;
+	m_emptyChain.m_sects = 0;
+	m_emptyChain.m_count = 0;
+
 	m_DIR = 0;
 	m_DIROffsets = 0;
 	m_DirRoot = 0;
+
+	m_MiniStreamOffsets = 0;
+	m_nMiniStreamSects = 0;
+	m_MiniStreamLen = 0;
+
+	m_owners = m_miniOwners = 0;
+	m_nOwners = m_nMiniOwners = 0;
+	m_crossLinks = 0;
+	m_nCrossLinks = m_allocCrossLinks = 0;
+	m_slack = 0;
+	m_nSlack = m_allocSlack = 0;
 	m_nDirSects = m_nDirEntries = 0;
 
 	m_hdr_id.Unset();
@@ -73,25 +148,51 @@ void cbff::DestroyFileData(void)
 {
 	if (m_FAT)
 		free(m_FAT);
+	if (m_FATSects)
+		free(m_FATSects);
+	if (m_DIF)
+		free(m_DIF);
+	if (m_DIFOffsets)
+		free(m_DIFOffsets);
 	if (m_MiniFAT)
 		free(m_MiniFAT);
 	if (m_MiniFATOffsets)
 		free(m_MiniFATOffsets);
+	FreeChains(m_chains);
+	FreeChains(m_miniChains);
+	if (m_FATStamps)
+		free(m_FATStamps);
+	if (m_MiniFATStamps)
+		free(m_MiniFATStamps);
 	if (m_DIR)
 		free(m_DIR);
 	if (m_DIROffsets)
 		free(m_DIROffsets);
-
-	// deinit all the plugins
-	for (cbffStreamPlugins::iterator i = m_plugins->begin();
-		i != m_plugins->end();
+	if (m_MiniStreamOffsets)
+		free(m_MiniStreamOffsets);
+	if (m_owners)
+		free(m_owners);
+	if (m_miniOwners)
+		free(m_miniOwners);
+	if (m_crossLinks)
+		free(m_crossLinks);
+	if (m_slack)
+		free(m_slack);
+
+	// deinit all the plugins that were used
+	for (cbffStreamPlugin__List::iterator i = m_active.begin();
+		i != m_active.end();
 		i++)
 	{
 		cbffStreamPlugin *p = (*i)->m_instance;
 		p->CloseFile();
 	}
+	m_active.clear();
+	if (m_plugins)
+		m_plugins->ClearStreams();
 
 	// reset the stream list
+	m_index.Clear();
 	m_streams.clear();
 }
 
@@ -102,29 +203,30 @@ void cbff::CloseFile(void)
 }
 
 
-bool cbff::SupportsExtension(const wxChar *extension)
-{
-	// TODO: use information from sub-modules
-	if (::wxStrcmp(extension, wxT("xls")) == 0
-		|| ::wxStrcmp(extension, wxT("doc")) == 0
-		|| ::wxStrcmp(extension, wxT("ppt")) == 0)
-		return true;
-	return false;
-}
-
-
 //
 // see if any of the loaded plugins want the streams we found
 //
 void cbff::QueryStreamPlugins(void)
 {
+	// the manifest knows the stream names, sort them out in one go
+	m_plugins->Dispatch(&m_streams);
+
 	for (cbffStreamPlugins::iterator i = m_plugins->begin();
 		i != m_plugins->end();
 		i++)
 	{
-		cbffStreamPlugin *pp = (cbffStreamPlugin *)(*i)->m_instance;
-		pp->m_streams = &m_streams;
+		// only load plugins we need
+		cbffStreamList *plist = m_plugins->GetStreams(*i);
+		if (!plist)
+			continue;
+
+		cbffStreamPlugin *pp = (*i)->GetInstance();
+		if (!pp)
+			continue;
+		pp->m_streams = plist;
+		pp->m_index = &m_index;
 		pp->MarkDesiredStreams();
+		m_active.push_back(*i);
 	}
 }
 
@@ -141,11 +243,26 @@ void cbff::ReadDesiredStreamData(void)
 	{
 		cbffStream *p = (cbffStream *)(*i);
 		if (p->m_wanted 
-			// don't read it twice
-			&& !p->m_data)
-		{
+			// don't map it twice
+			&& !p->m_nExtents)
 			ReadStreamData(p);
-			// XXX: p->m_data could still be null!
+	}
+
+	// get the OS reading ahead on the runs the stream plugins will touch
+	for (cbffStreamList::iterator i = m_streams.begin();
+		i != m_streams.end();
+		i++)
+	{
+		cbffStream *p = (cbffStream *)(*i);
+		if (!p->m_wanted)
+			continue;
+		ULONG j;
+		for (j = 0; j < p->m_nExtents; j++)
+		{
+			cbffExtent *pe = p->m_extents + j;
+			// a length of 0 would mean the rest of the file
+			if (pe->m_len)
+				m_file->Advise(wxFM_ADVISE_WILLNEED, pe->m_fileOff, pe->m_len);
 		}
 	}
 }
@@ -156,11 +273,38 @@ void cbff::ReadDesiredStreamData(void)
 //
 void cbff::InvokeStreamPlugins(void)
 {
-	for (cbffStreamPlugins::iterator i = m_plugins->begin();
-		i != m_plugins->end();
+	// one job per wanted stream per plugin
+	size_t nJobs = 0;
+	for (cbffStreamPlugin__List::iterator i = m_active.begin();
+		i != m_active.end();
 		i++)
 	{
-		cbffStreamPlugin *pp = (cbffStreamPlugin *)(*i)->m_instance;
+		cbffStreamList *plist = (*i)->m_instance->m_streams;
+		for (cbffStreamList::iterator j = plist->begin();
+			j != plist->end();
+			j++)
+		{
+			cbffStream *p = (cbffStream *)(*j);
+			if (p->m_wanted)
+				nJobs++;
+		}
+	}
+
+	// a worker thread means the caller is already spreading files over the
+	// CPUs (and the log target is only ours to swap on the main thread)
+	if (nJobs > 1
+		&& wxThread::GetCPUCount() > 1
+		&& wxThread::IsMain())
+	{
+		InvokeStreamPluginsParallel(nJobs);
+		return;
+	}
+
+	for (cbffStreamPlugin__List::iterator i = m_active.begin();
+		i != m_active.end();
+		i++)
+	{
+		cbffStreamPlugin *pp = (*i)->m_instance;
 
 		// pass the file and some UI elements off to the plugin
 		wxLogMessage(wxT("Dissecting streams using the \"%s\" plug-in."), pp->m_description);
@@ -169,6 +313,212 @@ void cbff::InvokeStreamPlugins(void)
 }
 
 
+void cbff::InvokeStreamPluginsParallel(size_t nJobs)
+{
+	cbffStreamLog *plog = new cbffStreamLog(this);
+	size_t i;
+
+	wxLog::SetActiveTarget(plog);
+
+	m_jobs = new cbffStreamJob[nJobs];
+	m_jobStreams = (cbffStream **)calloc(nJobs, sizeof(cbffStream *));
+	if (!m_jobStreams)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %lu jobs"), wxT("cbff::InvokeStreamPluginsParallel()"), (unsigned long)nJobs);
+		goto done;
+	}
+
+	// set up the jobs in the order a serial run would do them
+	m_nJobs = 0;
+	m_nJobStreams = 0;
+	for (cbffStreamPlugin__List::iterator pi = m_active.begin();
+		pi != m_active.end();
+		pi++)
+	{
+		// file this with the plugin's first job so the replay reads like a serial run
+		m_ownerJob = (int)m_nJobs;
+		wxLogMessage(wxT("Dissecting streams using the \"%s\" plug-in."), (*pi)->m_instance->m_description);
+		cbffStreamList *plist = (*pi)->m_instance->m_streams;
+		for (cbffStreamList::iterator si = plist->begin();
+			si != plist->end();
+			si++)
+		{
+			cbffStream *p = (cbffStream *)(*si);
+			if (!p->m_wanted)
+				continue;
+
+			cbffStreamJob *pj = m_jobs + m_nJobs++;
+			pj->m_stream = p;
+			pj->m_list.Append(p);
+			pj->m_nodes = new fileDissectNodes(m_tree);
+			pj->m_plugin = (*pi)->m_create_instance(plog, pj->m_nodes);
+			if (pj->m_plugin)
+			{
+				pj->m_plugin->m_streams = &pj->m_list;
+				pj->m_plugin->m_index = &m_index;
+			}
+
+			for (i = 0; i < m_nJobStreams; i++)
+				if (m_jobStreams[i] == p)
+					break;
+			if (i == m_nJobStreams)
+				m_jobStreams[m_nJobStreams++] = p;
+		}
+	}
+	m_ownerJob = -1;
+
+	// start the helpers, this thread works too. they can't take a stream
+	// until the lock is dropped, so CurrentJob() always sees all of them
+	m_nextStream = 0;
+	m_nJobThreads = 0;
+	{
+		wxMutexLocker lock(m_jobLock);
+		size_t nthreads = (size_t)wxThread::GetCPUCount();
+		if (nthreads > m_nJobStreams)
+			nthreads = m_nJobStreams;
+		if (nthreads > 1
+			&& (m_jobThreads = (cbffStreamThread **)calloc(nthreads - 1, sizeof(cbffStreamThread *))))
+		{
+			for (i = 0; i < nthreads - 1; i++)
+			{
+				cbffStreamThread *pt = new cbffStreamThread(this);
+				if (pt->Create() != wxTHREAD_NO_ERROR
+					|| pt->Run() != wxTHREAD_NO_ERROR)
+				{
+					delete pt;
+					break;
+				}
+				m_jobThreads[m_nJobThreads++] = pt;
+			}
+		}
+	}
+	RunJobs(NULL);
+	for (i = 0; i < m_nJobThreads; i++)
+	{
+		m_jobThreads[i]->Wait();
+		delete m_jobThreads[i];
+	}
+	if (m_jobThreads)
+		free(m_jobThreads);
+	m_jobThreads = NULL;
+	m_nJobThreads = 0;
+
+	// everything is back on this thread now
+	wxLog::SetActiveTarget(m_log);
+	plog->Replay((int)m_nJobs);
+
+	for (i = 0; i < m_nJobs; i++)
+	{
+		cbffStreamJob *pj = m_jobs + i;
+		m_tree->Graft(pj->m_nodes);
+		if (pj->m_plugin)
+		{
+			pj->m_plugin->CloseFile();
+			delete pj->m_plugin;
+		}
+		delete pj->m_nodes;
+	}
+
+done:
+	wxLog::SetActiveTarget(m_log);
+	delete plog;
+	delete [] m_jobs;
+	m_jobs = NULL;
+	m_nJobs = 0;
+	if (m_jobStreams)
+		free(m_jobStreams);
+	m_jobStreams = NULL;
+	m_nJobStreams = 0;
+}
+
+
+bool cbff::NextStream(size_t *pidx)
+{
+	wxMutexLocker lock(m_jobLock);
+	if (m_nextStream >= m_nJobStreams)
+		return false;
+	*pidx = m_nextStream++;
+	return true;
+}
+
+
+// take a stream at a time and run every job for it, in order
+void cbff::RunJobs(cbffStreamThread *self)
+{
+	size_t k;
+	while (NextStream(&k))
+	{
+		for (size_t j = 0; j < m_nJobs; j++)
+		{
+			cbffStreamJob *pj = m_jobs + j;
+			if (pj->m_stream != m_jobStreams[k] || !pj->m_plugin)
+				continue;
+
+			if (self)
+				self->m_job = (int)j;
+			else
+				m_ownerJob = (int)j;
+			pj->m_plugin->Dissect();
+		}
+	}
+	if (self)
+		self->m_job = -1;
+	else
+		m_ownerJob = -1;
+}
+
+
+// which job the calling thread is running, -1 if none
+int cbff::CurrentJob(void)
+{
+	wxThread *pt = wxThread::This();
+	for (size_t i = 0; i < m_nJobThreads; i++)
+	{
+		if (m_jobThreads[i] == pt)
+			return m_jobThreads[i]->m_job;
+	}
+	return m_ownerJob;
+}
+
+
+wxThread::ExitCode cbffStreamThread::Entry()
+{
+	m_owner->RunJobs(this);
+	return 0;
+}
+
+
+void cbffStreamLog::DoLog(wxLogLevel level, const wxChar *msg, time_t t)
+{
+	int job = m_owner->CurrentJob();
+
+	wxMutexLocker lock(m_lock);
+	m_msgs.Add(msg);
+	m_jobs.Add(job);
+	m_levels.Add((int)level);
+	m_times.Add((long)t);
+}
+
+
+void cbffStreamLog::Replay(int nJobs)
+{
+	// anything not logged by a job goes first. nJobs itself is what came
+	// after the last job was set up
+	for (int job = -1; job <= nJobs; job++)
+	{
+		for (size_t i = 0; i < m_msgs.GetCount(); i++)
+		{
+			if (m_jobs[i] == job)
+				wxLog::OnLog((wxLogLevel)m_levels[i], m_msgs[i].c_str(), (time_t)m_times[i]);
+		}
+	}
+	m_msgs.Clear();
+	m_jobs.Clear();
+	m_levels.Clear();
+	m_times.Clear();
+}
+
+
 void cbff::Dissect(void)
 {
 	if (!m_log || !m_tree || !m_file)
@@ -182,20 +532,29 @@ void cbff::Dissect(void)
 	{
 		if (!DissectHeader())
 			break;
+		Phase("header");
 		if (!DissectFAT())
 			break;
+		Phase("fat");
 		(void) DissectMiniFAT();
+		Phase("minifat");
 		if (!DissectDirectory())
 			break;
+		Phase("directory");
+		if (BuildSectorMap())
+			DissectSectorMap();
+		Phase("sector_map");
 
 		// see if any plugins want stream data
 		QueryStreamPlugins();
 
 		// read the data (if any is wanted)
 		ReadDesiredStreamData();
+		Phase("stream_data");
 
 		// dissect streams
 		InvokeStreamPlugins();
+		Phase("stream_plugins");
 
 		// we never really intended to loop, just a programming syntax hack!
 		break;
@@ -216,87 +575,7 @@ bool cbff::DissectHeader(void)
 
 	m_hdr_id = m_tree->AppendItem(m_root_id, wxT("Header"), -1, -1,
 		new fdTIData(0, sizeof(m_sshdr)));
-	wxTreeItemId id;
-	wxString str;
-	int i;
-
-	// the header - signature
-	str = wxT("");
-	for (i = 0; i < (int)sizeof(m_sshdr._abSig); i++)
-	{
-		if (!str.IsEmpty())
-			str += wxT(" ");
-		str += wxString::Format(wxT("%02x"), m_sshdr._abSig[i]);
-	}
-	str = wxT("Signature: ") + str;
-	id = m_tree->AppendItem(m_hdr_id, str, -1, -1, FDT_NEW(_abSig, m_sshdr));
-
-	// the header - clsid
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(
-		wxT("CLSID: %08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x"), 
-		m_sshdr._clid.Data1,
-		m_sshdr._clid.Data2,
-		m_sshdr._clid.Data3,
-		m_sshdr._clid.Data4[0],
-		m_sshdr._clid.Data4[1],
-		m_sshdr._clid.Data4[2],
-		m_sshdr._clid.Data4[3],
-		m_sshdr._clid.Data4[4],
-		m_sshdr._clid.Data4[5],
-		m_sshdr._clid.Data4[6],
-		m_sshdr._clid.Data4[7]),
-		-1, -1, FDT_NEW(_clid, m_sshdr));
-
-	// the header - versions
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Minor Version: 0x%04x"), m_sshdr._uMinorVersion),
-		-1, -1, FDT_NEW(_uMinorVersion, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Major Version: 0x%04x"), m_sshdr._uDllVersion),
-		-1, -1, FDT_NEW(_uDllVersion, m_sshdr));
-
-	// the header - file config options
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Byte Order: 0x%04x (%s)"), m_sshdr._uByteOrder, 
-			HumanReadableByteOrder()),
-		-1, -1, FDT_NEW(_uByteOrder, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Sector Shift: 0x%04x (%d bytes)"), 
-		m_sshdr._uSectorShift, m_sectorSize),
-		-1, -1, FDT_NEW(_uSectorShift, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("MiniSector Shift: 0x%04x (%d bytes)"), 
-		m_sshdr._uMiniSectorShift, m_miniSectorSize),
-		-1, -1, FDT_NEW(_uMiniSectorShift, m_sshdr));
-
-	// the header - reserved stuff
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Reserved: 0x%04x"), m_sshdr._usReserved),
-		-1, -1, FDT_NEW(_usReserved, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Reserved: 0x%08x"), m_sshdr._ulReserved1),
-		-1, -1, FDT_NEW(_ulReserved1, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Reserved: 0x%08x"), m_sshdr._ulReserved2),
-		-1, -1, FDT_NEW(_ulReserved2, m_sshdr));
-
-	// the header - fat count
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("FAT Sector Count: 0x%08x"), m_sshdr._csectFat),
-		-1, -1, FDT_NEW(_csectFat, m_sshdr));
-
-	// the header - directory sector start
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Directory Start Sector: 0x%08x"), m_sshdr._sectDirStart),
-		-1, -1, FDT_NEW(_sectDirStart, m_sshdr));
-
-	// the header - more config
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Transaction Signature: 0x%08x"), m_sshdr._signature),
-		-1, -1, FDT_NEW(_signature, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Mini-sector Cut-Off: 0x%08x"), m_sshdr._ulMiniSectorCutoff),
-		-1, -1, FDT_NEW(_ulMiniSectorCutoff, m_sshdr));
-
-	// the header - minifat stuff
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Mini-FAT Sector: 0x%08x"), m_sshdr._sectMiniFatStart),
-		-1, -1, FDT_NEW(_sectMiniFatStart, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("Mini-FAT Count: 0x%08x"), m_sshdr._csectMiniFat),
-		-1, -1, FDT_NEW(_csectMiniFat, m_sshdr));
-
-	// the header - DIF stuff
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("DIF Sector: 0x%08x"), m_sshdr._sectDifStart),
-		-1, -1, FDT_NEW(_sectDifStart, m_sshdr));
-	id = m_tree->AppendItem(m_hdr_id, wxString::Format(wxT("DIF Count: 0x%08x"), m_sshdr._csectDif),
-		-1, -1, FDT_NEW(_csectDif, m_sshdr));
+	fdAppendFields(m_tree, m_hdr_id, cbff_header_fields, (const wxByte *)&m_sshdr, sizeof(m_sshdr), 0);
 	return true;
 }
 
@@ -315,36 +594,85 @@ bool cbff::DissectFAT(void)
 	wxTreeItemId fatsect_id = m_tree->AppendItem(m_hdr_id, wxT("FAT Sectors"), -1, -1,
 		FDT_NEW(_sectFat, m_sshdr));
 	for (i = 0; i < 109; i++)
-		id = m_tree->AppendItem(fatsect_id, wxString::Format(wxT("[%03d]: 0x%08x"), i, m_sshdr._sectFat[i]),
-			-1, -1, FDT_NEW(_sectFat[i], m_sshdr));
+		id = m_tree->AppendRange(fatsect_id, wxString::Format(wxT("[%03d]: 0x%08x"), i, m_sshdr._sectFat[i]),
+			FDT_RANGE(_sectFat[i], m_sshdr));
+
+	// the DIF sectors, listing the FAT sectors that don't fit in the header
+	ULONG perSect = m_sectorSize / sizeof(SECT);
+	if (m_nDIFSects > 0 && perSect >= 2)
+	{
+		wxTreeItemId dif_id = m_tree->AppendItem(m_root_id, wxT("DIF"));
+		ULONG d;
+		for (d = 0; d < m_nDIFSects; d++)
+		{
+			wxFileOffset off = m_DIFOffsets[d];
+			SECT *pdif = m_DIF + (d * perSect);
+
+			id = m_tree->AppendItem(dif_id, wxString::Format(wxT("DIF sector # %d"), d), -1, -1,
+				new fdTIData(off, m_sectorSize));
+
+			ULONG j;
+			for (j = 0; j < perSect - 1; j++)
+				m_tree->AppendRange(id, wxString::Format(wxT("[%05lu]: 0x%08x"), 109 + (d * (perSect - 1)) + j, pdif[j]),
+					off + (j * sizeof(SECT)), sizeof(SECT));
+			m_tree->AppendRange(id, wxString::Format(wxT("Next DIF Sector: 0x%08x"), pdif[perSect - 1]),
+				off + ((perSect - 1) * sizeof(SECT)), sizeof(SECT));
+		}
+	}
 
 	// add the FAT !
 	FSINDEX fidx;
 	for (fidx = 0; fidx < m_sshdr._csectFat; fidx++)
 	{
-		wxFileOffset off = sizeof(m_sshdr) + (m_sshdr._sectFat[fidx] * m_sectorSize);
-		ULONG idx = fidx * (m_sectorSize / sizeof(SECT));
+		wxFileOffset off = SectorOffset(m_FATSects[fidx]);
 
 		id = m_tree->AppendItem(fat_id, wxString::Format(wxT("FAT sector # %d"), fidx), -1, -1,
 			new fdTIData(off, m_sectorSize));
+		m_tree->SetItemExpander(id, this, ((wxUIntPtr)fidx << 1) | CBFF_LAZY_FAT);
+	}
+	return true;
+}
 
-		ULONG j;
-		for (j = 0; j < (m_sectorSize / sizeof(SECT)); j++)
-		{
-			wxFileOffset sectOff = off + (j * sizeof(SECT));
 
-			wxString hr = HumanReadableSectorType(m_FAT[idx + j]);
-			if (hr.IsEmpty())
-				m_tree->AppendItem(id, wxString::Format(wxT("[0x%08x]: 0x%08x"), 
-						idx + j, m_FAT[idx + j]),
-					-1, -1, new fdTIData(sectOff, sizeof(SECT)));
-			else
-				m_tree->AppendItem(id, wxString::Format(wxT("[0x%08x]: 0x%08x (%s)"), 
-						idx + j, m_FAT[idx + j], hr.GetData()),
-					-1, -1, new fdTIData(sectOff, sizeof(SECT)));
-		}
+// one node per entry of a FAT (or MiniFAT) sector
+void cbff::AddFATEntries(fileDissectNodes *nodes, const wxTreeItemId &id, SECT *table, ULONG idx, wxFileOffset off)
+{
+	ULONG j;
+	for (j = 0; j < (m_sectorSize / sizeof(SECT)); j++)
+	{
+		wxFileOffset sectOff = off + (j * sizeof(SECT));
+
+		wxString hr = HumanReadableSectorType(table[idx + j]);
+		if (hr.IsEmpty())
+			nodes->AppendRange(id, wxString::Format(wxT("[0x%08x]: 0x%08x"), 
+					idx + j, table[idx + j]),
+				sectOff, sizeof(SECT));
+		else
+			nodes->AppendRange(id, wxString::Format(wxT("[0x%08x]: 0x%08x (%s)"), 
+					idx + j, table[idx + j], hr.GetData()),
+				sectOff, sizeof(SECT));
+	}
+}
+
+
+void cbff::ExpandNode(fileDissectNodes *nodes, const wxTreeItemId &id, wxUIntPtr cookie)
+{
+	ULONG fidx = (ULONG)(cookie >> 1);
+	ULONG idx = fidx * (m_sectorSize / sizeof(SECT));
+
+	// the file may have been closed since the node was made
+	switch (cookie & 1)
+	{
+		case CBFF_LAZY_FAT:
+			if (m_FAT && fidx < m_sshdr._csectFat)
+				AddFATEntries(nodes, id, m_FAT, idx, SectorOffset(m_FATSects[fidx]));
+			break;
+
+		case CBFF_LAZY_MINIFAT:
+			if (m_MiniFAT && fidx < m_sshdr._csectMiniFat)
+				AddFATEntries(nodes, id, m_MiniFAT, idx, m_MiniFATOffsets[fidx]);
+			break;
 	}
-	return true;
 }
 
 
@@ -364,26 +692,10 @@ bool cbff::DissectMiniFAT(void)
 	for (fidx = 0; fidx < m_sshdr._csectMiniFat; fidx++)
 	{
 		wxFileOffset off = m_MiniFATOffsets[fidx];
-		ULONG idx = fidx * (m_sectorSize / sizeof(SECT));
 
 		id = m_tree->AppendItem(mfat_id, wxString::Format(wxT("MiniFAT sector # %d"), fidx),
 			-1, -1, new fdTIData(off, m_sectorSize));
-
-		ULONG j;
-		for (j = 0; j < (m_sectorSize / sizeof(SECT)); j++)
-		{
-			wxFileOffset sectOff = off + (j * sizeof(SECT));
-			wxString hr = HumanReadableSectorType(m_MiniFAT[idx + j]);
-
-			if (hr.IsEmpty())
-				m_tree->AppendItem(id, wxString::Format(wxT("[0x%08x]: 0x%08x"), 
-						idx + j, m_MiniFAT[idx + j]),
-					-1, -1, new fdTIData(sectOff, sizeof(SECT)));
-			else
-				m_tree->AppendItem(id, wxString::Format(wxT("[0x%08x]: 0x%08x (%s)"), 
-						idx + j, m_MiniFAT[idx + j], hr.GetData()),
-					-1, -1, new fdTIData(sectOff, sizeof(SECT)));
-		}
+		m_tree->SetItemExpander(id, this, ((wxUIntPtr)fidx << 1) | CBFF_LAZY_MINIFAT);
 	}
 	return true;
 }
@@ -408,6 +720,7 @@ bool cbff::DissectDirectory(void)
 	wxTreeItemId id;
 	wxString str;
 	int i;
+	int perSect = (int)(m_sectorSize / sizeof(DIRENT_T));
 
 	// the directory sectors
 	FSINDEX fidx;
@@ -421,15 +734,15 @@ bool cbff::DissectDirectory(void)
 		wxTreeItemId ds_id = m_tree->AppendItem(dir_id, wxString::Format(wxT("Directory Sector # %d"), fidx),
 			-1, -1, new fdTIData(off, m_sectorSize));
 
-		// add the 4 entries under it
-		for (i = 0; i < 4; i++)
+		// add its entries under it
+		for (i = 0; i < perSect; i++)
 		{
 			wxFileOffset deOff = off + (i * sizeof(DIRENT_T));
 
 			// it must have a type to add it
 			if (pdir[i]._mse != CBFF_STGTY_INVALID)
 			{
-				id = m_tree->AppendItem(ds_id, wxString::Format(wxT("Entry %d"), (fidx * 4) + i),
+				id = m_tree->AppendItem(ds_id, wxString::Format(wxT("Entry %d"), (fidx * perSect) + i),
 					-1, -1, new fdTIData(deOff, sizeof(DIRENT_T)));
 
 				// add the detail for this directory entry under its name
@@ -465,9 +778,9 @@ bool cbff::DissectDirectory(void)
 					{
 						m_dir_root_id = m_tree->AppendItem(m_root_id, wxT("Root"));
 
-						// recursively add children (the root should never have siblings)
+						// add the children (the root should never have siblings)
 						if (pdir[i]._sidChild != CBFF_SECT_FREE)
-							AddDirectoryNode(m_dir_root_id, pdir[i]._sidChild);
+							AddDirectoryNodes(m_dir_root_id, pdir[i]._sidChild);
 					}
 				}
 				else if (pdir[i]._mse == CBFF_STGTY_STORAGE)
@@ -515,68 +828,153 @@ bool cbff::DissectDirectory(void)
 }
 
 
-void cbff::AddDirectoryNode(wxTreeItemId &parent, ULONG didx)
+// what's left to visit in the directory tree
+struct cbffDirVisit
 {
-	static int max_recursion = 0;
-	DIRENT_T *pdir = NULL;
-	if (didx < m_nDirEntries)
-		pdir = m_DIR + didx;
-	if (!pdir)
-	{
-		wxLogWarning(wxT("%s: Invalid directory reference (0x%x)"), wxT("cbff::AddDirectoryNode()"), didx);
-		return;
-	}
+	wxTreeItemId m_parent;
+	ULONG m_didx;
+	int m_path;					// index of the parent storage's path, -1 for the root
+	cbffStream *m_stream;		// set on a stream waiting to be listed
+};
 
-	// XXX: TODO: better recursion avoidance fix :)
-	if (max_recursion > 0x20)
+/*
+ * walk the red-black tree of directory entries under the root, with an
+ * explicit stack so a crafted directory can't exhaust the real one. every
+ * entry is visited once at most, the order is the same as a recursive walk
+ * (entry, its children, left sibling, right sibling). a stream only goes on
+ * the list after both of its siblings' subtrees, like it always has, since
+ * that is the order the stream plugins see.
+ */
+void cbff::AddDirectoryNodes(wxTreeItemId &root, ULONG didx)
+{
+	wxByte *visited = (wxByte *)my_calloc((m_nDirEntries + 7) / 8, 1);
+	cbffDirVisit *stack = NULL;
+	ULONG nStack = 0, allocStack = 0;
+	wxArrayString paths;
+
+	if (!visited)
 	{
-		wxLogWarning(wxT("%s: Maximum recursion depth reached (0x%x)"), wxT("cbff::AddDirectoryNode()"), max_recursion);
+		wxLogError(wxT("%s: Unable to allocate memory for %lu directory entries"), wxT("cbff::AddDirectoryNodes()"), m_nDirEntries);
 		return;
 	}
-	max_recursion++;
 
-	// add the detail for this directory entry under its name
-	wxString str;
-	ConvertDirEntName(pdir, str);
-	wxTreeItemId id = m_tree->AppendItem(parent, str);
-	switch (pdir->_mse)
+#define CBFF_DIR_PUSH(parent, idx, path) \
+	do { \
+		if (nStack >= allocStack) \
+		{ \
+			ULONG nalloc = allocStack ? allocStack * 2 : 32; \
+			cbffDirVisit *pn = (cbffDirVisit *)realloc(stack, nalloc * sizeof(cbffDirVisit)); \
+			if (!pn) \
+			{ \
+				wxLogError(wxT("%s: Unable to allocate memory for directory traversal"), wxT("cbff::AddDirectoryNodes()")); \
+				goto done; \
+			} \
+			stack = pn; \
+			allocStack = nalloc; \
+		} \
+		stack[nStack].m_parent = (parent); \
+		stack[nStack].m_didx = (idx); \
+		stack[nStack].m_path = (path); \
+		stack[nStack].m_stream = NULL; \
+		nStack++; \
+	} while (0)
+
+	CBFF_DIR_PUSH(root, didx, -1);
+	while (nStack > 0)
 	{
-		case CBFF_STGTY_STORAGE:
-			if (pdir->_sidChild != CBFF_SECT_FREE)
-				AddDirectoryNode(id, pdir->_sidChild);
+		cbffDirVisit cur = stack[--nStack];
+		DIRENT_T *pdir = NULL;
 
-			m_tree->Expand(id);
+		// its siblings are done
+		if (cur.m_stream)
+		{
+			m_streams.Append(cur.m_stream);
+			if (!m_index.Add(cur.m_stream))
+				wxLogWarning(wxT("%s: Duplicate stream path \"%s\""), wxT("cbff::AddDirectoryNodes()"), cur.m_stream->m_path.c_str());
+			continue;
+		}
 
-			if (pdir->_sidLeftSib != CBFF_SECT_FREE)
-				AddDirectoryNode(parent, pdir->_sidLeftSib);
-			if (pdir->_sidRightSib != CBFF_SECT_FREE)
-				AddDirectoryNode(parent, pdir->_sidRightSib);
-			break;
+		if (cur.m_didx < m_nDirEntries)
+			pdir = m_DIR + cur.m_didx;
+		if (!pdir)
+		{
+			wxLogWarning(wxT("%s: Invalid directory reference (0x%x)"), wxT("cbff::AddDirectoryNodes()"), cur.m_didx);
+			continue;
+		}
+		if (visited[cur.m_didx / 8] & (1 << (cur.m_didx % 8)))
+		{
+			wxLogWarning(wxT("%s: Directory entry 0x%x referenced more than once, skipping"), wxT("cbff::AddDirectoryNodes()"), cur.m_didx);
+			continue;
+		}
+		visited[cur.m_didx / 8] |= (1 << (cur.m_didx % 8));
 
-		case CBFF_STGTY_STREAM:
-			if (pdir->_sidLeftSib != CBFF_SECT_FREE)
-				AddDirectoryNode(parent, pdir->_sidLeftSib);
-			if (pdir->_sidRightSib != CBFF_SECT_FREE)
-				AddDirectoryNode(parent, pdir->_sidRightSib);
+		// add the detail for this directory entry under its name
+		wxString str;
+		ConvertDirEntName(pdir, str);
+		wxTreeItemId id = m_tree->AppendItem(cur.m_parent, str);
 
-			// save stream names for plugin to select from
-			{
-				cbffStream *pnew = new cbffStream(str);
-				pnew->m_id = id;
-				pnew->m_start = pdir->_sectStart;
-				pnew->m_length = pdir->_ulSize;
-				pnew->m_phdr = &m_sshdr;
-				pnew->m_sectorSize = m_sectorSize;
-				pnew->m_miniSectorSize = m_miniSectorSize;
-				m_streams.Append(pnew);
-			}
-			break;
+		wxString path;
+		if (cur.m_path >= 0)
+		{
+			path = paths[cur.m_path];
+			path += wxT("/");
+		}
+		path += str;
 
-		default:
-			// ugh..
-			break;
+		// pushed backwards, so the child comes off the stack first
+		switch (pdir->_mse)
+		{
+			case CBFF_STGTY_STORAGE:
+				if (pdir->_sidRightSib != CBFF_SECT_FREE)
+					CBFF_DIR_PUSH(cur.m_parent, pdir->_sidRightSib, cur.m_path);
+				if (pdir->_sidLeftSib != CBFF_SECT_FREE)
+					CBFF_DIR_PUSH(cur.m_parent, pdir->_sidLeftSib, cur.m_path);
+				if (pdir->_sidChild != CBFF_SECT_FREE)
+					CBFF_DIR_PUSH(id, pdir->_sidChild, (int)paths.Add(path));
+
+				m_tree->Expand(id);
+				break;
+
+			case CBFF_STGTY_STREAM:
+				// save stream names for plugin to select from (listed once
+				// the siblings pushed after it are done)
+				CBFF_DIR_PUSH(cur.m_parent, cur.m_didx, cur.m_path);
+				{
+					cbffStream *pnew = new cbffStream(str);
+					pnew->m_path = path;
+					pnew->m_id = id;
+					pnew->m_start = pdir->_sectStart;
+					pnew->m_length = pdir->_ulSize;
+					pnew->m_phdr = &m_sshdr;
+					pnew->m_sectorSize = m_sectorSize;
+					pnew->m_miniSectorSize = m_miniSectorSize;
+					pnew->m_file = m_file;
+					stack[nStack - 1].m_stream = pnew;
+				}
+
+				if (pdir->_sidRightSib != CBFF_SECT_FREE)
+					CBFF_DIR_PUSH(cur.m_parent, pdir->_sidRightSib, cur.m_path);
+				if (pdir->_sidLeftSib != CBFF_SECT_FREE)
+					CBFF_DIR_PUSH(cur.m_parent, pdir->_sidLeftSib, cur.m_path);
+				break;
+
+			default:
+				// ugh..
+				break;
+		}
 	}
-	max_recursion--;
+#undef CBFF_DIR_PUSH
+
+done:
+	// only left over if the stack couldn't grow
+	while (nStack > 0)
+	{
+		if (stack[--nStack].m_stream)
+			delete stack[nStack].m_stream;
+	}
+	if (stack)
+		free(stack);
+	free(visited);
 }
 
 
@@ -611,11 +1009,365 @@ void cbff::AddStreamData(wxTreeItemId &WXUNUSED(id), wxString &WXUNUSED(str), DI
 }
 
 
+/*
+ * record who owns every sector in one pass over the FAT, MiniFAT and the
+ * directory. the first claim wins, anything claimed twice is a cross-link.
+ * the chains walked here are the same cached ones the stream reading uses.
+ */
+bool cbff::BuildSectorMap(void)
+{
+	wxFileOffset flen = m_file->Length();
+	const cbffChain *pc;
+	ULONG i, j;
+
+	// every whole or partial sector after the header
+	if (flen > (wxFileOffset)m_sectorSize)
+	{
+		wxFileOffset n = (flen - 1) >> m_sshdr._uSectorShift;
+		m_nOwners = (n > CBFF_SECT_MAXREG) ? CBFF_SECT_MAXREG : (ULONG)n;
+	}
+	if (m_nOwners > 0
+		&& !(m_owners = (wxUint32 *)my_calloc(m_nOwners, sizeof(wxUint32))))
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %lu sector owners"), wxT("cbff::BuildSectorMap()"), m_nOwners);
+		m_nOwners = 0;
+		return false;
+	}
+	m_nMiniOwners = (m_MiniStreamLen + m_miniSectorSize - 1) >> m_sshdr._uMiniSectorShift;
+	if (m_nMiniOwners > 0
+		&& !(m_miniOwners = (wxUint32 *)my_calloc(m_nMiniOwners, sizeof(wxUint32))))
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %lu mini sector owners"), wxT("cbff::BuildSectorMap()"), m_nMiniOwners);
+		m_nMiniOwners = 0;
+		return false;
+	}
+
+	// the file's own structures
+	for (i = 0; i < m_sshdr._csectFat; i++)
+		ClaimSector(m_FATSects[i], CBFF_OWN_FAT);
+	for (i = 0; i < m_nDIFSects; i++)
+		ClaimSector((SECT)((m_DIFOffsets[i] >> m_sshdr._uSectorShift) - 1), CBFF_OWN_DIF);
+	pc = GetChain(m_sshdr._sectDirStart);
+	for (i = 0; i < pc->m_count; i++)
+		ClaimSector(pc->m_sects[i], CBFF_OWN_DIR);
+	if (m_MiniFAT)
+	{
+		pc = GetChain(m_sshdr._sectMiniFatStart);
+		for (i = 0; i < pc->m_count; i++)
+			ClaimSector(pc->m_sects[i], CBFF_OWN_MINIFAT);
+	}
+
+	// then the streams, the root entry's being the ministream
+	for (i = 0; i < m_nDirEntries; i++)
+	{
+		DIRENT_T *pdir = m_DIR + i;
+		wxUint32 owner = CBFF_OWN_STREAM + i;
+		ULONG used, need;
+
+		if (pdir->_mse != CBFF_STGTY_STREAM
+			&& pdir->_mse != CBFF_STGTY_ROOT)
+			continue;
+		if (pdir->_ulSize < 1
+			|| pdir->_sectStart == CBFF_SECT_ENDOFCHAIN)
+			continue;
+
+		if (pdir->_mse == CBFF_STGTY_STREAM
+			&& pdir->_ulSize < m_sshdr._ulMiniSectorCutoff)
+		{
+			if (!m_MiniFAT)
+				continue;
+			pc = GetMiniChain(pdir->_sectStart);
+			for (j = 0; j < pc->m_count; j++)
+				ClaimMiniSector(pc->m_sects[j], owner);
+
+			used = pdir->_ulSize & (m_miniSectorSize - 1);
+			need = (pdir->_ulSize + m_miniSectorSize - 1) >> m_sshdr._uMiniSectorShift;
+			if (used && pc->m_count >= need)
+			{
+				wxFileOffset off = MiniSectorOffset(pc->m_sects[need - 1]);
+				if (off >= 0)
+					AddSlack(off + used, m_miniSectorSize - used, owner);
+			}
+			continue;
+		}
+
+		pc = GetChain(pdir->_sectStart);
+		for (j = 0; j < pc->m_count; j++)
+			ClaimSector(pc->m_sects[j], (pdir->_mse == CBFF_STGTY_ROOT) ? (CBFF_OWN_MINISTREAM | j) : owner);
+
+		used = pdir->_ulSize & (m_sectorSize - 1);
+		need = (pdir->_ulSize + m_sectorSize - 1) >> m_sshdr._uSectorShift;
+		if (used && pc->m_count >= need)
+			AddSlack(SectorOffset(pc->m_sects[need - 1]) + used, m_sectorSize - used, owner);
+	}
+	return true;
+}
+
+
+void cbff::ClaimSector(SECT sector, wxUint32 owner)
+{
+	// sectors past the end of the file are the chain walker's problem
+	if (sector >= m_nOwners)
+		return;
+	if (m_owners[sector] == CBFF_OWN_NONE)
+		m_owners[sector] = owner;
+	else
+		AddCrossLink(sector, false, m_owners[sector], owner);
+}
+
+
+void cbff::ClaimMiniSector(SECT sector, wxUint32 owner)
+{
+	if (sector >= m_nMiniOwners)
+		return;
+	if (m_miniOwners[sector] == CBFF_OWN_NONE)
+		m_miniOwners[sector] = owner;
+	else
+		AddCrossLink(sector, true, m_miniOwners[sector], owner);
+}
+
+
+void cbff::AddCrossLink(SECT sector, bool mini, wxUint32 first, wxUint32 second)
+{
+	if (m_nCrossLinks >= m_allocCrossLinks)
+	{
+		ULONG nalloc = m_allocCrossLinks ? m_allocCrossLinks * 2 : 16;
+		cbffCrossLink *pn = (cbffCrossLink *)realloc(m_crossLinks, nalloc * sizeof(cbffCrossLink));
+		if (!pn)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for cross-linked sectors"), wxT("cbff::AddCrossLink()"));
+			return;
+		}
+		m_crossLinks = pn;
+		m_allocCrossLinks = nalloc;
+	}
+	cbffCrossLink *pcl = m_crossLinks + m_nCrossLinks++;
+	pcl->m_sect = sector;
+	pcl->m_mini = mini;
+	pcl->m_first = first;
+	pcl->m_second = second;
+}
+
+
+// only slack with something in it is worth showing
+void cbff::AddSlack(wxFileOffset off, ULONG len, wxUint32 owner)
+{
+	const wxByte *p = m_file->View(off, len);
+	if (!p)
+		return;
+	ULONG i;
+	for (i = 0; i < len; i++)
+		if (p[i])
+			break;
+	if (i == len)
+		return;
+
+	if (m_nSlack >= m_allocSlack)
+	{
+		ULONG nalloc = m_allocSlack ? m_allocSlack * 2 : 16;
+		cbffSlack *pn = (cbffSlack *)realloc(m_slack, nalloc * sizeof(cbffSlack));
+		if (!pn)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for stream slack"), wxT("cbff::AddSlack()"));
+			return;
+		}
+		m_slack = pn;
+		m_allocSlack = nalloc;
+	}
+	cbffSlack *ps = m_slack + m_nSlack++;
+	ps->m_off = off;
+	ps->m_len = len;
+	ps->m_owner = owner;
+}
+
+
+void cbff::DissectSectorMap(void)
+{
+	wxFileOffset flen = m_file->Length();
+	ULONG nFATEntries = 0, nMiniFATEntries = 0;
+	wxTreeItemId map_id, id;
+	wxString first, second;
+	ULONG i, j, n;
+
+	if (m_FAT)
+		nFATEntries = (m_sectorSize / sizeof(SECT)) * m_sshdr._csectFat;
+	if (m_MiniFAT)
+		nMiniFATEntries = (m_sectorSize / sizeof(SECT)) * m_sshdr._csectMiniFat;
+
+	map_id = m_tree->AppendItem(m_root_id, wxT("Sector Map"));
+
+	if (m_nCrossLinks > 0)
+	{
+		wxLogWarning(wxT("%s: %lu cross-linked sectors found"), wxT("cbff::DissectSectorMap()"), m_nCrossLinks);
+		id = m_tree->AppendItem(map_id, wxString::Format(wxT("Cross-linked Sectors (%lu)"), m_nCrossLinks));
+		for (i = 0; i < m_nCrossLinks; i++)
+		{
+			cbffCrossLink *pcl = m_crossLinks + i;
+			OwnerName(pcl->m_first, first);
+			OwnerName(pcl->m_second, second);
+			if (pcl->m_mini && MiniSectorOffset(pcl->m_sect) >= 0)
+				m_tree->AppendRange(id, wxString::Format(wxT("Mini sector 0x%08x: %s and %s"),
+						pcl->m_sect, first.c_str(), second.c_str()),
+					MiniSectorOffset(pcl->m_sect), m_miniSectorSize);
+			else if (!pcl->m_mini)
+				m_tree->AppendRange(id, wxString::Format(wxT("Sector 0x%08x: %s and %s"),
+						pcl->m_sect, first.c_str(), second.c_str()),
+					SectorOffset(pcl->m_sect), m_sectorSize);
+		}
+	}
+
+	// in use according to the FAT (or not covered by it), but nobody's
+#define CBFF_ORPHAN(s)		(m_owners[s] == CBFF_OWN_NONE \
+		&& ((s) >= nFATEntries || m_FAT[s] != CBFF_SECT_FREE))
+#define CBFF_MINIORPHAN(s)	(m_miniOwners[s] == CBFF_OWN_NONE \
+		&& ((s) >= nMiniFATEntries || m_MiniFAT[s] != CBFF_SECT_FREE))
+	n = 0;
+	for (i = 0; i < m_nOwners; i++)
+		if (CBFF_ORPHAN(i))
+			n++;
+	for (i = 0; i < m_nMiniOwners; i++)
+		if (CBFF_MINIORPHAN(i))
+			n++;
+	if (n > 0)
+	{
+		id = m_tree->AppendItem(map_id, wxString::Format(wxT("Orphaned Sectors (%lu)"), n));
+		// runs of regular sectors are contiguous in the file
+		for (i = 0; i < m_nOwners; i = j)
+		{
+			for (j = i; j < m_nOwners && CBFF_ORPHAN(j); j++)
+				;
+			if (j == i)
+			{
+				j++;
+				continue;
+			}
+			wxFileOffset off = SectorOffset(i);
+			wxFileOffset len = SectorOffset(j) - off;
+			if (off + len > flen)
+				len = flen - off;
+			if (j - i == 1)
+				m_tree->AppendRange(id, wxString::Format(wxT("Sector 0x%08x"), i), off, len);
+			else
+				m_tree->AppendRange(id, wxString::Format(wxT("Sectors 0x%08x - 0x%08x"), i, j - 1), off, len);
+		}
+		for (i = 0; i < m_nMiniOwners; i++)
+		{
+			wxFileOffset off = MiniSectorOffset(i);
+			if (CBFF_MINIORPHAN(i) && off >= 0)
+				m_tree->AppendRange(id, wxString::Format(wxT("Mini sector 0x%08x"), i), off, m_miniSectorSize);
+		}
+	}
+#undef CBFF_ORPHAN
+#undef CBFF_MINIORPHAN
+
+	// whatever follows the last sector anything cares about
+	for (n = m_nOwners; n > 0; n--)
+		if (m_owners[n - 1] != CBFF_OWN_NONE
+			|| (n - 1 < nFATEntries && m_FAT[n - 1] != CBFF_SECT_FREE))
+			break;
+	if (SectorOffset(n) < flen)
+	{
+		wxFileOffset off = SectorOffset(n);
+		m_tree->AppendRange(map_id, wxString::Format(wxT("Trailing Data (%lu bytes)"), (ULONG)(flen - off)),
+			off, flen - off);
+	}
+
+	if (m_nSlack > 0)
+	{
+		id = m_tree->AppendItem(map_id, wxString::Format(wxT("Stream Slack (%lu)"), m_nSlack));
+		for (i = 0; i < m_nSlack; i++)
+		{
+			cbffSlack *ps = m_slack + i;
+			OwnerName(ps->m_owner, first);
+			m_tree->AppendRange(id, wxString::Format(wxT("%s: %lu bytes"), first.c_str(), ps->m_len),
+				ps->m_off, ps->m_len);
+		}
+	}
+}
+
+
+void cbff::OwnerName(wxUint32 owner, wxString &dest)
+{
+	if (owner & CBFF_OWN_MINISTREAM)
+	{
+		dest = wxT("Ministream");
+		return;
+	}
+	switch (owner)
+	{
+		case CBFF_OWN_NONE:
+			dest = wxT("nothing");
+			return;
+		case CBFF_OWN_FAT:
+			dest = wxT("FAT");
+			return;
+		case CBFF_OWN_DIF:
+			dest = wxT("DIF");
+			return;
+		case CBFF_OWN_DIR:
+			dest = wxT("Directory");
+			return;
+		case CBFF_OWN_MINIFAT:
+			dest = wxT("MiniFAT");
+			return;
+	}
+
+	wxString name;
+	ULONG didx = owner - CBFF_OWN_STREAM;
+	if (owner < CBFF_OWN_STREAM || didx >= m_nDirEntries)
+	{
+		dest = wxString::Format(wxT("owner 0x%x"), owner);
+		return;
+	}
+	ConvertDirEntName(m_DIR + didx, name);
+	dest = wxString::Format(wxT("\"%s\""), name.c_str());
+}
+
+
+bool cbff::DescribeOffset(wxFileOffset off, wxString &desc)
+{
+	if (!m_file || !m_sectorSize || off < 0 || off >= m_file->Length())
+		return false;
+	if (off < (wxFileOffset)m_sectorSize)
+	{
+		desc = wxT("Header");
+		return true;
+	}
+
+	SECT s = (SECT)((off >> m_sshdr._uSectorShift) - 1);
+	if (!m_owners || s >= m_nOwners)
+		return false;
+
+	wxUint32 owner = m_owners[s];
+	if (owner & CBFF_OWN_MINISTREAM)
+	{
+		// down to the mini sector
+		wxFileOffset pos = ((wxFileOffset)(owner & ~CBFF_OWN_MINISTREAM) << m_sshdr._uSectorShift)
+			+ (off & (m_sectorSize - 1));
+		SECT ms = (SECT)(pos >> m_sshdr._uMiniSectorShift);
+		if (pos < (wxFileOffset)m_MiniStreamLen
+			&& ms < m_nMiniOwners
+			&& m_miniOwners[ms] != CBFF_OWN_NONE)
+		{
+			OwnerName(m_miniOwners[ms], desc);
+			desc += wxString::Format(wxT(" (mini sector 0x%x)"), ms);
+			return true;
+		}
+	}
+	if (owner == CBFF_OWN_NONE)
+		desc = wxT("Unowned");
+	else
+		OwnerName(owner, desc);
+	desc += wxString::Format(wxT(" (sector 0x%x)"), s);
+	return true;
+}
+
+
 bool cbff::ReadStructuredStorageHeader(void)
 {
 	ssize_t nr;
 
-	nr = m_file->Read(&m_sshdr, sizeof(m_sshdr));
+	nr = m_file->ReadAt(0, &m_sshdr, sizeof(m_sshdr));
 	if (nr != sizeof(m_sshdr))
 	{
 		wxLogError(wxT("%s: Read returned %d"), wxT("ReadStructuredStorageHeader"), nr);
@@ -638,37 +1390,139 @@ bool cbff::ReadStructuredStorageHeader(void)
 	}
 
 	/* calculate various sizes */
-	m_sectorSize = 1 << m_sshdr._uSectorShift;
-	if (m_sectorSize < 1)
+	if (m_sshdr._uSectorShift != CBFF_SECTOR_SHIFT_V3
+		&& m_sshdr._uSectorShift != CBFF_SECTOR_SHIFT_V4)
 	{
-		wxLogError(wxT("%s: Invalid sector size: 0x%x"), wxT("cbff::ReadStructuredStorageHeader()"), m_sectorSize);
+		wxLogError(wxT("%s: Invalid sector shift: %u"), wxT("cbff::ReadStructuredStorageHeader()"), m_sshdr._uSectorShift);
 		return false;
 	}
+	m_sectorSize = 1 << m_sshdr._uSectorShift;
 
-	m_miniSectorSize = 1 << m_sshdr._uMiniSectorShift;
-	if (m_miniSectorSize < 1)
+	if (m_sshdr._uMiniSectorShift >= m_sshdr._uSectorShift)
 	{
-		wxLogError(wxT("%s: Invalid mini-sector size: 0x%x"), wxT("cbff::ReadStructuredStorageHeader()"), m_miniSectorSize);
+		wxLogError(wxT("%s: Invalid mini-sector shift: %u"), wxT("cbff::ReadStructuredStorageHeader()"), m_sshdr._uMiniSectorShift);
 		return false;
 	}
+	m_miniSectorSize = 1 << m_sshdr._uMiniSectorShift;
 
 	return true;
 }
 
 
-bool cbff::ReadFAT(void)
+//
+// collect the location of every FAT sector. the header holds the first 109,
+// the rest are listed in the DIF chain, whose sectors each hold one less entry
+// than fits (the last slot links to the next DIF sector).
+//
+bool cbff::ReadDIF(void)
 {
-	// TODO: support > 109 FAT sectors (large files)
+	ULONG perSect = m_sectorSize / sizeof(SECT);
+	if (perSect < 2)
+	{
+		wxLogError(wxT("%s: Sectors are too small to hold a DIF (0x%x)"), wxT("cbff::ReadDIF()"), m_sectorSize);
+		return false;
+	}
+
+	/* the file can't possibly hold more FAT or DIF sectors than it has sectors */
+	wxFileOffset nFileSects = m_file->Length() >> m_sshdr._uSectorShift;
+	if ((wxFileOffset)m_sshdr._csectFat > nFileSects)
+	{
+		wxLogWarning(wxT("%s: FAT sector count (%lu) exceeds the file size, truncating!"), wxT("cbff::ReadDIF()"),
+			m_sshdr._csectFat);
+		m_sshdr._csectFat = (FSINDEX)nFileSects;
+	}
+	if ((wxFileOffset)m_sshdr._csectDif > nFileSects)
+	{
+		wxLogWarning(wxT("%s: DIF sector count (%lu) exceeds the file size, truncating!"), wxT("cbff::ReadDIF()"),
+			m_sshdr._csectDif);
+		m_sshdr._csectDif = (FSINDEX)nFileSects;
+	}
+
+	if (!(m_FATSects = (SECT *)my_calloc(m_sshdr._csectFat ? m_sshdr._csectFat : 1, sizeof(SECT))))
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %d FAT sector indexes"), wxT("cbff::ReadDIF()"), m_sshdr._csectFat);
+		return false;
+	}
+
+	/* check all the fat entries in the header */
+	FSINDEX nFound = 0;
+	int i;
+	for (i = 0; (i < 109) && (nFound < m_sshdr._csectFat); i++)
+	{
+		if (m_sshdr._sectFat[i] != CBFF_SECT_FREE)
+			m_FATSects[nFound++] = m_sshdr._sectFat[i];
+	}
+
+	/* then follow the DIF chain for the rest */
+	if (nFound >= m_sshdr._csectFat
+		|| m_sshdr._csectDif < 1)
+		return true;
+
+	if (!(m_DIF = (SECT *)my_calloc(m_sshdr._csectDif, m_sectorSize))
+		|| !(m_DIFOffsets = (wxFileOffset *)my_calloc(m_sshdr._csectDif, sizeof(wxFileOffset))))
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %d DIF sectors"), wxT("cbff::ReadDIF()"), m_sshdr._csectDif);
+		return false;
+	}
 
-	/* make sure we don't have more than the max in-header FAT sectors */
-	if (m_sshdr._csectFat > 109)
+	// one bit per sector in the file, the FAT stamps don't exist yet
+	wxByte *seen = (wxByte *)my_calloc((size_t)(nFileSects + 7) / 8, 1);
+	if (!seen)
 	{
-		wxLogWarning(wxT("%s: Unsupported FAT sector count: %d -- Only reading the first 109."), wxT("cbff::ReadFAT()"), m_sshdr._csectFat);
-		m_sshdr._csectFat = 109;
+		wxLogError(wxT("%s: Unable to allocate memory for DIF chain walking"), wxT("cbff::ReadDIF()"));
+		return false;
 	}
 
+	SECT difsect = m_sshdr._sectDifStart;
+	while (m_nDIFSects < m_sshdr._csectDif
+		&& nFound < m_sshdr._csectFat
+		&& difsect <= CBFF_SECT_MAXREG)
+	{
+		// a DIF sector we've already read means the chain loops
+		// (past the end of the file GetSectorData fails anyway)
+		if ((wxFileOffset)difsect < nFileSects)
+		{
+			if (seen[difsect / 8] & (1 << (difsect % 8)))
+			{
+				wxLogWarning(wxT("%s: DIF chain loop detected! (0x%x) Forcing end of chain!"), wxT("cbff::ReadDIF()"), difsect);
+				break;
+			}
+			seen[difsect / 8] |= (1 << (difsect % 8));
+		}
+
+		SECT *pdif = m_DIF + (m_nDIFSects * perSect);
+		if (!GetSectorData(difsect, (BYTE *)pdif, m_sectorSize, m_DIFOffsets + m_nDIFSects))
+			break;
+		m_nDIFSects++;
+
+		ULONG j;
+		for (j = 0; j < perSect - 1 && nFound < m_sshdr._csectFat; j++)
+		{
+			if (pdif[j] != CBFF_SECT_FREE)
+				m_FATSects[nFound++] = pdif[j];
+		}
+		difsect = pdif[perSect - 1];
+	}
+	free(seen);
+
+	/* ReadFAT reports the shortfall */
+	if (nFound < m_sshdr._csectFat)
+		m_sshdr._csectFat = nFound;
+	return true;
+}
+
+
+bool cbff::ReadFAT(void)
+{
+	FSINDEX nWanted = m_sshdr._csectFat;
+	if (!ReadDIF())
+		return false;
+	if (m_sshdr._csectFat < nWanted)
+		wxLogWarning(wxT("%s: Only found %d of %d FAT sectors, truncating!"), wxT("cbff::ReadFAT()"),
+			m_sshdr._csectFat, nWanted);
+
 	/* allocate memory for the FAT */
-	if (!(m_FAT = (SECT *)my_calloc(m_sshdr._csectFat, m_sectorSize)))
+	if (!(m_FAT = (SECT *)my_calloc(m_sshdr._csectFat ? m_sshdr._csectFat : 1, m_sectorSize)))
 	{
 		wxLogError(wxT("%s: Unable to allocate memory for %d FAT sectors"), wxT("cbff::ReadFAT()"), m_sshdr._csectFat);
 		return false;
@@ -685,37 +1539,28 @@ bool cbff::ReadFAT(void)
 	}
 #endif
 
-	/* read all the blocks into the buffer */
-	FSINDEX nFS = m_sshdr._csectFat;
-	FSINDEX fIdx = 0;
-	int i;
-
-	/* check all the fat entries in the header */
-	for (i = 0; (i < 109) && (nFS > 0); i++)
+	/* read all the blocks into the buffer, one after the other */
+	FSINDEX fIdx;
+	for (fIdx = 0; fIdx < m_sshdr._csectFat; fIdx++)
 	{
-		if (m_sshdr._sectFat[i] != CBFF_SECT_FREE)
-		{
-			if (!GetSectorData(m_sshdr._sectFat[i], (BYTE *)m_FAT + (fIdx * m_sectorSize),
-					m_sectorSize, 
+		if (!GetSectorData(m_FATSects[fIdx], (BYTE *)m_FAT + (fIdx * m_sectorSize),
+				m_sectorSize, 
 #ifdef READ_FAT_OFFSETS
-					m_FATOffsets + fIdx
+				m_FATOffsets + fIdx
 #else
-					NULL
+				NULL
 #endif
-				))
-				break;
-			fIdx++;
-			nFS--;
-		}
+			))
+			break;
 	}
 
 	/* see if we got them all */
-	if (nFS > 0)
+	if (fIdx < m_sshdr._csectFat)
 	{
-		wxLogWarning(wxT("%s: Only found %d of %d FAT sectors, truncating!"), wxT("cbff::ReadFAT()"), fIdx, m_sshdr._csectFat);
+		wxLogWarning(wxT("%s: Only read %d of %d FAT sectors, truncating!"), wxT("cbff::ReadFAT()"), fIdx, m_sshdr._csectFat);
 
 		// decrease the number of fat sectors
-		m_sshdr._csectFat -= nFS;
+		m_sshdr._csectFat = fIdx;
 	}
 
 	return true;
@@ -751,20 +1596,16 @@ bool cbff::ReadMiniFAT(void)
 	/* read all the blocks into the buffer */
 	FSINDEX nFS = m_sshdr._csectMiniFat;
 	FSINDEX fIdx = 0;
-	SECT diroff = m_sshdr._sectMiniFatStart;
-	visitedSectors visited;
-	visited.Append(&diroff);
+	const cbffChain *pc = GetChain(m_sshdr._sectMiniFatStart);
 
 	/* check all the fat entries in the header */
-	while (nFS > 0 && diroff != CBFF_SECT_ENDOFCHAIN)
+	while (nFS > 0 && fIdx < pc->m_count)
 	{
-		if (!GetSectorData(diroff, (BYTE *)m_MiniFAT + (fIdx * m_sectorSize),
+		if (!GetSectorData(pc->m_sects[fIdx], (BYTE *)m_MiniFAT + (fIdx * m_sectorSize),
 				m_sectorSize, m_MiniFATOffsets + fIdx))
 			break;
-		// m_MiniFATOffsets[fIdx] = sizeof(m_sshdr) + (diroff * m_sectorSize);
 		nFS--;
 		fIdx++;
-		diroff = GetNextSectorId(diroff, visited);
 	}
 
 	/* see if we got them all */
@@ -780,15 +1621,8 @@ bool cbff::ReadMiniFAT(void)
 bool cbff::ReadDirectory(void)
 {
 	// first figure out how many directory sectors we have
-	m_nDirSects = 0;
-	SECT diroff = m_sshdr._sectDirStart;
-	visitedSectors visited;
-	visited.Append(&m_sshdr._sectDirStart);
-	while (diroff != CBFF_SECT_ENDOFCHAIN)
-	{
-		m_nDirSects++;
-		diroff = GetNextSectorId(diroff, visited);
-	}
+	const cbffChain *pc = GetChain(m_sshdr._sectDirStart);
+	m_nDirSects = pc->m_count;
 
 	// allocate memory for them
 	m_DIR = (DIRENT_T *)my_calloc(m_nDirSects, m_sectorSize);
@@ -807,16 +1641,11 @@ bool cbff::ReadDirectory(void)
 
 	// read the sectors
 	ULONG i;
-	diroff = m_sshdr._sectDirStart;
-	visited.Clear();
-	visited.Append(&m_sshdr._sectDirStart);
 	for (i = 0; i < m_nDirSects; i++)
 	{
-		if (!GetSectorData(diroff, (BYTE *)m_DIR + (i * m_sectorSize),
+		if (!GetSectorData(pc->m_sects[i], (BYTE *)m_DIR + (i * m_sectorSize),
 				m_sectorSize, m_DIROffsets + i))
 			break;
-		// m_DIROffsets[i] = sizeof(m_sshdr) + (diroff * m_sectorSize);
-		diroff = GetNextSectorId(diroff, visited);
 	}
 
 	if (i < m_nDirSects)
@@ -826,7 +1655,8 @@ bool cbff::ReadDirectory(void)
 	}
 
 	// calculate the number of directory entries
-	for (i = 0; i < m_nDirSects * 4; i++)
+	ULONG nEntries = m_nDirSects * (m_sectorSize / sizeof(DIRENT_T));
+	for (i = 0; i < nEntries; i++)
 	{
 		// note the root dir entry for later
 		if (!m_DirRoot
@@ -840,105 +1670,93 @@ bool cbff::ReadDirectory(void)
 	}
 	m_nDirEntries = i;
 
+	// a broken ministream only affects the small streams, keep going
+	IndexMiniStream();
 	return true;
 }
 
 
 //
-// read the specified length of bytes from the specified sector
-// the data is stoerd into the dest buffer
+// resolve the root entry's chain (the ministream) into file offsets once,
+// so finding any mini sector is a shift and a table lookup
 //
-bool cbff::GetSectorData(SECT sector, BYTE *dest, size_t len, wxFileOffset *poff)
+bool cbff::IndexMiniStream(void)
 {
-	wxFileOffset off;
+	if (!m_DirRoot
+		|| m_DirRoot->_sectStart == CBFF_SECT_ENDOFCHAIN)
+		return true;
+
+	const cbffChain *pc = GetChain(m_DirRoot->_sectStart);
+	if (pc->m_count < 1)
+		return false;
 
-	off = (sector << m_sshdr._uSectorShift) + sizeof(m_sshdr);
-	if (m_file->Seek(off) != off)
+	m_MiniStreamOffsets = (wxFileOffset *)my_calloc(pc->m_count, sizeof(wxFileOffset));
+	if (!m_MiniStreamOffsets)
 	{
-		wxLogError(wxT("%s: Unable to seek to offset 0x%lx"), wxT("cbff::GetSectorData()"), off);
+		wxLogError(wxT("%s: Unable to allocate memory for %lu ministream offsets"), wxT("cbff::IndexMiniStream()"), pc->m_count);
 		return false;
 	}
-	if (poff)
-		*poff = off;
+	for (ULONG i = 0; i < pc->m_count; i++)
+		m_MiniStreamOffsets[i] = SectorOffset(pc->m_sects[i]);
+	m_nMiniStreamSects = pc->m_count;
 
-	ssize_t nr;
-	ssize_t target_len = m_sectorSize;
-	if (len < m_sectorSize)
-		target_len = len;
-	nr = m_file->Read(dest, target_len);
-	if (nr != target_len)
+	// only what the chain actually covers is usable
+	m_MiniStreamLen = m_DirRoot->_ulSize;
+	if ((wxFileOffset)m_MiniStreamLen > ((wxFileOffset)m_nMiniStreamSects << m_sshdr._uSectorShift))
 	{
-		wxLogError(wxT("%s: Unable to read sector 0x%x"), wxT("cbff::GetSectorData()"), sector);
-		return false;
+		wxLogWarning(wxT("%s: Ministream size (%lu) exceeds its %lu sectors"), wxT("cbff::IndexMiniStream()"),
+			m_MiniStreamLen, m_nMiniStreamSects);
+		m_MiniStreamLen = m_nMiniStreamSects << m_sshdr._uSectorShift;
 	}
 	return true;
 }
 
 
+// find a mini sector through the ministream's sectors, -1 if it's past them
+wxFileOffset cbff::MiniSectorOffset(SECT sector)
+{
+	wxFileOffset ms_off = ((wxFileOffset)sector << m_sshdr._uMiniSectorShift);
+	wxFileOffset idx = ms_off >> m_sshdr._uSectorShift;
+	if (idx >= (wxFileOffset)m_nMiniStreamSects)
+		return -1;
+	return m_MiniStreamOffsets[idx] + (ms_off & (m_sectorSize - 1));
+}
+
+
 //
-// read the specified length of bytes from the specified mini sector
+// read the specified length of bytes from the specified sector
 // the data is stoerd into the dest buffer
 //
-bool cbff::GetMiniSectorData(SECT sector, BYTE *dest, size_t len, wxFileOffset *poff)
+bool cbff::GetSectorData(SECT sector, BYTE *dest, size_t len, wxFileOffset *poff)
 {
-	// we must have a root directory entry
-	if (!m_DirRoot)
-		return false;
-
-	// this is the byte offset into the ministream (which is a standard change of sectors)
-	ULONG ms_off = (sector << m_sshdr._uMiniSectorShift);
-
-	// skip the required number of normal sectors
-	SECT diroff = m_DirRoot->_sectStart;
-	visitedSectors visited;
-	visited.Append(&diroff);
-	while (ms_off >= m_sectorSize && diroff != CBFF_SECT_ENDOFCHAIN)
-	{
-		ms_off -= m_sectorSize;
-		// just skip to the next one
-		diroff = GetNextSectorId(diroff, visited);
-	}
-
-	if (diroff == CBFF_SECT_ENDOFCHAIN)
-	{
-		wxLogError(wxT("%s: End of chain reached skipping sectors"), wxT("cbff::GetMiniSectorData()"));
-		return false;
-	}
-
-	// seek to the location in the file that we want
 	wxFileOffset off;
-	off = (diroff << m_sshdr._uSectorShift) + sizeof(m_sshdr);
-	off += ms_off;
-	if (m_file->Seek(off) != off)
-	{
-		wxLogError(wxT("%s: Unable to seek to offset 0x%lx"), wxT("cbff::GetMiniSectorData()"), off);
-		return false;
-	}
+
+	off = SectorOffset(sector);
 	if (poff)
 		*poff = off;
 
 	ssize_t nr;
-	ssize_t target_len = m_miniSectorSize;
-	if (len < m_miniSectorSize)
+	ssize_t target_len = m_sectorSize;
+	if (len < m_sectorSize)
 		target_len = len;
-	nr = m_file->Read(dest, target_len);
+	nr = m_file->ReadAt(off, dest, target_len);
 	if (nr != target_len)
 	{
-		wxLogError(wxT("%s: Unable to read mini-sector 0x%x"), wxT("cbff::GetMiniSectorData()"), sector);
+		wxLogError(wxT("%s: Unable to read sector 0x%x"), wxT("cbff::GetSectorData()"), sector);
 		return false;
 	}
-
 	return true;
 }
 
 
 //
-// read the entire stream data
+// map out where the entire stream data lives
 //
 // m_start specifies the first sector in the stream data
 // m_length specifies the total length of the stream (in bytes)
 //
-// the stream data is stored into m_data
+// the runs of the file holding it are stored into m_extents, nothing is
+// read until a plugin asks (see cbffStream::GetData)
 //
 void cbff::ReadStreamData(cbffStream *pStream)
 {
@@ -963,57 +1781,28 @@ void cbff::ReadStreamData(cbffStream *pStream)
 void cbff::ReadStreamDataFAT(cbffStream *pStream)
 {
 	ULONG len = pStream->m_length;
+	const cbffChain *pc = GetChain(pStream->m_start);
+	wxFileOffset flen = m_file->Length();
+	ULONG ci = 0;
 
-	// allocate memory for the stream
-	if (!(pStream->m_data = (BYTE *)my_calloc(len, sizeof(BYTE))))
-	{
-		wxLogError(wxT("%s: Unable to allocate %d bytes for stream at sector 0x%x"), 
-			wxT("cbff::ReadStreamDataFAT()"), len, pStream->m_start);
-		return;
-	}
-
-	// estimate sector count
-	ULONG estSectCnt = len / m_sectorSize;
-	if (len % m_sectorSize)
-		estSectCnt++;
-
-	// allocate memory for file offsets
-	if (!(pStream->m_offsets = (wxFileOffset *)my_calloc(estSectCnt, sizeof(wxFileOffset))))
-	{
-		free(pStream->m_data);
-		pStream->m_data = NULL;
-		wxLogError(wxT("%s: Unable to allocate memory for stream file offsets"), wxT("cbff::ReadStreamDataFAT()"));
-		return;
-	}
-
-	BYTE *p = pStream->m_data;
-	SECT diroff = pStream->m_start;
-	visitedSectors visited;
-
-	visited.Append(&diroff);
-	while (len > 0 && diroff != CBFF_SECT_ENDOFCHAIN)
+	while (len > 0 && ci < pc->m_count)
 	{
 		ULONG rl = m_sectorSize;
-		// if the remaining bytes are less than a sector, only get what we need...
+		// if the remaining bytes are less than a sector, only map what we need...
 		if (len < m_sectorSize)
 			rl = len;
 
-		// where to store the offset
-		wxFileOffset *pOff = NULL;
-		if (pStream->m_sectCnt < estSectCnt)
-			pOff = pStream->m_offsets + pStream->m_sectCnt;
-		else
-			wxLogError(wxT("%s: Detected file offset array overflow!"), wxT("cbff::ReadStreamDataFAT()"));
-
-		// get data / store offset
-		if (!GetSectorData(diroff, p, rl, pOff))
+		wxFileOffset off = SectorOffset(pc->m_sects[ci]);
+		if (off + rl > flen)
+		{
+			wxLogError(wxT("%s: Unable to read sector 0x%x"), wxT("cbff::ReadStreamDataFAT()"), pc->m_sects[ci]);
+			break;
+		}
+		if (!pStream->AddExtent(off, rl))
 			break;
 
-		// successful get, increase loop values
-		pStream->m_sectCnt++;
 		len -= rl;
-		p += rl;
-		diroff = GetNextSectorId(diroff, visited);
+		ci++;
 	}
 
 	if (len > 0)
@@ -1024,57 +1813,33 @@ void cbff::ReadStreamDataFAT(cbffStream *pStream)
 void cbff::ReadStreamDataMiniFAT(cbffStream *pStream)
 {
 	ULONG len = pStream->m_length;
+	const cbffChain *pc = GetMiniChain(pStream->m_start);
+	wxFileOffset flen = m_file->Length();
+	ULONG ci = 0;
 
-	// allocate memory for the stream
-	if (!(pStream->m_data = (BYTE *)my_calloc(len, sizeof(BYTE))))
-	{
-		wxLogError(wxT("%s: Unable to allocate %d bytes for stream at sector 0x%x"), 
-			wxT("cbff::ReadStreamDataMiniFAT()"), len, pStream->m_start);
-		return;
-	}
-
-	// estimate sector count
-	ULONG estSectCnt = len / m_miniSectorSize;
-	if (len % m_miniSectorSize)
-		estSectCnt++;
-
-	// allocate memory for file offsets
-	if (!(pStream->m_offsets = (wxFileOffset *)my_calloc(estSectCnt, sizeof(wxFileOffset))))
-	{
-		free(pStream->m_data);
-		pStream->m_data = NULL;
-		wxLogError(wxT("%s: Unable to allocate memory for stream file offsets"), wxT("cbff::ReadStreamDataMiniFAT()"));
-		return;
-	}
-
-	BYTE *p = pStream->m_data;
-	SECT diroff = pStream->m_start;
-	visitedSectors visited;
-
-	visited.Append(&diroff);
-	while (len > 0 && diroff != CBFF_SECT_ENDOFCHAIN)
+	while (len > 0 && ci < pc->m_count)
 	{
 		ULONG rl = m_miniSectorSize;
-		// if the remaining bytes are less than a sector, only get what we need...
+		// if the remaining bytes are less than a sector, only map what we need...
 		if (len < m_miniSectorSize)
 			rl = len;
 
-		// where to store the offset
-		wxFileOffset *pOff = NULL;
-		if (pStream->m_sectCnt < estSectCnt)
-			pOff = pStream->m_offsets + pStream->m_sectCnt;
-		else
-			wxLogError(wxT("%s: Detected file offset array overflow!"), wxT("cbff::ReadStreamDataMiniFAT()"));
-
-		// get data / store offset
-		if (!GetMiniSectorData(diroff, p, rl, pOff))
+		wxFileOffset off = MiniSectorOffset(pc->m_sects[ci]);
+		if (off < 0)
+		{
+			wxLogError(wxT("%s: End of chain reached skipping sectors"), wxT("cbff::ReadStreamDataMiniFAT()"));
+			break;
+		}
+		if (off + rl > flen)
+		{
+			wxLogError(wxT("%s: Unable to read mini-sector 0x%x"), wxT("cbff::ReadStreamDataMiniFAT()"), pc->m_sects[ci]);
+			break;
+		}
+		if (!pStream->AddExtent(off, rl))
 			break;
 
-		// successful get, increase loop values
-		pStream->m_sectCnt++;
 		len -= rl;
-		p += rl;
-		diroff = GetNextMiniSectorId(diroff, visited);
+		ci++;
 	}
 
 	if (len > 0)
@@ -1082,59 +1847,133 @@ void cbff::ReadStreamDataMiniFAT(cbffStream *pStream)
 }
 
 
-SECT cbff::GetNextSectorId(SECT sector, visitedSectors& visited)
+/*
+ * follow a FAT or MiniFAT chain from start and remember it for the rest of
+ * the file. loops are caught with one generation stamp per table entry, so a
+ * walk costs O(chain length) and nothing has to be cleared between walks.
+ */
+cbffChain *cbff::WalkChain(SECT start, SECT *table, ULONG nEntries, wxUint32 **pstamps, wxUint32 *pgen,
+	const wxChar *what)
 {
-	if (sector > ((m_sectorSize / sizeof(SECT)) * m_sshdr._csectFat))
+	cbffChain *pc = (cbffChain *)my_calloc(1, sizeof(cbffChain));
+	if (!pc)
+		return NULL;
+
+	if (!*pstamps && nEntries > 0)
 	{
-		wxLogWarning(wxT("%s: Index outside of FAT (%lu) requested.  Forcing end of chain!"), wxT("cbff::GetNextSectorId()"), sector);
-		return CBFF_SECT_ENDOFCHAIN;
+		if (!(*pstamps = (wxUint32 *)my_calloc(nEntries, sizeof(wxUint32))))
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for %s chain walking"), wxT("cbff::WalkChain()"), what);
+			return pc;
+		}
+		*pgen = 0;
 	}
+	// new generation, only wipe the stamps when the counter wraps
+	if (++(*pgen) == 0)
+	{
+		memset(*pstamps, 0, nEntries * sizeof(wxUint32));
+		*pgen = 1;
+	}
+	wxUint32 *stamps = *pstamps;
+	wxUint32 gen = *pgen;
 
-	SECT *pElement = m_FAT + sector;
-	if (visited.Find(pElement))
+	ULONG alloc = 0;
+	SECT cur = start;
+	while (cur != CBFF_SECT_ENDOFCHAIN)
 	{
-		wxLogWarning(wxT("%s: Sector chain loop detected! (0x%x) Forcing end of chain!"), wxT("cbff::GetNextSectorId()"), sector);
-		return CBFF_SECT_ENDOFCHAIN;
+		if (cur > CBFF_SECT_MAXREG)
+		{
+			wxLogWarning(wxT("%s: Invalid %s sector id (0x%x) in chain.  Forcing end of chain!"),
+				wxT("cbff::WalkChain()"), what, cur);
+			break;
+		}
+		if (cur < nEntries && stamps)
+		{
+			if (stamps[cur] == gen)
+			{
+				wxLogWarning(wxT("%s: %s chain loop detected! (0x%x) Forcing end of chain!"),
+					wxT("cbff::WalkChain()"), what, cur);
+				break;
+			}
+			stamps[cur] = gen;
+		}
+
+		if (pc->m_count >= alloc)
+		{
+			ULONG nalloc = alloc ? alloc * 2 : 16;
+			SECT *pn = (SECT *)realloc(pc->m_sects, nalloc * sizeof(SECT));
+			if (!pn)
+			{
+				wxLogError(wxT("%s: Unable to allocate memory for %s chain"), wxT("cbff::WalkChain()"), what);
+				break;
+			}
+			pc->m_sects = pn;
+			alloc = nalloc;
+		}
+		pc->m_sects[pc->m_count++] = cur;
+
+		// sectors the table doesn't cover can be read, but go nowhere
+		if (cur >= nEntries || !stamps)
+		{
+			wxLogWarning(wxT("%s: Index outside of %s (%lu) requested.  Forcing end of chain!"),
+				wxT("cbff::WalkChain()"), what, cur);
+			break;
+		}
+		cur = table[cur];
 	}
-	visited.Append(pElement);
-	return *pElement;
+	return pc;
 }
 
 
-SECT cbff::GetNextMiniSectorId(SECT sector, visitedSectors& visited)
+const cbffChain *cbff::GetChain(SECT start)
 {
-	if (!m_MiniFAT)
-	{
-		wxLogWarning(wxT("%s: MiniFAT sector 0x%x requested, but no MiniFAT loaded!"), wxT("cbff::GetNextMiniSectorId()"), sector);
-		return CBFF_SECT_ENDOFCHAIN;
-	}
+	cbffChainMap::iterator it = m_chains.find(start);
+	if (it != m_chains.end())
+		return it->second;
 
-	if (sector > ((m_sectorSize / sizeof(SECT)) * m_sshdr._csectMiniFat))
-	{
-		wxLogWarning(wxT("%s: Index outside of MiniFAT (%lu) requested.  Forcing end of chain!"), wxT("cbff::GetNextMiniSectorId()"), sector);
-		return CBFF_SECT_ENDOFCHAIN;
-	}
+	ULONG nEntries = 0;
+	if (m_FAT)
+		nEntries = (m_sectorSize / sizeof(SECT)) * m_sshdr._csectFat;
+	cbffChain *pc = WalkChain(start, m_FAT, nEntries, &m_FATStamps, &m_FATGen, wxT("FAT"));
+	if (!pc)
+		return &m_emptyChain;
+	m_chains[start] = pc;
+	return pc;
+}
 
-	SECT *pElement = m_MiniFAT + sector;
-	if (visited.Find(pElement))
+
+const cbffChain *cbff::GetMiniChain(SECT start)
+{
+	cbffChainMap::iterator it = m_miniChains.find(start);
+	if (it != m_miniChains.end())
+		return it->second;
+
+	if (!m_MiniFAT)
 	{
-		wxLogWarning(wxT("%s: Mini-sector chain loop detected! (0x%x) Forcing end of chain!"), wxT("cbff::GetNextMiniSectorId()"), sector);
-		return CBFF_SECT_ENDOFCHAIN;
+		wxLogWarning(wxT("%s: MiniFAT sector 0x%x requested, but no MiniFAT loaded!"), wxT("cbff::GetMiniChain()"), start);
+		return &m_emptyChain;
 	}
-	visited.Append(pElement);
-	return *pElement;
+	ULONG nEntries = (m_sectorSize / sizeof(SECT)) * m_sshdr._csectMiniFat;
+	cbffChain *pc = WalkChain(start, m_MiniFAT, nEntries, &m_MiniFATStamps, &m_MiniFATGen, wxT("MiniFAT"));
+	if (!pc)
+		return &m_emptyChain;
+	m_miniChains[start] = pc;
+	return pc;
 }
 
 
-wxChar *cbff::HumanReadableByteOrder(void)
+void cbff::FreeChains(cbffChainMap &chains)
 {
-	switch (m_sshdr._uByteOrder)
+	for (cbffChainMap::iterator it = chains.begin();
+		it != chains.end();
+		it++)
 	{
-		case CBFF_LITTLE_ENDIAN:
-			return wxT("Little Endian");
-		default:
-			return wxT("Unknown");
+		cbffChain *pc = it->second;
+		if (pc->m_sects)
+			free(pc->m_sects);
+		free(pc);
 	}
+	chains.clear();
 }
 
 
@@ -8,31 +8,118 @@
 #ifndef __cbff_h_
 #define __cbff_h_
 
-// TODO: support more than 109 FAT sectors
 // #define READ_FAT_OFFSETS
 
 #include "fileDissectPlugin.h"
+#include "fileDissectRecord.h"
 #include "cbff_defs.h" // compound binary file format (OLE 2)
 
 #include "cbffStream.h"
 #include "cbffStreamPlugin.h"
 #include "cbffStreamPlugins.h"
 
-// list of sectors we visited (used to prevent loops)
-#include <wx/list.h>
-WX_DECLARE_LIST(SECT, visitedSectors);
+// a sector chain, walked once per file and cached by its start sector
+#include <wx/hashmap.h>
+struct cbffChain
+{
+	SECT *m_sects;
+	ULONG m_count;
+};
+WX_DECLARE_HASH_MAP(SECT, cbffChain *, wxIntegerHash, wxIntegerEqual, cbffChainMap);
+
+// who owns a sector, see BuildSectorMap()
+#define CBFF_OWN_NONE			0
+#define CBFF_OWN_FAT			1
+#define CBFF_OWN_DIF			2
+#define CBFF_OWN_DIR			3
+#define CBFF_OWN_MINIFAT		4
+#define CBFF_OWN_STREAM			0x10		// + directory entry index
+// set for the ministream's sectors, the rest is the position in the ministream
+#define CBFF_OWN_MINISTREAM		0x80000000
 
-class cbff : public fileDissectPlugin
+struct cbffCrossLink
+{
+	SECT m_sect;
+	bool m_mini;
+	wxUint32 m_first;			// whoever got there first
+	wxUint32 m_second;
+};
+
+// unused bytes at the end of a stream's last sector
+struct cbffSlack
+{
+	wxFileOffset m_off;
+	ULONG m_len;
+	wxUint32 m_owner;
+};
+
+// stream plugins run in parallel, one job per (plugin, stream) pair. each job
+// has its own plugin instance and builds into an overlay of the real tree, the
+// overlays are grafted in job order afterwards so the result never changes.
+#include <wx/thread.h>
+class cbff;
+
+struct cbffStreamJob
+{
+	cbffStreamJob(void) : m_plugin(0), m_stream(0), m_nodes(0) { }
+
+	cbffStreamPlugin *m_plugin;
+	cbffStream *m_stream;
+	cbffStreamList m_list;		// just m_stream, for the plugin to look at
+	fileDissectNodes *m_nodes;
+};
+
+class cbffStreamThread : public wxThread
 {
 public:
-	cbff(wxLog *plog, fileDissectTreeCtrl *tree);
+	cbffStreamThread(cbff *owner)
+		: wxThread(wxTHREAD_JOINABLE), m_owner(owner), m_job(-1) { };
+	virtual ExitCode Entry();
+
+	cbff *m_owner;
+	int m_job;					// what we're running now, for the log
+};
+
+// keeps what the jobs log until they're done, then replays it in job order
+// (the real log target may be a GUI control, which only the main thread may touch)
+class cbffStreamLog : public wxLog
+{
+public:
+	cbffStreamLog(cbff *owner) : m_owner(owner) { };
+	void Replay(int nJobs);
+
+protected:
+	virtual void DoLog(wxLogLevel level, const wxChar *msg, time_t t);
+
+private:
+	cbff *m_owner;
+	wxMutex m_lock;
+	wxArrayString m_msgs;
+	wxArrayInt m_jobs;
+	wxArrayInt m_levels;
+	wxArrayLong m_times;
+};
+
+// what a lazy node holds, the low bit of the expander cookie (the rest is the sector #)
+#define CBFF_LAZY_FAT			0
+#define CBFF_LAZY_MINIFAT		1
+
+class cbff : public fileDissectPlugin, public fileDissectExpander
+{
+public:
+	cbff(wxLog *plog, fileDissectNodes *tree);
 	~cbff (void);
 
 	// plugin member functions
-	bool SupportsExtension(const wxChar *extension);
 	void Dissect(void);
 	void CloseFile(void);
 
+	// FAT/MiniFAT sector entries are only added when their node is opened
+	void ExpandNode(fileDissectNodes *nodes, const wxTreeItemId &id, wxUIntPtr cookie);
+
+	// which structure or stream the byte at off belongs to
+	bool DescribeOffset(wxFileOffset off, wxString &desc);
+
 private:
 	void DestroyFileData(void);
 	void InitFileData(void);
@@ -46,12 +133,16 @@ private:
 	bool DissectHeader(void);
 	bool DissectFAT(void);
 	bool DissectMiniFAT(void);
+	void AddFATEntries(fileDissectNodes *nodes, const wxTreeItemId &id, SECT *table, ULONG idx, wxFileOffset off);
 	bool DissectDirectory(void);
-	void AddDirectoryNode(wxTreeItemId&, ULONG);
+	void AddDirectoryNodes(wxTreeItemId&, ULONG);
 	void AddStreamData(wxTreeItemId&, wxString&, DIRENT_T *);
+	bool BuildSectorMap(void);
+	void DissectSectorMap(void);
 
 	// private file format functionality
 	bool ReadStructuredStorageHeader(void);
+	bool ReadDIF(void);
 	bool ReadFAT(void);
 	bool ReadMiniFAT(void);
 	bool ReadDirectory(void);
@@ -63,15 +154,27 @@ private:
 	// low-level file format methods
 	//===============================
 	bool GetSectorData(SECT sector, wxByte *dest, size_t len, wxFileOffset *poff);
-	SECT GetNextSectorId(SECT sector, visitedSectors &visited);
+	// sector 0 follows the header, which always fills one whole sector
+	wxFileOffset SectorOffset(SECT sector) { return ((wxFileOffset)sector + 1) << m_sshdr._uSectorShift; }
 	// mini-sector stuff
-	bool GetMiniSectorData(SECT sector, wxByte *dest, size_t len, wxFileOffset *poff);
-	SECT GetNextMiniSectorId(SECT sector, visitedSectors &visited);
+	bool IndexMiniStream(void);
+	wxFileOffset MiniSectorOffset(SECT sector);
+	// chains (never NULL, but possibly empty)
+	const cbffChain *GetChain(SECT start);
+	const cbffChain *GetMiniChain(SECT start);
+	cbffChain *WalkChain(SECT start, SECT *table, ULONG nEntries, wxUint32 **pstamps, wxUint32 *pgen,
+		const wxChar *what);
+	void FreeChains(cbffChainMap &chains);
 	// directory stuff
 	void ConvertDirEntName(DIRENT_T *pdir, wxString &dest);
+	// sector ownership
+	void ClaimSector(SECT sector, wxUint32 owner);
+	void ClaimMiniSector(SECT sector, wxUint32 owner);
+	void AddCrossLink(SECT sector, bool mini, wxUint32 first, wxUint32 second);
+	void AddSlack(wxFileOffset off, ULONG len, wxUint32 owner);
+	void OwnerName(wxUint32 owner, wxString &dest);
 
 	// this program is for human use after all...
-	wxChar *HumanReadableByteOrder(void);
 	wxChar *HumanReadableSectorType(SECT sector);
 	wxChar *HumanReadableDirObjType(wxByte type);
 	wxChar *HumanReadableColor(wxByte flags);
@@ -83,13 +186,27 @@ private:
 	ULONG m_miniSectorSize;
 	// header
 	struct StructuredStorageHeader m_sshdr;
-	// cache of FAT/miniFAT sectors
+	// the DIF (double-indirect FAT) sectors and their contents
+	SECT *m_DIF;
+	wxFileOffset *m_DIFOffsets;
+	ULONG m_nDIFSects;
+	// where every FAT sector lives, from the header and the DIF
+	SECT *m_FATSects;
+	// cache of FAT/miniFAT sectors, the FAT is one contiguous table
 	SECT *m_FAT;
 #ifdef READ_FAT_OFFSETS
 	wxFileOffset *m_FATOffsets;
 #endif
 	SECT *m_MiniFAT;
 	wxFileOffset *m_MiniFATOffsets;
+	// walked chains, and generation stamps for loop detection while walking
+	cbffChainMap m_chains;
+	cbffChainMap m_miniChains;
+	wxUint32 *m_FATStamps;
+	wxUint32 m_FATGen;
+	wxUint32 *m_MiniFATStamps;
+	wxUint32 m_MiniFATGen;
+	cbffChain m_emptyChain;
 
 	// directory details
 	ULONG m_nDirSects;
@@ -97,15 +214,55 @@ private:
 	struct StructuredStorageDirectoryEntry *m_DIR;
 	struct StructuredStorageDirectoryEntry *m_DirRoot;
 	wxFileOffset *m_DIROffsets;
+
+	// the ministream's backing sectors, resolved when the directory is read
+	wxFileOffset *m_MiniStreamOffsets;
+	ULONG m_nMiniStreamSects;
+	ULONG m_MiniStreamLen;
+
+	// the owner of every sector in the file and every mini sector in the
+	// ministream, filled in one pass over the FAT, MiniFAT and directory
+	wxUint32 *m_owners;
+	ULONG m_nOwners;
+	wxUint32 *m_miniOwners;
+	ULONG m_nMiniOwners;
+	cbffCrossLink *m_crossLinks;
+	ULONG m_nCrossLinks;
+	ULONG m_allocCrossLinks;
+	cbffSlack *m_slack;
+	ULONG m_nSlack;
+	ULONG m_allocSlack;
 	
 	// plugin handling
 	void QueryStreamPlugins(void);
 	void ReadDesiredStreamData(void);
 	void InvokeStreamPlugins(void);
+	void InvokeStreamPluginsParallel(size_t nJobs);
 	cbffStreamPlugins *m_plugins;
+	// the ones that wanted something in this file (not owned)
+	cbffStreamPlugin__List m_active;
 
 	// for passing to plugins
 	cbffStreamList m_streams;
+	cbffStreamIndex m_index;
+
+	// parallel stream plugins
+	friend class cbffStreamThread;
+	friend class cbffStreamLog;
+	bool NextStream(size_t *pidx);
+	void RunJobs(cbffStreamThread *self);
+	int CurrentJob(void);
+
+	cbffStreamJob *m_jobs;
+	size_t m_nJobs;
+	// jobs sharing a stream run one after the other, in one thread
+	cbffStream **m_jobStreams;
+	size_t m_nJobStreams;
+	size_t m_nextStream;
+	wxMutex m_jobLock;
+	cbffStreamThread **m_jobThreads;
+	size_t m_nJobThreads;
+	int m_ownerJob;
 };
 
 #endif
@@ -17,44 +17,207 @@ cbffStream::cbffStream(wxString &name)
 
 	m_data = 0;
 	m_length = 0;
+	m_ownsData = false;
 
 	m_start = CBFF_SECT_FREE;
-	m_offsets = 0;
-	m_sectCnt = 0;
+	m_extents = 0;
+	m_nExtents = m_allocExtents = 0;
+	m_mapped = 0;
 
 	// m_id = .. 
 
 	m_phdr = 0;
 	m_miniSectorSize = 0;
 	m_sectorSize = 0;
+	m_file = 0;
 }
 
 cbffStream::~cbffStream(void)
 {
-	if (m_data)
-		free(m_data);
-	if (m_offsets)
-		free(m_offsets);
+	ReleaseData();
+	if (m_extents)
+		free(m_extents);
 }
 
+
+bool cbffStream::AddExtent(wxFileOffset fileOff, ULONG len)
+{
+	// merge with the previous run if this picks up right where it ended
+	if (m_nExtents > 0)
+	{
+		cbffExtent *pe = m_extents + m_nExtents - 1;
+		if (pe->m_fileOff + pe->m_len == fileOff)
+		{
+			pe->m_len += len;
+			m_mapped += len;
+			return true;
+		}
+	}
+
+	if (m_nExtents >= m_allocExtents)
+	{
+		ULONG nalloc = m_allocExtents ? m_allocExtents * 2 : 4;
+		cbffExtent *pn = (cbffExtent *)realloc(m_extents, nalloc * sizeof(cbffExtent));
+		if (!pn)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for stream extents"), wxT("cbffStream::AddExtent()"));
+			return false;
+		}
+		m_extents = pn;
+		m_allocExtents = nalloc;
+	}
+	cbffExtent *pe = m_extents + m_nExtents++;
+	pe->m_streamOff = m_mapped;
+	pe->m_len = len;
+	pe->m_fileOff = fileOff;
+	m_mapped += len;
+	return true;
+}
+
+
+const cbffExtent *cbffStream::FindExtent(ULONG streamOffset) const
+{
+	if (streamOffset >= m_mapped)
+		return NULL;
+
+	// binary search for the last extent starting at or before the offset
+	ULONG lo = 0, hi = m_nExtents;
+	while (hi - lo > 1)
+	{
+		ULONG mid = lo + (hi - lo) / 2;
+		if (m_extents[mid].m_streamOff <= streamOffset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return m_extents + lo;
+}
+
+
 wxFileOffset cbffStream::GetFileOffset(wxFileOffset streamOffset)
 {
 	if (streamOffset > (wxFileOffset)m_length)
 		// XXX: fix me!
 		return m_length;
 
-	ULONG mod;
-	if (m_length < m_phdr->_ulMiniSectorCutoff)
-		// its stored in the minifat
-		mod = m_miniSectorSize;
-	else
-		// its stored in the fat
-		mod = m_sectorSize;
-
-	ULONG sect = streamOffset / mod;
-	ULONG rem = streamOffset % mod;
-	if (sect >= m_sectCnt)
+	const cbffExtent *pe = FindExtent((ULONG)streamOffset);
+	if (!pe)
+	{
+		// just past the end of the data is still a sensible place
+		if (m_nExtents > 0 && streamOffset == (wxFileOffset)m_mapped)
+		{
+			pe = m_extents + m_nExtents - 1;
+			return pe->m_fileOff + pe->m_len;
+		}
 		return m_length;
+	}
+
+	return pe->m_fileOff + (streamOffset - pe->m_streamOff);
+}
+
+
+ssize_t cbffStream::ReadAt(ULONG streamOffset, void *pBuf, size_t nCount)
+{
+	if (!m_file)
+		return -1;
+
+	BYTE *p = (BYTE *)pBuf;
+	size_t done = 0;
+	const cbffExtent *pe = FindExtent(streamOffset);
+	const cbffExtent *end = m_extents + m_nExtents;
+	while (pe && pe < end && done < nCount)
+	{
+		ULONG rel = streamOffset + done - pe->m_streamOff;
+		size_t rl = pe->m_len - rel;
+		if (rl > nCount - done)
+			rl = nCount - done;
+
+		ssize_t nr = m_file->ReadAt(pe->m_fileOff + rel, p + done, rl);
+		if (nr > 0)
+			done += nr;
+		if (nr != (ssize_t)rl)
+			break;
+		pe++;
+	}
+	return done;
+}
+
+
+const BYTE *cbffStream::View(ULONG streamOffset, size_t nCount)
+{
+	if (!m_file)
+		return NULL;
+
+	// a window can be recycled by another job's View while we still look
+	// at it, so windowed files always go through ReadAt
+	if (m_file->IsWindowed())
+		return NULL;
+
+	const cbffExtent *pe = FindExtent(streamOffset);
+	if (!pe
+		|| streamOffset + nCount > pe->m_streamOff + pe->m_len)
+		return NULL;
+	return m_file->View(pe->m_fileOff + (streamOffset - pe->m_streamOff), nCount);
+}
+
+
+const BYTE *cbffStream::GetData(void)
+{
+	if (m_data || m_length < 1)
+		return m_data;
+
+	// one run in a fully mapped file needs no copy at all
+	if (m_nExtents == 1
+		&& m_mapped >= m_length
+		&& !m_file->IsWindowed())
+	{
+		m_data = View(0, m_length);
+		if (m_data)
+		{
+			m_ownsData = false;
+			return m_data;
+		}
+	}
+
+	BYTE *buf = (BYTE *)calloc(m_length, sizeof(BYTE));
+	if (!buf)
+	{
+		wxLogError(wxT("%s: Unable to allocate %d bytes for stream at sector 0x%x"),
+			wxT("cbffStream::GetData()"), m_length, m_start);
+		return NULL;
+	}
+	m_data = buf;
+	m_ownsData = true;
+
+	ssize_t nr = ReadAt(0, buf, m_length);
+	if (nr < (ssize_t)m_length)
+		wxLogWarning(wxT("%s: Returning with %lu bytes remaining"), wxT("cbffStream::GetData()"), m_length - (ULONG)(nr > 0 ? nr : 0));
+	return m_data;
+}
 
-	return m_offsets[sect] + rem;
+
+void cbffStream::ReleaseData(void)
+{
+	if (m_data && m_ownsData)
+		free((void *)m_data);
+	m_data = NULL;
+	m_ownsData = false;
+}
+
+
+cbffStream *cbffStreamIndex::Find(const wxString &path)
+{
+	cbffStreamPathMap::iterator it = m_paths.find(path);
+	if (it == m_paths.end())
+		return NULL;
+	return it->second;
+}
+
+
+bool cbffStreamIndex::Add(cbffStream *stream)
+{
+	if (m_paths.find(stream->m_path) != m_paths.end())
+		return false;
+	m_paths[stream->m_path] = stream;
+	return true;
 }
@@ -15,6 +15,15 @@
 #include "fileDissect.h"
 #include <wx/treectrl.h>
 #include "cbff_defs.h"
+#include "wxFileMap.h"
+
+// a run of stream bytes that sits contiguously in the file
+struct cbffExtent
+{
+	ULONG m_streamOff;
+	ULONG m_len;
+	wxFileOffset m_fileOff;
+};
 
 class cbffStream
 {
@@ -24,24 +33,48 @@ public:
 
 	__declspec(dllexport) wxFileOffset GetFileOffset(wxFileOffset streamOffset);
 
+	// read stream bytes straight from the file, nothing is kept around
+	__declspec(dllexport) ssize_t ReadAt(ULONG streamOffset, void *pBuf, size_t nCount);
+	// point into the mapping, NULL if the range isn't contiguous in the file
+	// (or the file is windowed, then only ReadAt is safe across threads)
+	__declspec(dllexport) const BYTE *View(ULONG streamOffset, size_t nCount);
+	// the whole stream in m_data, only copied when it's fragmented (or the
+	// file is windowed). ReleaseData gives it back once a plugin is done.
+	__declspec(dllexport) const BYTE *GetData(void);
+	__declspec(dllexport) void ReleaseData(void);
+
+	// used by cbff while following the stream's chain
+	bool AddExtent(wxFileOffset fileOff, ULONG len);
+
 	wxString m_name;
+	// the names of the storages above it too, separated by '/'
+	wxString m_path;
 
 	// for the query process
 	bool m_wanted;
 
 	// for processing
-	BYTE *m_data;
+	const BYTE *m_data;	// only set between GetData and ReleaseData
 	ULONG m_length;		// limited by file format to ULONG
 	wxTreeItemId m_id;
 
 	SECT m_start;
-	wxFileOffset *m_offsets;
-	ULONG m_sectCnt;
+	// where the stream lives, adjacent sectors are merged
+	cbffExtent *m_extents;
+	ULONG m_nExtents;
+	ULONG m_mapped;		// bytes covered by the extents
 
 	// from parent (cbff)
 	struct StructuredStorageHeader *m_phdr;
 	ULONG m_sectorSize;
 	ULONG m_miniSectorSize;
+	wxFileMap *m_file;
+
+private:
+	const cbffExtent *FindExtent(ULONG streamOffset) const;
+
+	ULONG m_allocExtents;
+	bool m_ownsData;
 };
 
 
@@ -49,4 +82,21 @@ public:
 #include <wx/list.h>
 WX_DECLARE_LIST(cbffStream, cbffStreamList);
 
+// full path (e.g. "ObjectPool/_1234/\001Ole10Native") -> stream
+#include <wx/hashmap.h>
+WX_DECLARE_STRING_HASH_MAP(cbffStream *, cbffStreamPathMap);
+
+class cbffStreamIndex
+{
+public:
+	__declspec(dllexport) cbffStream *Find(const wxString &path);
+
+	// false if the path is already taken (the first one stays)
+	bool Add(cbffStream *stream);
+	void Clear(void) { m_paths.clear(); };
+
+private:
+	cbffStreamPathMap m_paths;
+};
+
 #endif
@@ -9,18 +9,18 @@
 #define __cbffStreamPlugin_h_
 
 #include "fileDissect.h"		// wxWidgets base
-#include "fileDissectTree.h"	// custom tree
+#include "fileDissectNodes.h"	// dissection node model
 #include "cbffStream.h"
 
 #define CBF_PLUGIN_VERSION		0x0001
 
 #ifdef __WXMSW__
 #define DECLARE_CBF_PLUGIN(class_name) \
-	extern "C" __declspec (dllexport) cbffStreamPlugin *create_instance(wxLog *plog, fileDissectTreeCtrl *tree) \
+	extern "C" __declspec (dllexport) cbffStreamPlugin *create_instance(wxLog *plog, fileDissectNodes *tree) \
 	{ return (cbffStreamPlugin *)new class_name(plog, tree); }
 #else
 #define DECLARE_CBF_PLUGIN(class_name) \
-	extern "C" cbffStreamPlugin *create_instance(wxLog *plog, fileDissectTreeCtrl *tree) \
+	extern "C" cbffStreamPlugin *create_instance(wxLog *plog, fileDissectNodes *tree) \
 	{ return (cbffStreamPlugin *)new class_name(plog, tree); }
 #endif
 
@@ -30,8 +30,11 @@ class cbffStreamPlugin
 public:
 	cbffStreamPlugin(void) 
 		: m_description(0), 
+		  m_patterns(0), 
 		  m_log(0), 
 		  m_tree(0),
+		  m_streams(0),
+		  m_index(0),
 		  m_version(CBF_PLUGIN_VERSION)
 	{
 	};
@@ -46,14 +49,22 @@ public:
 	virtual void CloseFile(void)
 	{
 		m_streams = 0;
+		m_index = 0;
 	};
 
 	wxChar *m_description;
+	// NULL terminated stream name wildcards this plugin cares about, these go
+	// in the manifest so unrelated files never load the plugin at all.
+	// leaving it NULL means "ask me about every file"
+	const wxChar **m_patterns;
 
 	// passed from app -> plugin
 	wxLog *m_log;
-	fileDissectTreeCtrl *m_tree;
+	fileDissectNodes *m_tree;
+	// only the streams matching m_patterns
 	cbffStreamList *m_streams;
+	// every stream in the file, by full path
+	cbffStreamIndex *m_index;
 
 private:
 	unsigned long m_version;
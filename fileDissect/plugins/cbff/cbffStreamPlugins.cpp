@@ -16,10 +16,22 @@ cbffStreamPlugins::cbffStreamPlugins(void)
 {
 	// destroy elements on instance destruction
 	m_list.DeleteContents(true);
+
+	m_modules = NULL;
+	m_nModules = 0;
+	m_wild = NULL;
+	m_nWild = 0;
+	m_matched = NULL;
+	m_lastMatch = NULL;
+}
+
+cbffStreamPlugins::~cbffStreamPlugins(void)
+{
+	FreeDispatch();
 }
 
 // scan the module directory
-void cbffStreamPlugins::LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree)
+void cbffStreamPlugins::LoadPlugins(wxLog *plog, fileDissectNodes *tree)
 {
 	// scan for modules
 	wxString path(wxGetCwd());
@@ -30,4 +42,194 @@ void cbffStreamPlugins::LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree)
 	path += wxFileName::GetPathSeparator();
 
 	cbffStreamPluginsBase::LoadPlugins(path, plog, tree);
+	Compile();
+}
+
+
+// called for freshly loaded modules, the results end up in the manifest
+void cbffStreamPlugins::Describe(cbffStreamPlugin__Module *pm)
+{
+	cbffStreamPlugin *p = pm->m_instance;
+
+	if (!p->m_patterns)
+	{
+		pm->AddManifest(wxT("stream"), wxT("*"));
+		return;
+	}
+	for (const wxChar **pp = p->m_patterns; *pp; pp++)
+		pm->AddManifest(wxT("stream"), *pp);
+}
+
+
+// sort the manifest patterns by how cheaply they can be checked
+void cbffStreamPlugins::Compile(void)
+{
+	FreeDispatch();
+
+	m_nModules = m_list.size();
+	if (!m_nModules)
+		return;
+	m_modules = (cbffStreamPlugin__Module **)calloc(m_nModules, sizeof(cbffStreamPlugin__Module *));
+	m_lastMatch = (cbffStream **)calloc(m_nModules, sizeof(cbffStream *));
+	if (!m_modules || !m_lastMatch)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %lu modules"), wxT("cbffStreamPlugins::Compile()"), (unsigned long)m_nModules);
+		FreeDispatch();
+		return;
+	}
+	m_matched = new cbffStreamList[m_nModules];
+
+	size_t idx = 0, nPats = 0;
+	for (iterator i = begin(); i != end(); i++, idx++)
+	{
+		m_modules[idx] = *i;
+		nPats += (*i)->m_manifest.GetCount();
+	}
+	m_wild = new cbffStreamPattern[nPats];
+
+	for (idx = 0; idx < m_nModules; idx++)
+	{
+		wxArrayString &mf = m_modules[idx]->m_manifest;
+
+		for (size_t j = 0; j < mf.GetCount(); j++)
+		{
+			if (mf[j].BeforeFirst(wxT('\t')) != wxT("stream"))
+				continue;
+
+			wxString pat = mf[j].AfterFirst(wxT('\t'));
+			int nstars = pat.Freq(wxT('*'));
+			if (!nstars && pat.Find(wxT('?')) == wxNOT_FOUND)
+			{
+				cbffExactPatterns::iterator it = m_exact.find(pat);
+				if (it == m_exact.end())
+					m_exact[pat] = new wxArrayInt;
+				m_exact[pat]->Add((int)idx);
+				continue;
+			}
+
+			cbffStreamPattern *pp = m_wild + m_nWild++;
+			pp->m_module = idx;
+			if (pat == wxT("*"))
+				pp->m_kind = CBFF_PAT_ANY;
+			else if (nstars == 1 && pat.Find(wxT('?')) == wxNOT_FOUND
+				&& pat.Last() == wxT('*'))
+			{
+				pp->m_kind = CBFF_PAT_PREFIX;
+				pp->m_text = pat.Left(pat.Len() - 1);
+			}
+			else if (nstars == 1 && pat.Find(wxT('?')) == wxNOT_FOUND
+				&& pat[0] == wxT('*'))
+			{
+				pp->m_kind = CBFF_PAT_SUFFIX;
+				pp->m_text = pat.Mid(1);
+			}
+			else
+			{
+				pp->m_kind = CBFF_PAT_WILD;
+				pp->m_text = pat;
+			}
+		}
+	}
+}
+
+
+void cbffStreamPlugins::FreeDispatch(void)
+{
+	for (cbffExactPatterns::iterator it = m_exact.begin();
+		it != m_exact.end();
+		it++)
+		delete it->second;
+	m_exact.clear();
+	if (m_wild)
+		delete [] m_wild;
+	m_wild = NULL;
+	m_nWild = 0;
+
+	if (m_matched)
+		delete [] m_matched;
+	m_matched = NULL;
+	if (m_lastMatch)
+		free(m_lastMatch);
+	m_lastMatch = NULL;
+	if (m_modules)
+		free(m_modules);
+	m_modules = NULL;
+	m_nModules = 0;
+}
+
+
+// one pass over the streams, the modules' lists keep the file's stream order
+void cbffStreamPlugins::Dispatch(cbffStreamList *streams)
+{
+	ClearStreams();
+
+	for (cbffStreamList::iterator i = streams->begin();
+		i != streams->end();
+		i++)
+	{
+		cbffStream *p = (cbffStream *)(*i);
+
+		cbffExactPatterns::iterator it = m_exact.find(p->m_name);
+		if (it != m_exact.end())
+		{
+			wxArrayInt *pm = it->second;
+			for (size_t j = 0; j < pm->GetCount(); j++)
+				Deliver((size_t)pm->Item(j), p);
+		}
+
+		for (size_t j = 0; j < m_nWild; j++)
+		{
+			cbffStreamPattern *pp = m_wild + j;
+			bool match = false;
+
+			switch (pp->m_kind)
+			{
+				case CBFF_PAT_ANY:
+					match = true;
+					break;
+				case CBFF_PAT_PREFIX:
+					match = p->m_name.StartsWith(pp->m_text.c_str());
+					break;
+				case CBFF_PAT_SUFFIX:
+					match = p->m_name.EndsWith(pp->m_text.c_str());
+					break;
+				default:
+					match = p->m_name.Matches(pp->m_text.c_str());
+					break;
+			}
+			if (match)
+				Deliver(pp->m_module, p);
+		}
+	}
+}
+
+
+void cbffStreamPlugins::Deliver(size_t module, cbffStream *stream)
+{
+	// several patterns of one module may match the same stream
+	if (m_lastMatch[module] == stream)
+		return;
+	m_lastMatch[module] = stream;
+	m_matched[module].Append(stream);
+}
+
+
+cbffStreamList *cbffStreamPlugins::GetStreams(cbffStreamPlugin__Module *pm)
+{
+	for (size_t i = 0; i < m_nModules; i++)
+	{
+		if (m_modules[i] == pm)
+			return m_matched[i].IsEmpty() ? NULL : &m_matched[i];
+	}
+	return NULL;
+}
+
+
+void cbffStreamPlugins::ClearStreams(void)
+{
+	for (size_t i = 0; i < m_nModules; i++)
+	{
+		m_matched[i].Clear();
+		m_lastMatch[i] = NULL;
+	}
 }
@@ -14,11 +14,54 @@
 // list of stream plugins
 WX_DECLARE_PLUGINLIST(cbffStreamPlugin, cbffStreamPluginsBase);
 
+// how a manifest stream pattern gets matched
+#define CBFF_PAT_ANY			0	// "*"
+#define CBFF_PAT_PREFIX			1	// "abc*"
+#define CBFF_PAT_SUFFIX			2	// "*abc"
+#define CBFF_PAT_WILD			3	// anything else with wildcards
+
+struct cbffStreamPattern
+{
+	int m_kind;
+	wxString m_text;			// without the '*' for prefix/suffix
+	size_t m_module;
+};
+// exact stream name -> modules wanting it
+WX_DECLARE_STRING_HASH_MAP(wxArrayInt *, cbffExactPatterns);
+
+/*
+ * the manifest patterns of all the modules are compiled once, after loading.
+ * a file's streams are then sorted out to the modules in a single pass and
+ * each plugin only ever sees the streams it asked for.
+ */
 class cbffStreamPlugins : public cbffStreamPluginsBase
 {
 public:
 	cbffStreamPlugins(void);
-	void LoadPlugins(wxLog *plog, fileDissectTreeCtrl *tree);
+	~cbffStreamPlugins(void);
+	void LoadPlugins(wxLog *plog, fileDissectNodes *tree);
+	void Describe(cbffStreamPlugin__Module *pm);
+
+	// hand out the streams to the modules whose patterns match them
+	void Dispatch(cbffStreamList *streams);
+	// the streams a module got from the last Dispatch() (NULL if none)
+	cbffStreamList *GetStreams(cbffStreamPlugin__Module *pm);
+	void ClearStreams(void);
+
+private:
+	void Compile(void);
+	void FreeDispatch(void);
+	void Deliver(size_t module, cbffStream *stream);
+
+	cbffStreamPlugin__Module **m_modules;
+	size_t m_nModules;
+	cbffExactPatterns m_exact;
+	cbffStreamPattern *m_wild;
+	size_t m_nWild;
+
+	// per module
+	cbffStreamList *m_matched;
+	cbffStream **m_lastMatch;
 };
 
 
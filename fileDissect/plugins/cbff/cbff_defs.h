@@ -61,6 +61,7 @@ typedef struct tagFILETIME {
 typedef CLSID GUID;
 typedef FILETIME TIME_T;
 
+#define CBFF_SECT_MAXREG		0xFFFFFFFA
 #define CBFF_SECT_FREE			0xFFFFFFFF
 #define CBFF_SECT_ENDOFCHAIN	0xFFFFFFFE
 #define CBFF_SECT_FAT			0xFFFFFFFD
@@ -85,6 +86,10 @@ struct StructuredStorageHeader
 
 	USHORT _uSectorShift; // [01EH,02] size of sectors in power-of-two (typically 9, indicating 512-byte sectors) 
 	USHORT _uMiniSectorShift; // [020H,02] size of mini-sectors in power-of-two (typically 6, indicating 64-byte mini-sectors) 
+// the only sizes there are (version 3 and 4 files), anything smaller
+// wouldn't leave the header alone in sector 0
+#define CBFF_SECTOR_SHIFT_V3	9
+#define CBFF_SECTOR_SHIFT_V4	12
 
 	USHORT _usReserved; // [022H,02] reserved, must be zero 
 	ULONG _ulReserved1; // [024H,04] reserved, must be zero 
@@ -9,13 +9,21 @@
 #include "Workbook.h"
 
 
-Workbook::Workbook(wxLog *plog, fileDissectTreeCtrl *tree)
+static const wxChar *Workbook_patterns[] =
+{
+	wxT("Workbook"),
+	wxT("Book"),
+	NULL
+};
+
+Workbook::Workbook(wxLog *plog, fileDissectNodes *tree)
 {
 	m_log = plog;
 	wxLog::SetActiveTarget(m_log);
 	m_tree = tree;
 	
 	m_description = wxT("Workbook Stream Dissector");
+	m_patterns = Workbook_patterns;
 	m_cur = m_end = 0;
 }
 
@@ -24,34 +32,32 @@ void Workbook::MarkDesiredStreams(void)
 {
 	wxLog::SetActiveTarget(m_log);
 
+	// we're only handed streams matching our patterns
 	for (cbffStreamList::iterator i = m_streams->begin();
 		i != m_streams->end();
 		i++)
 	{
 		cbffStream *p = (cbffStream *)(*i);
-		if (p->m_name.Matches(wxT("Workbook")) || p->m_name.Matches(wxT("Book")))
-		{
-			// wxLogMessage(wxT("%s: flagging %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
-			p->m_wanted = true;
-		}
+		// wxLogMessage(wxT("%s: flagging %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
+		p->m_wanted = true;
 	}
 }
 
 
 void Workbook::Dissect(void)
 {
-	// still need to visit all streams to know if we should actually dissect
 	for (cbffStreamList::iterator i = m_streams->begin();
 		i != m_streams->end();
 		i++)
 	{
 		cbffStream *p = (cbffStream *)(*i);
 
-		if (p->m_name.Matches(wxT("Workbook")) || p->m_name.Matches(wxT("Book")))
-		{
-			// wxLogMessage(wxT("%s: dissecting %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
-			DissectStream(p);
-		}
+		// wxLogMessage(wxT("%s: dissecting %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
+		// the stream is only copied if it's fragmented in the file
+		if (!p->GetData())
+			continue;
+		DissectStream(p);
+		p->ReleaseData();
 	}
 }
 
@@ -69,11 +75,11 @@ void Workbook::DissectStream(cbffStream *pStream)
 
 	wxNodeStack bof_nodes;
 	wxTreeItemId &cur_node = pStream->m_id;
-	struct WorkbookRecord *prec;
+	const struct WorkbookRecord *prec;
 	while ((prec = GetNextRecord()))
 	{
 		// convert stream offset of this record to a file offset
-		off = pStream->GetFileOffset((BYTE *)prec - pStream->m_data);
+		off = pStream->GetFileOffset((const BYTE *)prec - pStream->m_data);
 
 		// add this line no matter what
 		wxTreeItemId new_node = m_tree->AppendItem(pStream->m_id, 
@@ -176,27 +182,27 @@ void Workbook::DissectStream(cbffStream *pStream)
 }
 
 
-struct WorkbookRecord *Workbook::GetNextRecord(void)
+const struct WorkbookRecord *Workbook::GetNextRecord(void)
 {
-	struct WorkbookRecord *prec;
+	const struct WorkbookRecord *prec;
 
 	// if we're pointing at the end, just return NULL without logging
 	if (m_cur == m_end)
-		return (struct WorkbookRecord *)NULL;
+		return (const struct WorkbookRecord *)NULL;
 
 	// make sure we have enough for a record
 	if ((size_t)(m_end - m_cur) < sizeof(struct WorkbookRecord))
 	{
 		wxLogError(wxT("%s: Not enough data left for record header!"), wxT("Workbook::GetNextRecord()"));
-		return (struct WorkbookRecord *)NULL;
+		return (const struct WorkbookRecord *)NULL;
 	}
-	prec = (struct WorkbookRecord *)m_cur;
+	prec = (const struct WorkbookRecord *)m_cur;
 
 	// make sure the data is in bounds as well
 	if (m_end - (m_cur + sizeof(struct WorkbookRecord)) < prec->uLength)
 	{
 		wxLogError(wxT("%s: Not enough data left for record number 0x%04x, length 0x%04x!"), wxT("Workbook::GetNextRecord()"), prec->uNumber, prec->uLength);
-		return (struct WorkbookRecord *)NULL;
+		return (const struct WorkbookRecord *)NULL;
 	}
 
 	// all good, advance the cur ptr and return it
@@ -205,7 +211,7 @@ struct WorkbookRecord *Workbook::GetNextRecord(void)
 }
 
 
-void Workbook::AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough data
 	if (prec->uLength < sizeof(struct WorkbookBOFRecord))
@@ -215,10 +221,10 @@ void Workbook::AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the BOF details
-	struct WorkbookBOFRecord *pBOF = (struct WorkbookBOFRecord *)(prec + 1);
+	const struct WorkbookBOFRecord *pBOF = (const struct WorkbookBOFRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Version: 0x%04x"), pBOF->_uvers), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(_uvers, (*pBOF)), FDT_SIZE_OF(_uvers, (*pBOF))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Type: 0x%04x (%s)"), pBOF->_udt, HumanReadableBOFType(pBOF->_udt)), -1, -1,
@@ -239,7 +245,7 @@ void Workbook::AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, struct
 }
 
 
-void Workbook::AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	size_t len;
 
@@ -251,10 +257,10 @@ void Workbook::AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, stru
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the FORMAT details
-	struct WorkbookFORMATRecord *pFMT = (struct WorkbookFORMATRecord *)(prec + 1);
+	const struct WorkbookFORMATRecord *pFMT = (const struct WorkbookFORMATRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Format index code: 0x%04x"), pFMT->ifmt), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(ifmt, (*pFMT)), FDT_SIZE_OF(ifmt, (*pFMT))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Length of string: 0x%04x"), pFMT->cch), -1, -1, 
@@ -272,7 +278,7 @@ void Workbook::AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, stru
 		len = pFMT->cch;
 	if (len)
 	{
-		BYTE *pByte = (BYTE *)(prec + 1) + sizeof(struct WorkbookFORMATRecord);
+		const BYTE *pByte = (const BYTE *)(prec + 1) + sizeof(struct WorkbookFORMATRecord);
 		DecodeString(pByte, len, pFMT->grbit, strValue);
 		len = GetStringLength(len, pFMT->grbit); // adjust length based on grbit
 	}
@@ -281,14 +287,14 @@ void Workbook::AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, stru
 }
 
 
-void Workbook::AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// if we dont have any bytes, we have no child data (valid possibility)
 	if (prec->uLength < 3)
 		return;
 
 	// get the file offset for the beginning of this record
-	BYTE *cch = (BYTE *)(prec + 1);
+	const BYTE *cch = (const BYTE *)(prec + 1);
 	wxFileOffset off = pStream->GetFileOffset(cch - pStream->m_data);
 
 	// add the HEADER details
@@ -308,7 +314,7 @@ void Workbook::AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, stru
 	wxString strValue = wxT("");
 	if (len)
 	{
-		BYTE *pByte = cch + 3;
+		const BYTE *pByte = cch + 3;
 		DecodeString(pByte, len, 0, strValue);
 		// grbit is hardcoded to 0
 	}
@@ -316,7 +322,7 @@ void Workbook::AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, stru
 }
 
 
-void Workbook::AddINTERFACEHDRContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddINTERFACEHDRContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// older versions might not have any data
 	if (prec->uLength == 0)
@@ -334,14 +340,14 @@ void Workbook::AddINTERFACEHDRContents(cbffStream *pStream, wxTreeItemId &parent
 		wxLogWarning(wxT("%s: Extra data bytes (0x%04x) for INTERFACEHDR record"), wxT("Workbook::AddINTERFACEHDRContents()"), prec->uLength);
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	WORD *pCodePage = (WORD *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Codepage: 0x%04x"), *pCodePage), -1, -1, new fdTIData(off, 2));
 }
 
 
-void Workbook::AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// XXX: create structure for this one and use it
 
@@ -353,7 +359,7 @@ void Workbook::AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	}
 
 	// get the file offset for the beginning of this record
-	BYTE *pByte = (BYTE *)(prec + 1);
+	const BYTE *pByte = (const BYTE *)(prec + 1);
 	wxFileOffset off = pStream->GetFileOffset(pByte - pStream->m_data);
 
 	m_tree->AppendItem(parent, wxString::Format(wxT("ADDMENU Count: 0x%02x"), *pByte), -1, -1, new fdTIData(off, 1));
@@ -362,7 +368,7 @@ void Workbook::AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, struct
 }
 
 
-void Workbook::AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	/* XXX: which version is the file? */
 
@@ -376,16 +382,16 @@ void Workbook::AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent,
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
-	struct WorkbookWRITEACCESSRecord8 *pWA = (struct WorkbookWRITEACCESSRecord8 *)(prec + 1);
+	const struct WorkbookWRITEACCESSRecord8 *pWA = (const struct WorkbookWRITEACCESSRecord8 *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("String length: 0x%04x"), pWA->cch), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(cch, (*pWA)), FDT_SIZE_OF(cch, (*pWA))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("String options: 0x%02x"), pWA->grbit), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(grbit, (*pWA)), FDT_SIZE_OF(grbit, (*pWA))));
 
 	wxString str_stName = wxT("");
-	BYTE *pByte = (BYTE *)pWA->stName;
+	const BYTE *pByte = (const BYTE *)pWA->stName;
 	// note the cch value is ignored (fixed length string)
 	DecodeString(pByte, sizeof(pWA->stName), pWA->grbit, str_stName);
 	str_stName.Trim();
@@ -401,10 +407,10 @@ void Workbook::AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent,
 			wxLogError(wxT("%s: Incorrect amount of data for WRITEACCESS record (0x%04x)!"), wxT("Workbook::AddWRITEACCESSContents()"), prec->uLength);
 			return;
 		}
-		struct WorkbookWRITEACCESSRecord7 *pWA;
-		pWA = (struct WorkbookWRITEACCESSRecord7 *)(prec + 1);
+		const struct WorkbookWRITEACCESSRecord7 *pWA;
+		pWA = (const struct WorkbookWRITEACCESSRecord7 *)(prec + 1);
 		m_tree->AppendItem(parent, wxString::Format(wxT("String length: 0x%02x"), pWA->cch), -1, -1, ...
-		BYTE *pByte = (BYTE *)pWA->stName;
+		const BYTE *pByte = (const BYTE *)pWA->stName;
 		// note the cch value is ignored (fixed length string)
 		// also, no flags are present -- use ANSI string
 		DecodeString(pByte, sizeof(pWA->stName), 0, str_stName);
@@ -415,7 +421,7 @@ void Workbook::AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent,
 }
 
 
-void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	size_t len;
 
@@ -427,10 +433,10 @@ void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent,
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the BOUNDSHEET details
-	struct WorkbookBOUNDSHEETRecord *pBS = (struct WorkbookBOUNDSHEETRecord *)(prec + 1);
+	const struct WorkbookBOUNDSHEETRecord *pBS = (const struct WorkbookBOUNDSHEETRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("BOF Stream Position: 0x%08x"), pBS->lbPlyPos), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(lbPlyPos, (*pBS)), FDT_SIZE_OF(lbPlyPos, (*pBS))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Options flags: 0x%04x"), pBS->grbit), -1, -1, 
@@ -452,7 +458,7 @@ void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent,
 
 	if (len)
 	{
-		BYTE *pByte = (BYTE *)(prec + 1) + sizeof(struct WorkbookBOUNDSHEETRecord);
+		const BYTE *pByte = (const BYTE *)(prec + 1) + sizeof(struct WorkbookBOUNDSHEETRecord);
 		DecodeString(pByte, len, pBS->rg_grbit, strValue);
 		len = GetStringLength(len, pBS->rg_grbit); // adjust length based on grbit
 	}
@@ -465,7 +471,7 @@ void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent,
 		wxLogWarning(wxT("%s: lbPlyPos (0x%08x) points outside of stream"), wxT("Workbook::AddBOUNDSHEETContents()"), pBS->lbPlyPos);
 	else
 	{
-		prec = (struct WorkbookRecord *)(pStream->m_data + pBS->lbPlyPos);
+		prec = (const struct WorkbookRecord *)(pStream->m_data + pBS->lbPlyPos);
 		// note: this record didn't exist prior to BIFF5
 		if (prec->uNumber != WBOOK_RT_BOF578)
 			wxLogWarning(wxT("%s: lbPlyPos (0x%08x) does not point at a BOF record"), wxT("Workbook::AddBOUNDSHEETContents()"), pBS->lbPlyPos);
@@ -473,7 +479,24 @@ void Workbook::AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent,
 }
 
 
-void Workbook::AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+static const fdField Workbook_FONT_fields[] =
+{
+	FD_FIELD(WorkbookFONTRecord, dyHeight, wxT("Font height"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, grbit, wxT("Font attributes"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, icv, wxT("Color palette index"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, bls, wxT("Bold style"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, sss, wxT("Sub/Superscript"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, uls, wxT("Underline style"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, bFamily, wxT("Font family"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, bCharSet, wxT("Character set"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, _reserved, wxT("Reserved"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, cch, wxT("Name length"), FDF_HEX),
+	FD_FIELD(WorkbookFONTRecord, rg_grbit, wxT("String options"), FDF_HEX),
+	FD_FIELD_END
+};
+
+
+void Workbook::AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	size_t len;
 
@@ -485,32 +508,12 @@ void Workbook::AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the BOUNDSHEET details
-	struct WorkbookFONTRecord *pFONT = (struct WorkbookFONTRecord *)(prec + 1);
-	m_tree->AppendItem(parent, wxString::Format(wxT("Font height: 0x%04x"), pFONT->dyHeight), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(dyHeight, (*pFONT)), FDT_SIZE_OF(dyHeight, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Font attributes: 0x%04x"), pFONT->grbit), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(grbit, (*pFONT)), FDT_SIZE_OF(grbit, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Color palette index: 0x%04x"), pFONT->icv), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(icv, (*pFONT)), FDT_SIZE_OF(icv, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Bold style: 0x%04x"), pFONT->bls), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(bls, (*pFONT)), FDT_SIZE_OF(bls, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Sub/Superscript: 0x%04x"), pFONT->sss), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(sss, (*pFONT)), FDT_SIZE_OF(sss, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Underline style: 0x%02x"), pFONT->uls), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(uls, (*pFONT)), FDT_SIZE_OF(uls, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Font family: 0x%02x"), pFONT->bFamily), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(bFamily, (*pFONT)), FDT_SIZE_OF(bFamily, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Character set: 0x%02x"), pFONT->bCharSet), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(bCharSet, (*pFONT)), FDT_SIZE_OF(bCharSet, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Reserved: 0x%02x"), pFONT->_reserved), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(_reserved, (*pFONT)), FDT_SIZE_OF(_reserved, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Name length: 0x%02x"), pFONT->cch), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(cch, (*pFONT)), FDT_SIZE_OF(cch, (*pFONT))));
-	m_tree->AppendItem(parent, wxString::Format(wxT("String options: 0x%02x"), pFONT->rg_grbit), -1, -1, 
-		new fdTIData(off + FDT_OFFSET_OF(rg_grbit, (*pFONT)), FDT_SIZE_OF(rg_grbit, (*pFONT))));
+	const struct WorkbookFONTRecord *pFONT = (const struct WorkbookFONTRecord *)(prec + 1);
+	fdAppendFields(m_tree, parent, Workbook_FONT_fields, (const wxByte *)pFONT,
+		sizeof(struct WorkbookFONTRecord), off);
 
 	// check that the length is ok
 	wxString strValue = wxT("");
@@ -524,7 +527,7 @@ void Workbook::AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	// if we have string data, process it
 	if (len)
 	{
-		BYTE *pByte = (BYTE *)(prec + 1) + sizeof(struct WorkbookFONTRecord);
+		const BYTE *pByte = (const BYTE *)(prec + 1) + sizeof(struct WorkbookFONTRecord);
 		DecodeString(pByte, len, pFONT->rg_grbit, strValue);
 		len = GetStringLength(len, pFONT->rg_grbit); // adjust length based on grbit
 	}
@@ -534,7 +537,7 @@ void Workbook::AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 }
 
 
-void Workbook::AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough data
 	if (prec->uLength < sizeof(struct WorkbookLABELSSTRecord))
@@ -544,10 +547,10 @@ void Workbook::AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, st
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the details
-	struct WorkbookLABELSSTRecord *pLABELSST = (struct WorkbookLABELSSTRecord *)(prec + 1);
+	const struct WorkbookLABELSSTRecord *pLABELSST = (const struct WorkbookLABELSSTRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Row: 0x%04x"), pLABELSST->rw), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(rw, (*pLABELSST)), FDT_SIZE_OF(rw, (*pLABELSST))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Column: 0x%04x"), pLABELSST->col), -1, -1, 
@@ -559,7 +562,7 @@ void Workbook::AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, st
 }
 
 
-void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough for the header at least
 	if (prec->uLength < sizeof(struct WorkbookSSTRecord))
@@ -569,10 +572,10 @@ void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the structure details
-	struct WorkbookSSTRecord *pSST = (struct WorkbookSSTRecord *)(prec + 1);
+	const struct WorkbookSSTRecord *pSST = (const struct WorkbookSSTRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Total strings: 0x%08x"), pSST->cstTotal), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(cstTotal, (*pSST)), FDT_SIZE_OF(cstTotal, (*pSST))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Unique count: 0x%08x"), pSST->cstUnique), -1, -1, 
@@ -581,7 +584,7 @@ void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 	// add a node (with details below) for each string
 	DWORD i = pSST->cstUnique;
 	WORD uBytesLeft = prec->uLength - sizeof(struct WorkbookSSTRecord);
-	BYTE *pByte = (BYTE *)(pSST + 1);
+	const BYTE *pByte = (const BYTE *)(pSST + 1);
 	unsigned long cur_num = 0;
 	while (i > 0)
 	{
@@ -591,7 +594,7 @@ void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 			return;
 		}
 
-		struct WorkbookWSZ *pWSZ = (struct WorkbookWSZ *)pByte;
+		const struct WorkbookWSZ *pWSZ = (const struct WorkbookWSZ *)pByte;
 		off = pByte - pStream->m_data;
 
 		// add the parent node and the WSZ fields
@@ -639,7 +642,7 @@ void Workbook::AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct
 }
 
 
-void Workbook::AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough for the header at least
 	if (prec->uLength < sizeof(struct WorkbookEXTSSTRecord))
@@ -649,10 +652,10 @@ void Workbook::AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, stru
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the structure details
-	struct WorkbookEXTSSTRecord *pXSST = (struct WorkbookEXTSSTRecord *)(prec + 1);
+	const struct WorkbookEXTSSTRecord *pXSST = (const struct WorkbookEXTSSTRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Strings per bucket: 0x%04x"), pXSST->Dsst), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(Dsst, (*pXSST)), FDT_SIZE_OF(Dsst, (*pXSST))));
 	off += sizeof(*pXSST);
@@ -667,7 +670,7 @@ void Workbook::AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, stru
 
 	// add an entry for each item 
 	// (note the number of items is stored in an SST record)
-	struct WorkbookEXTSST_ISSTINF *pINF = (struct WorkbookEXTSST_ISSTINF *)(pXSST + 1);
+	const struct WorkbookEXTSST_ISSTINF *pINF = (const struct WorkbookEXTSST_ISSTINF *)(pXSST + 1);
 	DWORD i = 0;
 	while (i < entries)
 	{
@@ -698,7 +701,7 @@ void Workbook::AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, stru
 }
 
 
-void Workbook::AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough for the header at least
 	if (prec->uLength < sizeof(struct WorkbookMULBLANKRecord))
@@ -708,28 +711,29 @@ void Workbook::AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, st
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the MULBLANK details
-	struct WorkbookMULBLANKRecord *pMB = (struct WorkbookMULBLANKRecord *)(prec + 1);
+	const struct WorkbookMULBLANKRecord *pMB = (const struct WorkbookMULBLANKRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Row number: 0x%04x"), pMB->rw), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(rw, (*pMB)), FDT_SIZE_OF(rw, (*pMB))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("First column: 0x%04x"), pMB->colFirst), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(colFirst, (*pMB)), FDT_SIZE_OF(colFirst, (*pMB))));
 
 	// get the last word of the record (XXX: validate?)
-	pMB->colLast = *(USHORT *)((BYTE *)pMB + prec->uLength - sizeof(pMB->colLast));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Last column: 0x%04x"), pMB->colLast), -1, -1, 
-		new fdTIData(off + prec->uLength - sizeof(pMB->colLast), sizeof(pMB->colLast)));
+	// (copied out, the record may be in the read-only file mapping)
+	USHORT colLast = *(const USHORT *)((const BYTE *)pMB + prec->uLength - sizeof(colLast));
+	m_tree->AppendItem(parent, wxString::Format(wxT("Last column: 0x%04x"), colLast), -1, -1, 
+		new fdTIData(off + prec->uLength - sizeof(colLast), sizeof(colLast)));
 
 	// extract the array
 	USHORT bytes_left = prec->uLength - sizeof(struct WorkbookMULBLANKRecord);
-	if (pMB->colFirst > pMB->colLast)
+	if (pMB->colFirst > colLast)
 	{
-		wxLogError(wxT("%s: BLANK first column (0x%04x) is greater than last column (0x%04x)!"), wxT("Workbook::AddMULBLANKContents()"), pMB->colFirst, pMB->colLast);
+		wxLogError(wxT("%s: BLANK first column (0x%04x) is greater than last column (0x%04x)!"), wxT("Workbook::AddMULBLANKContents()"), pMB->colFirst, colLast);
 		return;
 	}
-	size_t num_ixfe = (pMB->colLast - pMB->colFirst) + 1;
+	size_t num_ixfe = (colLast - pMB->colFirst) + 1;
 	USHORT num_rec = bytes_left / sizeof(USHORT);
 	if (bytes_left % sizeof(USHORT) != 0
 		|| num_rec != num_ixfe)
@@ -737,8 +741,8 @@ void Workbook::AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, st
 		wxLogWarning(wxT("%s: Number of BLANK records (%lu) does not match remaining byte count (0x%04x)!"), wxT("Workbook::AddMULBLANKContents()"), num_ixfe, bytes_left);
 	}
 
-	USHORT *pXFI = (USHORT *)((BYTE *)pMB + sizeof(pMB->rw) + sizeof(pMB->colFirst));
-	off += sizeof(*pMB) - sizeof(pMB->colLast);
+	const USHORT *pXFI = (const USHORT *)((const BYTE *)pMB + sizeof(pMB->rw) + sizeof(pMB->colFirst));
+	off += sizeof(*pMB) - sizeof(colLast);
 	int i;
 	for (i = 0; i < num_rec; i++)
 		m_tree->AppendItem(parent, wxString::Format(wxT("Column %d XF Index: 0x%04x"), i + pMB->colFirst, pXFI[i]), -1, -1,
@@ -746,7 +750,7 @@ void Workbook::AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, st
 }
 
 
-void Workbook::AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough for the header at least
 	if (prec->uLength < sizeof(struct WorkbookMULRKRecord))
@@ -756,36 +760,37 @@ void Workbook::AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, struc
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the MULRK details
-	struct WorkbookMULRKRecord *pMB = (struct WorkbookMULRKRecord *)(prec + 1);
+	const struct WorkbookMULRKRecord *pMB = (const struct WorkbookMULRKRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Row number: 0x%04x"), pMB->rw), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(rw, (*pMB)), FDT_SIZE_OF(rw, (*pMB))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("First column: 0x%04x"), pMB->colFirst), -1, -1, 
 		new fdTIData(off + FDT_OFFSET_OF(colFirst, (*pMB)), FDT_SIZE_OF(colFirst, (*pMB))));
 
 	// extract the last col from the end
-	pMB->colLast = *(USHORT *)((BYTE *)pMB + prec->uLength - sizeof(pMB->colLast));
-	m_tree->AppendItem(parent, wxString::Format(wxT("Last column: 0x%04x"), pMB->colLast), -1, -1, 
-		new fdTIData(off + prec->uLength - sizeof(pMB->colLast), sizeof(pMB->colLast)));
+	// (copied out, the record may be in the read-only file mapping)
+	USHORT colLast = *(const USHORT *)((const BYTE *)pMB + prec->uLength - sizeof(colLast));
+	m_tree->AppendItem(parent, wxString::Format(wxT("Last column: 0x%04x"), colLast), -1, -1, 
+		new fdTIData(off + prec->uLength - sizeof(colLast), sizeof(colLast)));
 
 	// extract the array
 	USHORT bytes_left = prec->uLength - sizeof(struct WorkbookMULRKRecord);
-	if (pMB->colFirst > pMB->colLast)
+	if (pMB->colFirst > colLast)
 	{
-		wxLogError(wxT("%s: RK first column (0x%04x) is greater than RK last column (0x%04x)!"), wxT("Workbook::AddMULRKContents()"), pMB->colFirst, pMB->colLast);
+		wxLogError(wxT("%s: RK first column (0x%04x) is greater than RK last column (0x%04x)!"), wxT("Workbook::AddMULRKContents()"), pMB->colFirst, colLast);
 		return;
 	}
-	size_t num_rk = (pMB->colLast - pMB->colFirst) + 1;
+	size_t num_rk = (colLast - pMB->colFirst) + 1;
 	USHORT num_rec = bytes_left / sizeof(struct WorkbookRKREC);
 	if (bytes_left % sizeof(struct WorkbookRKREC) != 0
 		|| num_rec != num_rk)
 	{
 		wxLogWarning(wxT("%s: Number of RK records (%lu) does not match remaining byte count (0x%04x)!"), wxT("Workbook::AddMULRKContents()"), num_rk, bytes_left);
 	}
-	struct WorkbookRKREC *pRK = (struct WorkbookRKREC *)((BYTE *)pMB + sizeof(pMB->rw) + sizeof(pMB->colFirst));
-	off += sizeof(*pMB) - sizeof(pMB->colLast);
+	const struct WorkbookRKREC *pRK = (const struct WorkbookRKREC *)((const BYTE *)pMB + sizeof(pMB->rw) + sizeof(pMB->colFirst));
+	off += sizeof(*pMB) - sizeof(colLast);
 	int i;
 	for (i = 0; i < num_rec; i++)
 	{
@@ -803,7 +808,7 @@ void Workbook::AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, struc
 }
 
 
-void Workbook::AddRKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec)
+void Workbook::AddRKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec)
 {
 	// validate we have enough for the header at least
 	if (prec->uLength < sizeof(struct WorkbookRKRecord))
@@ -813,10 +818,10 @@ void Workbook::AddRKContents(cbffStream *pStream, wxTreeItemId &parent, struct W
 	}
 
 	// get the file offset for the beginning of this record
-	wxFileOffset off = pStream->GetFileOffset((BYTE *)(prec + 1) - pStream->m_data);
+	wxFileOffset off = pStream->GetFileOffset((const BYTE *)(prec + 1) - pStream->m_data);
 
 	// add the RK details
-	struct WorkbookRKRecord *pRK = (struct WorkbookRKRecord *)(prec + 1);
+	const struct WorkbookRKRecord *pRK = (const struct WorkbookRKRecord *)(prec + 1);
 	m_tree->AppendItem(parent, wxString::Format(wxT("Row number: 0x%04x"), pRK->rw), -1, -1, 
 			new fdTIData(off + FDT_OFFSET_OF(rw, (*pRK)), FDT_SIZE_OF(rw, (*pRK))));
 	m_tree->AppendItem(parent, wxString::Format(wxT("Column number: 0x%04x"), pRK->col), -1, -1, 
@@ -2198,7 +2203,7 @@ wxChar *Workbook::HumanReadableRKType(ULONG encValue)
 }
 
 
-void Workbook::DecodeString(BYTE *pByte, USHORT cch, USHORT grbit, wxString &str)
+void Workbook::DecodeString(const BYTE *pByte, USHORT cch, USHORT grbit, wxString &str)
 {
 	// XXX: support other options, encodings, etc...
 
@@ -2206,7 +2211,7 @@ void Workbook::DecodeString(BYTE *pByte, USHORT cch, USHORT grbit, wxString &str
 	if (grbit & 0x1)
 	{
 		// not compressed - unicode string
-		wchar_t *rgch = (wchar_t *)pByte;
+		const wchar_t *rgch = (const wchar_t *)pByte;
 
 		wxMBConvUTF16 u16;
 		str = u16.cWC2WX(rgch);
@@ -2215,7 +2220,7 @@ void Workbook::DecodeString(BYTE *pByte, USHORT cch, USHORT grbit, wxString &str
 	else
 	{
 		// compressed -- ansi string
-		char *rgch = (char *)pByte;
+		const char *rgch = (const char *)pByte;
 		str = wxString::From8BitData(rgch, cch);
 	}
 }
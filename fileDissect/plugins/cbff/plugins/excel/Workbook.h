@@ -11,6 +11,7 @@
 
 #include "cbffStreamPlugin.h"
 #include "WorkbookDefs.h"
+#include "fileDissectRecord.h"
 
 
 // used for tracking nested pages (BOFs)
@@ -21,7 +22,7 @@ WX_DECLARE_STACK(wxTreeItemId, wxNodeStack);
 class Workbook : public cbffStreamPlugin
 {
 public:
-	Workbook(wxLog *plog, fileDissectTreeCtrl *tree);
+	Workbook(wxLog *plog, fileDissectNodes *tree);
 
 	// plugin interface methods
 	void MarkDesiredStreams(void);
@@ -30,34 +31,34 @@ public:
 	// void CloseFile(void);
 
 private:
-	BYTE *m_cur;
-	BYTE *m_end;
+	const BYTE *m_cur;
+	const BYTE *m_end;
 	
 	void DissectStream(cbffStream *pStream);
 
-	struct WorkbookRecord *GetNextRecord(void);
+	const struct WorkbookRecord *GetNextRecord(void);
 
-	void AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddINTERFACEHDRContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
-	void AddRKContents(cbffStream *pStream, wxTreeItemId &parent, struct WorkbookRecord *prec);
+	void AddBOFContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddBOUNDSHEETContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddFORMATContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddHEADERContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddINTERFACEHDRContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddMMSContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddWRITEACCESSContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddFONTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddLABELSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddEXTSSTContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddMULBLANKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddMULRKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
+	void AddRKContents(cbffStream *pStream, wxTreeItemId &parent, const struct WorkbookRecord *prec);
 
 	wxChar *HumanReadableBOFType(USHORT);
 	wxChar *HumanReadableRecordTypeShort(USHORT);
 	wxChar *HumanReadableRecordTypeLong(USHORT);
 	wxChar *HumanReadableRKType(ULONG);
 
-	void DecodeString(BYTE *, USHORT, USHORT, wxString &);
+	void DecodeString(const BYTE *, USHORT, USHORT, wxString &);
 	size_t GetStringLength(USHORT, USHORT);
 
 	double RKDecode(ULONG);
@@ -60,13 +60,20 @@ propType_t summInfoPropIds[] =
 };
 
 
-summInfo::summInfo(wxLog *plog, fileDissectTreeCtrl *tree)
+static const wxChar *summInfo_patterns[] =
+{
+	wxT("*SummaryInformation"),
+	NULL
+};
+
+summInfo::summInfo(wxLog *plog, fileDissectNodes *tree)
 {
 	m_log = plog;
 	wxLog::SetActiveTarget(m_log);
 	m_tree = tree;
 
 	m_description = wxT("SummaryInformation Stream Dissector");
+	m_patterns = summInfo_patterns;
 	m_streams = 0;
 }
 
@@ -75,38 +82,74 @@ void summInfo::MarkDesiredStreams(void)
 {
 	wxLog::SetActiveTarget(m_log);
 
+	// we're only handed streams matching our patterns
 	for (cbffStreamList::iterator i = m_streams->begin();
 		i != m_streams->end();
 		i++)
 	{
 		cbffStream *p = (cbffStream *)(*i);
-		if (p->m_name.Matches(wxT("*SummaryInformation")))
-		{
-			// wxLogMessage(wxT("%s: flagging %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
-			p->m_wanted = true;
-		}
+		// wxLogMessage(wxT("%s: flagging %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
+		p->m_wanted = true;
 	}
 }
 
 
 void summInfo::Dissect(void)
 {
-	// still need to visit all streams to know if we should actually dissect
 	for (cbffStreamList::iterator i = m_streams->begin();
 		i != m_streams->end();
 		i++)
 	{
 		cbffStream *p = (cbffStream *)(*i);
 
-		if (p->m_name.Matches(wxT("*SummaryInformation")))
-		{
-			// wxLogMessage(wxT("%s: dissecting %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
-			DissectStream(p);
-		}
+		// wxLogMessage(wxT("%s: dissecting %s"), wxT("summInfo::MarkDesiredStream()"), p->m_name);
+		// the stream is only copied if it's fragmented in the file
+		if (!p->GetData())
+			continue;
+		DissectStream(p);
+		p->ReleaseData();
 	}
 }
 
 
+static void summInfoAnnotatePropId(wxUint64 value, wxString &dest)
+{
+	dest = summInfo::HumanReadablePropId((ULONG)value);
+}
+
+static const fdField summInfo_header_fields[] =
+{
+	FD_FIELD(SummaryInformationHeader, uByteOrder, wxT("Byte Order"), FDF_HEX),
+	FD_FIELD(SummaryInformationHeader, uReserved, wxT("Reserved"), FDF_HEX),
+	FD_FIELD(SummaryInformationHeader, uOSVersion, wxT("OS Version"), FDF_HEX),
+	FD_FIELD(SummaryInformationHeader, uPlatform, wxT("Platform"), FDF_HEX),
+	FD_FIELD(SummaryInformationHeader, clsid, wxT("CLSID"), FDF_GUID),
+	FD_FIELD(SummaryInformationHeader, ulSectionCount, wxT("Section Count"), FDF_HEX),
+	FD_FIELD_END
+};
+
+static const fdField summInfo_secdecl_fields[] =
+{
+	FD_FIELD(SummaryInformationSectionDeclaration, clsid, wxT("CLSID"), FDF_GUID),
+	FD_FIELD(SummaryInformationSectionDeclaration, ulOffset, wxT("Offset"), FDF_HEX),
+	FD_FIELD_END
+};
+
+static const fdField summInfo_sechdr_fields[] =
+{
+	FD_FIELD(SummaryInformationSectionHeader, ulLength, wxT("Length"), FDF_HEX),
+	FD_FIELD(SummaryInformationSectionHeader, ulPropertyCount, wxT("Property Count"), FDF_HEX),
+	FD_FIELD_END
+};
+
+static const fdField summInfo_propdecl_fields[] =
+{
+	FD_FIELD_A(SummaryInformationPropertyDeclaration, ulPropertyId, wxT("Id"), FDF_HEX, summInfoAnnotatePropId),
+	FD_FIELD(SummaryInformationPropertyDeclaration, ulOffset, wxT("Offset"), FDF_HEX),
+	FD_FIELD_END
+};
+
+
 void summInfo::DissectStream(cbffStream *pStream)
 {
 	// erm, wtf?
@@ -121,35 +164,13 @@ void summInfo::DissectStream(cbffStream *pStream)
 	}
 
 	// add the header to the tree
-	struct SummaryInformationHeader *phdr = (struct SummaryInformationHeader *)pStream->m_data;
+	const struct SummaryInformationHeader *phdr = (const struct SummaryInformationHeader *)pStream->m_data;
 	// XXX: what about tiny tiny mini sector sizes??
 	wxFileOffset off = pStream->GetFileOffset(0);
 	wxTreeItemId hdr_id = m_tree->AppendItem(pStream->m_id, wxT("Header"), -1, -1, 
 		new fdTIData(off, sizeof(struct SummaryInformationHeader)));
-	m_tree->AppendItem(hdr_id, wxString::Format(wxT("Byte Order: 0x%04x"), phdr->uByteOrder),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(uByteOrder, (*phdr)), FDT_SIZE_OF(uByteOrder, (*phdr))));
-	m_tree->AppendItem(hdr_id, wxString::Format(wxT("Reserved: 0x%04x"), phdr->uReserved),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(uReserved, (*phdr)), FDT_SIZE_OF(uReserved, (*phdr))));
-	m_tree->AppendItem(hdr_id, wxString::Format(wxT("OS Version: 0x%04x"), phdr->uOSVersion),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(uOSVersion, (*phdr)), FDT_SIZE_OF(uOSVersion, (*phdr))));
-	m_tree->AppendItem(hdr_id, wxString::Format(wxT("Platform: 0x%04x"), phdr->uPlatform),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(uPlatform, (*phdr)), FDT_SIZE_OF(uPlatform, (*phdr))));
-	m_tree->AppendItem(hdr_id, wxString::Format(
-			wxT("CLSID: %08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x"), 
-			phdr->clsid.Data1,
-			phdr->clsid.Data2,
-			phdr->clsid.Data3,
-			phdr->clsid.Data4[0],
-			phdr->clsid.Data4[1],
-			phdr->clsid.Data4[2],
-			phdr->clsid.Data4[3],
-			phdr->clsid.Data4[4],
-			phdr->clsid.Data4[5],
-			phdr->clsid.Data4[6],
-			phdr->clsid.Data4[7]),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(clsid, (*phdr)), FDT_SIZE_OF(clsid, (*phdr))));
-	m_tree->AppendItem(hdr_id, wxString::Format(wxT("Section Count: 0x%08x"), phdr->ulSectionCount),
-		-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulSectionCount, (*phdr)), FDT_SIZE_OF(ulSectionCount, (*phdr))));
+	fdAppendFields(m_tree, hdr_id, summInfo_header_fields, (const wxByte *)phdr,
+		sizeof(struct SummaryInformationHeader), off);
 
 	// validate the data
 	if (phdr->uByteOrder != 0xfffe)
@@ -194,7 +215,7 @@ void summInfo::DissectStream(cbffStream *pStream)
 	}
 
 	// treat this as an array since we know we have enough for the section declarations
-	struct SummaryInformationSectionDeclaration *psd = (struct SummaryInformationSectionDeclaration *)(pStream->m_data + sizeof(SummaryInformationHeader));
+	const struct SummaryInformationSectionDeclaration *psd = (const struct SummaryInformationSectionDeclaration *)(pStream->m_data + sizeof(SummaryInformationHeader));
 
 	// for each section...
 	ULONG i;
@@ -222,22 +243,8 @@ void summInfo::DissectStream(cbffStream *pStream)
 		}
 
 		// ...add declaration data...
-		m_tree->AppendItem(id, wxString::Format(
-			wxT("CLSID: %08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x"), 
-			psd[i].clsid.Data1,
-			psd[i].clsid.Data2,
-			psd[i].clsid.Data3,
-			psd[i].clsid.Data4[0],
-			psd[i].clsid.Data4[1],
-			psd[i].clsid.Data4[2],
-			psd[i].clsid.Data4[3],
-			psd[i].clsid.Data4[4],
-			psd[i].clsid.Data4[5],
-			psd[i].clsid.Data4[6],
-			psd[i].clsid.Data4[7]),
-			-1, -1, new fdTIData(off + FDT_OFFSET_OF(clsid, psd[i]), FDT_SIZE_OF(clsid, psd[i])));
-		m_tree->AppendItem(id, wxString::Format(wxT("Offset: 0x%08x"), psd[i].ulOffset),
-			-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulOffset, psd[i]), FDT_SIZE_OF(ulOffset, psd[i])));
+		fdAppendFields(m_tree, id, summInfo_secdecl_fields, (const wxByte *)(psd + i),
+			sizeof(struct SummaryInformationSectionDeclaration), off);
 
 		// make sure the offset is inside the stream
 		if (psd[i].ulOffset > pStream->m_length)
@@ -254,16 +261,14 @@ void summInfo::DissectStream(cbffStream *pStream)
 		}
 
 		// now add the section header data
-		struct SummaryInformationSectionHeader *pshdr;
-		pshdr = (struct SummaryInformationSectionHeader *)(pStream->m_data + psd[i].ulOffset);
+		const struct SummaryInformationSectionHeader *pshdr;
+		pshdr = (const struct SummaryInformationSectionHeader *)(pStream->m_data + psd[i].ulOffset);
 		// XXX: what about tiny tiny mini sector sizes??
 		off = pStream->GetFileOffset(psd[i].ulOffset);
 		id = m_tree->AppendItem(sec_id, wxT("Section Header"),
 			-1, -1, new fdTIData(off, sizeof(SummaryInformationSectionHeader)));
-		m_tree->AppendItem(id, wxString::Format(wxT("Length: 0x%08x"), pshdr->ulLength),
-			-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulLength, (*pshdr)), FDT_SIZE_OF(ulLength, (*pshdr))));
-		m_tree->AppendItem(id, wxString::Format(wxT("Property Count: 0x%08x"), pshdr->ulPropertyCount),
-			-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulPropertyCount, (*pshdr)), FDT_SIZE_OF(ulPropertyCount, (*pshdr))));
+		fdAppendFields(m_tree, id, summInfo_sechdr_fields, (const wxByte *)pshdr,
+			sizeof(struct SummaryInformationSectionHeader), off);
 
 		wxTreeItemId proot_id = m_tree->AppendItem(sec_id, wxT("Properties"));
 
@@ -288,8 +293,8 @@ void summInfo::DissectStream(cbffStream *pStream)
 		}
 
 		// point to section data!
-		BYTE *sec_data = pStream->m_data + sizeof(SummaryInformationSectionHeader) + psd[i].ulOffset;
-		struct SummaryInformationPropertyDeclaration *ppd = (struct SummaryInformationPropertyDeclaration *)sec_data;
+		const BYTE *sec_data = pStream->m_data + sizeof(SummaryInformationSectionHeader) + psd[i].ulOffset;
+		const struct SummaryInformationPropertyDeclaration *ppd = (const struct SummaryInformationPropertyDeclaration *)sec_data;
 
 		// treat this one as an array since we know we have enough data for the declarations
 		ULONG j;
@@ -304,13 +309,8 @@ void summInfo::DissectStream(cbffStream *pStream)
 				new fdTIData(off, sizeof(struct SummaryInformationPropertyDeclaration)));
 
 			// XXX: link PropIds arrays to CLSIDs (but have a generic handler for unknown ones)
-			m_tree->AppendItem(id, wxString::Format(wxT("Id: 0x%08x (%s)"), ppd[j].ulPropertyId, 
-					HumanReadablePropId(ppd[j].ulPropertyId)),
-				-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulPropertyId, ppd[j]), 
-					FDT_SIZE_OF(ulPropertyId, ppd[j])));
-			m_tree->AppendItem(id, wxString::Format(wxT("Offset: 0x%08x"), ppd[j].ulOffset),
-				-1, -1, new fdTIData(off + FDT_OFFSET_OF(ulOffset, ppd[j]), 
-					FDT_SIZE_OF(ulOffset, ppd[j])));
+			fdAppendFields(m_tree, id, summInfo_propdecl_fields, (const wxByte *)(ppd + j),
+				sizeof(struct SummaryInformationPropertyDeclaration), off);
 
 			// make sure the offset fits within this section's data
 			if (ppd[j].ulOffset > pshdr->ulLength)
@@ -325,8 +325,8 @@ void summInfo::DissectStream(cbffStream *pStream)
 			}
 
 			// okay, we have enough for the property
-			struct SummaryInformationProperty *pprop;
-			pprop = (struct SummaryInformationProperty *)(pStream->m_data + psd[i].ulOffset + ppd[j].ulOffset);
+			const struct SummaryInformationProperty *pprop;
+			pprop = (const struct SummaryInformationProperty *)(pStream->m_data + psd[i].ulOffset + ppd[j].ulOffset);
 			off = pStream->GetFileOffset(psd[i].ulOffset + ppd[j].ulOffset);
 			id = m_tree->AppendItem(prop_id, wxT("Property"), -1, -1,
 				new fdTIData(off, sizeof(struct SummaryInformationProperty)));
@@ -364,7 +364,7 @@ void summInfo::DissectStream(cbffStream *pStream)
 							FDT_SIZE_OF(u.ulDword1, (*pprop))));
 					if (pprop->u.ulDword1 > 0 && pprop->u.ulDword1 < pStream->m_length)
 					{
-						BYTE *str;
+						const BYTE *str;
 
 						str = pStream->m_data + psd[i].ulOffset + ppd[j].ulOffset + sizeof(struct SummaryInformationProperty);
 						off = pStream->GetFileOffset(psd[i].ulOffset + ppd[j].ulOffset + sizeof(struct SummaryInformationProperty));
@@ -380,7 +380,7 @@ void summInfo::DissectStream(cbffStream *pStream)
 							FDT_SIZE_OF(u.ulDword1, (*pprop))));
 					if (pprop->u.ulDword1 > 0 && pprop->u.ulDword1 <= pStream->m_length)
 					{
-						BYTE *str;
+						const BYTE *str;
 
 						str = pStream->m_data + psd[i].ulOffset + ppd[j].ulOffset + sizeof(struct SummaryInformationProperty);
 						off = pStream->GetFileOffset(psd[i].ulOffset + ppd[j].ulOffset + sizeof(struct SummaryInformationProperty));
@@ -398,7 +398,7 @@ void summInfo::DissectStream(cbffStream *pStream)
 					{
 						ULONG left = pprop->u.ulDword1;
 						DWORD format;
-						BYTE *str;
+						const BYTE *str;
 
 						if (left < sizeof(DWORD))
 						{
@@ -10,12 +10,13 @@
 
 #include "cbffStreamPlugin.h"
 #include "cbff_defs.h"
+#include "fileDissectRecord.h"
 
 
 class summInfo : public cbffStreamPlugin
 {
 public:
-	summInfo(wxLog *plog, fileDissectTreeCtrl *tree);
+	summInfo(wxLog *plog, fileDissectNodes *tree);
 
 	// plugin interface methods
 	void MarkDesiredStreams(void);
@@ -23,10 +24,12 @@ public:
 	// we don't store anything extra, this isn't needed (use default)
 	// void CloseFile(void);
 
+	// (static for the field tables)
+	static wxChar *HumanReadablePropId(ULONG id);
+
 private:
 	void DissectStream(cbffStream *pStream);
 
-	wxChar *HumanReadablePropId(ULONG id);
 	wxChar *HumanReadablePropType(ULONG type);
 };
 
@@ -9,6 +9,7 @@
 
 // for handling stream data
 #include "pdfPred.h"
+#include <wx/mstream.h>
 #include <wx/zstream.h>
 
 
@@ -18,10 +19,21 @@ static bool parse_two_integers(wxByte *str, size_t len,
 	unsigned long *pone, wxByte **p1s, wxByte **p1e,
 	unsigned long *ptwo, wxByte **p2s, wxByte **p2e);
 
-pdf::pdf(wxLog *plog, fileDissectTreeCtrl *tree)
+// "Acrobat viewers require only that the header appear somewhere within the
+// first 1024 bytes of the file", and likewise for %%EOF at the end
+static const fileDissectSig pdf_signatures[] =
+{
+	{ "%PDF-", 5, FD_SIG_HEAD, 0, 1024, 100 },
+	{ "%FDF-", 5, FD_SIG_HEAD, 0, 1024, 100 },
+	{ "%%EOF", 5, FD_SIG_TAIL, 0, 1024, 20 },
+	{ NULL, 0, 0, 0, 0, 0 }
+};
+
+pdf::pdf(wxLog *plog, fileDissectNodes *tree) : m_objects(&m_arena)
 {
 	m_description = wxT("Portable Document Format");
 	m_extensions = wxT("*.pdf;*.fdf");
+	m_signatures = pdf_signatures;
 
 	m_trailer = 0;
 	InitFileData();
@@ -34,38 +46,22 @@ pdf::pdf(wxLog *plog, fileDissectTreeCtrl *tree)
 
 void pdf::InitFileData(void)
 {
-	if (m_trailer)
-	{
-		delete m_trailer;
-		m_trailer = 0;
-	}
+	m_trailer = 0;
+	m_offtree = false;
 
 	m_xref_off = wxInvalidOffset;
+	m_index.Clear();
 
 	m_root_id.Unset();
 	m_hdr_id.Unset();
 	m_xref_id.Unset();
 	m_indobj_id.Unset();
 
-	pdfObjectsHashMap::iterator it = m_objects.begin();
-	pdfObjectsHashMap::iterator en = m_objects.end();
-    for (; it != en; ++it)
-	{
-		pdfObjectList *pOL = (pdfObjectList *)it->second;
-		// For some reason, wxHashMap creates keys with NULL values whenever
-		// you access an element that didn't exist. We can't delete NULL
-		// so we just skip them..
-		if (!pOL)
-			continue;
-
-		pdfObjectList::iterator itl = pOL->begin();
-		pdfObjectList::iterator enl = pOL->end();
-		for (; itl != enl; ++itl)
-			pdfObjectBase::Delete((pdfObjectBase *)*itl);
-		pOL->clear();
-		delete pOL;
-	}
-	m_objects.clear();
+	m_streams.Clear();
+	m_objects.Clear();
+	m_names.Clear();
+	// everything parsed out of the last file goes at once
+	m_arena.Reset();
 }
 
 
@@ -86,20 +82,21 @@ void pdf::CloseFile(void)
 }
 
 
-bool pdf::SupportsExtension(const wxChar *extension)
-{
-	if (::wxStrcmp(extension, wxT("pdf")) == 0
-		|| ::wxStrcmp(extension, wxT("fdf")) == 0)
-		return true;
-	return false;
-}
-
-
 void pdf::Dissect(void)
 {
 	if (!m_log || !m_tree || !m_file)
 		return;
 
+	// everything below works on pointers into the mapping
+	if (!m_file->GetBaseAddress())
+	{
+		wxLogError(wxT("%s: This plug-in requires the entire file to be mapped"), wxT("pdf::Dissect()"));
+		return;
+	}
+
+	// a bogus object number can't make the table bigger than the file
+	m_objects.SetLimit(m_file->Length());
+
 	// add a base node
 	m_root_id = m_tree->AddRoot(wxT("Portable Document"));
 
@@ -108,12 +105,23 @@ void pdf::Dissect(void)
 	{
 		if (!DissectHeader())
 			break;
-		if (!DissectTrailer())
-			break;
-		if (!DissectXref())
+		Phase("header");
+		if (!m_index.Build(m_file))
 			break;
+		Phase("index");
+
+		// a broken trailer or xref doesn't stop us, the index still knows
+		// where the objects are
+		bool trailer = DissectTrailer();
+		Phase("trailer");
+		if (trailer)
+			(void) DissectXref();
+		Phase("xref");
+		(void) RecoverObjects();
+		Phase("recover");
 		if (!DissectObjects())
 			break;
+		Phase("objects");
 
 		// we never really intended to loop, just a programming syntax hack!
 		break;
@@ -132,7 +140,7 @@ bool pdf::DissectHeader(void)
 
 	// add the header to the tree
 	wxByte hdr[10] = { 0 };
-	nr = m_file->Read(hdr, sizeof(hdr));
+	nr = m_file->ReadAt(0, hdr, sizeof(hdr));
 	if (nr != sizeof(hdr))
 	{
 		wxLogError(wxT("%s: Read returned %d"), wxT("DissectHeader"), nr);
@@ -176,27 +184,20 @@ bool pdf::DissectTrailer(void)
 		return false;
 	}
 
-	// seek to the end and look for %%EOF
-	wxFileOffset oldoff = m_file->Seek(0, wxFromEnd);
-	if (oldoff == wxInvalidOffset)
-	{
-		wxLogError(wxT("%s: Failed to seek for trailer!"), wxT("DissectTrailer"));
-		return false;
-	}
-
 	// We will add the "Trailer" node to the tree regardless of whether or not we end up
 	// getting anything when parsing...
 	wxTreeItemId trail_id = m_tree->AppendItem(m_root_id, wxT("Trailer"));
 
 	// hold these for optimization
-	wxByte *p_fend = m_file->GetAddress();
 	wxByte *p_base = m_file->GetBaseAddress();
+	wxByte *p_fend = p_base + m_file->Length();
 
 	wxByte *p_tend = p_fend;
 	wxByte *p_sxref = NULL;
 
 	// look for %%EOF
-	wxByte *p_eof = m_file->FindStringReverse("%%EOF");
+	wxFileOffset off = m_index.Last(PDF_TOK_EOF);
+	wxByte *p_eof = (off != wxInvalidOffset) ? p_base + off : NULL;
 	if (p_eof)
 	{
 		// 18. Acrobat viewers require only that the %%EOF marker appear somewhere within the last 1024 bytes of the file.
@@ -209,12 +210,13 @@ bool pdf::DissectTrailer(void)
 		p_tend = p_eof + 5;
 
 		// look for startxref
-		p_sxref = m_file->FindStringReverse("startxref");
+		off = m_index.Last(PDF_TOK_STARTXREF, p_eof - p_base);
+		if (off != wxInvalidOffset)
+			p_sxref = p_base + off;
 		if (!p_sxref)
 		{
 			// failed
 			wxLogError(wxT("%s: Ran out of bytes looking for startxref line!"), wxT("DissectTrailer"));
-			m_file->Seek(oldoff);
 			return false;
 		}
 
@@ -235,7 +237,8 @@ bool pdf::DissectTrailer(void)
 		wxLogWarning(wxT("%s: Unable to locate %%%%EOF"), wxT("DissectTrailer"));
 
 	// ok, try to find "trailer" (might not exist)
-	wxByte *p_trailer = m_file->FindStringReverse("trailer");
+	off = m_index.Last(PDF_TOK_TRAILER);
+	wxByte *p_trailer = (off != wxInvalidOffset) ? p_base + off : NULL;
 
 	// default to "startxref" being the beginning of the trailer data selection
 	// if we find a "trailer" then use that
@@ -254,7 +257,7 @@ bool pdf::DissectTrailer(void)
 		p_trailer_end = p_fend;
 
 	// create the trailer object and set the tree item data
-	m_trailer = new pdfIndirect(0xffffffff, trail_off, 0xffffffff);
+	m_trailer = new (m_arena) pdfIndirect(0xffffffff, trail_off, 0xffffffff);
 	m_trailer->m_id = trail_id;
 	m_tree->SetItemData(trail_id, new fdTIData(trail_off, trail_len));
 
@@ -276,8 +279,15 @@ bool pdf::DissectTrailer(void)
 		// parse read the dictionary after "trailer"
 		(void) DissectData(tmp, m_trailer);
 
+		// size the object table up front so the xref can fill it in directly
+		// (a /Size bigger than the file is a lie, let the table grow instead)
+		pdfInteger *pSize = (pdfInteger *)m_trailer->m_dict->Get(PDF_NAME_SIZE);
+		if (pSize && pSize->m_type == PDF_OBJ_INTEGER
+			&& pSize->m_value > 0 && pSize->m_value <= m_file->Length())
+			(void) m_objects.Reserve(pSize->m_value);
+
 		// okay, now we have the trailer dictionary, lets check for some important keys
-		pdfInteger *pInt = (pdfInteger *)m_trailer->m_dict->m_entries[wxT("XRefStm")];
+		pdfInteger *pInt = (pdfInteger *)m_trailer->m_dict->Get(PDF_NAME_XREFSTM);
 		if (pInt && pInt->m_type == PDF_OBJ_INTEGER)
 		{
 			if (pInt->m_value >= m_file->Length())
@@ -287,7 +297,7 @@ bool pdf::DissectTrailer(void)
 		}
 
 		// if the Prev key exists, it represents the offset where we'll find a traditional xref table
-		pInt = (pdfInteger *)m_trailer->m_dict->m_entries[wxT("Prev")];
+		pInt = (pdfInteger *)m_trailer->m_dict->Get(PDF_NAME_PREV);
 		if (pInt && pInt->m_type == PDF_OBJ_INTEGER)
 		{
 			if (pInt->m_value >= m_file->Length())
@@ -299,7 +309,6 @@ bool pdf::DissectTrailer(void)
 	else
 		wxLogWarning(wxT("%s: No trailer dictionary was found!"), wxT("DissectTrailer"));
 
-	m_file->Seek(oldoff);
 	return true;
 }
 
@@ -321,15 +330,14 @@ bool pdf::DissectXref(wxFileOffset offset)
 		return false;
 	}
 
-	wxFileOffset oldoff = m_file->Seek(offset);
-	if (oldoff == wxInvalidOffset)
+	wxByte *p = (wxByte *)m_file->View(offset, 0);
+	if (!p)
 	{
-		wxLogError(wxT("%s: Failed to seek for xref table!"), wxT("DissectXref"));
+		wxLogError(wxT("%s: Offset 0x%x is out of range for xref table!"), wxT("DissectXref"), offset);
 		return false;
 	}
 
 	wxByte *base = m_file->GetBaseAddress();
-	wxByte *p = m_file->GetAddress();
 	size_t slen, len = m_file->Length();
 	wxByte *end = base + len;
 
@@ -344,7 +352,6 @@ bool pdf::DissectXref(wxFileOffset offset)
 		else
 			wxLogError(wxT("%s: Did not find an xref table or stream @ 0x%x!"), wxT("DissectXref"), offset);
 
-		m_file->Seek(oldoff);
 		return ret;
 	}
 
@@ -368,7 +375,6 @@ bool pdf::DissectXref(wxFileOffset offset)
 		if (!parse_two_integers(p_first, slen, &first_obj, NULL, &p_1end, &num_ents, &p_2nd, &p_2end))
 		{
 			wxLogError(wxT("%s: Unable to parse subsection in the xref table @ 0x%x!"), wxT("DissectXref"), p_first - base);
-			m_file->Seek(oldoff);
 			return false;
 		}
 
@@ -387,7 +393,7 @@ bool pdf::DissectXref(wxFileOffset offset)
 		// now try to read the specified number of regular entries
 #if 0
 	// quickly check the trailer dictionary "Size" element
-	pdfInteger *pTD = (pdfInteger *)m_trailer->m_dict->m_entries[wxT("Size")];
+	pdfInteger *pTD = (pdfInteger *)m_trailer->m_dict->Get(PDF_NAME_SIZE);
 	if (pTD && pTD->m_type == PDF_OBJ_INTEGER && pTD->m_value > 0)
 		num_ents = pTD->m_value;
 #endif
@@ -480,34 +486,11 @@ bool pdf::DissectXref(wxFileOffset offset)
 				strType = wxT("In-Use");
 				m_tree->SetItemText(entry_id, wxString::Format(wxT("Entry %u - Object %u %u"), n, next_obj, generation));
 				id = m_tree->AppendItem(entry_id, wxString::Format(wxT("Offset: 0x%x"), nnn), -1, -1, new fdTIData(off, 10));
+				if (!m_objects.Find(next_obj, generation, nnn))
 				{
-					wxString key = wxString::Format(wxT("%u %u"), next_obj, generation);
-					pdfObjectList *pOL = (pdfObjectList *)m_objects[key];
-					if (!pOL)
-					{
-						m_objects[key] = pOL = new pdfObjectList();
-						pOL->Append(new pdfIndirect(next_obj, nnn, generation));
-					}
-					else
-					{
-						bool found = false;
-						pdfObjectList::iterator pli = pOL->begin();
-						pdfObjectList::iterator ple = pOL->end();
-						for (; pli != ple; ++pli)
-						{
-							pdfIndirect *pInd = (pdfIndirect *)*pli;
-							if (pInd->m_offset == nnn)
-							{
-								found = true;
-								break;
-							}
-						}
-						if (!found)
-						{
-							wxLogWarning(wxT("%s(%u %u): Object number already defined!"), wxT("DissectXref"), next_obj, generation);
-							pOL->Append(new pdfIndirect(next_obj, nnn, generation));
-						}
-					}
+					if (m_objects.Find(next_obj, generation))
+						wxLogWarning(wxT("%s(%lu %lu): Object number already defined!"), wxT("DissectXref"), next_obj, generation);
+					(void) m_objects.Add(next_obj, nnn, generation);
 				}
 				break;
 
@@ -537,7 +520,6 @@ bool pdf::DissectXref(wxFileOffset offset)
 	// set the item data for the xref table
 	m_tree->SetItemData(m_xref_id, new fdTIData(offset, p_xref_end - p_xref));
 
-	m_file->Seek(oldoff);
 	return true;
 }
 
@@ -549,11 +531,10 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 		m_xref_id = m_tree->AppendItem(m_root_id, wxT("Xref"));
 
 	// maybe its an xrefstm ?
-	pdfIndirect *xref_obj = new pdfIndirect(0xffffffff, ptr - base, 0xffffffff);
+	pdfIndirect *xref_obj = new (m_arena) pdfIndirect(0xffffffff, ptr - base, 0xffffffff);
 	if (!ReadIndirect(xref_obj))
 	{
 		wxLogError(wxT("%s: Did not find an xref table or stream @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
@@ -563,7 +544,6 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 	if (!DissectData(xrefstm_id, xref_obj))
 	{
 		wxLogError(wxT("%s: Unable to dissect xref stream data @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 	
@@ -575,93 +555,86 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 	if (!xref_obj->m_dict)
 	{
 		wxLogError(wxT("%s: Xref stream did not contain a dictionary @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 	if (!xref_obj->m_stream)
 	{
 		wxLogError(wxT("%s: Xref stream did not contain a stream @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
-	pdfName *pType = (pdfName *)xref_obj->m_dict->m_entries[wxT("Type")];
+	pdfName *pType = (pdfName *)xref_obj->m_dict->Get(PDF_NAME_TYPE);
 	if (!pType)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary did not contain a \"/Type\" key @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 	if (pType->m_type != PDF_OBJ_NAME)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Type\" key was not a name value @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
-	if (pType->m_value != wxT("XRef"))
+	if (pType->m_name != PDF_NAME_XREF)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Type\" key was not \"XRef\" @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
 	// ok, we know for sure that is an xref stream now, lets try to get the other required entries
-	pdfInteger *sz = (pdfInteger *)xref_obj->m_dict->m_entries[wxT("Size")];
+	pdfInteger *sz = (pdfInteger *)xref_obj->m_dict->Get(PDF_NAME_SIZE);
 	if (!sz || sz->m_type != PDF_OBJ_INTEGER)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Size\" key was not an integer @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
-	pdfArray *fmt = (pdfArray *)xref_obj->m_dict->m_entries[wxT("W")];
+	pdfArray *fmt = (pdfArray *)xref_obj->m_dict->Get(PDF_NAME_W);
 	if (!fmt || fmt->m_type != PDF_OBJ_ARRAY)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"W\" key was not an array @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
-	if (fmt->m_list.size() != 3)
+	if (fmt->m_count != 3)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"W\" key did not contain three elements @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
 	// optional members
-	pdfArray *idx = (pdfArray *)xref_obj->m_dict->m_entries[wxT("Index")];
+	pdfArray *idx = (pdfArray *)xref_obj->m_dict->Get(PDF_NAME_INDEX);
 	if (idx && idx->m_type != PDF_OBJ_ARRAY)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Index\" key was not an array @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
-	pdfInteger *prev = (pdfInteger *)xref_obj->m_dict->m_entries[wxT("Prev")];
+	if (idx && idx->m_count < 2)
+	{
+		wxLogError(wxT("%s: Xref stream dictionary \"Index\" key has fewer than two elements @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
+		return false;
+	}
+	pdfInteger *prev = (pdfInteger *)xref_obj->m_dict->Get(PDF_NAME_PREV);
 	if (prev && prev->m_type != PDF_OBJ_INTEGER)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Prev\" key was not an integer @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
 	// ok, whatever table 3.15 (xref stream dict) entries we have check out..
 
 	// figure out how to decode
-	pdfDictionary *pDP = (pdfDictionary *)xref_obj->m_dict->m_entries[wxT("DecodeParms")];
+	pdfDictionary *pDP = (pdfDictionary *)xref_obj->m_dict->Get(PDF_NAME_DECODEPARMS);
 	if (!pDP)
-		pDP = (pdfDictionary *)xref_obj->m_dict->m_entries[wxT("DP")];
+		pDP = (pdfDictionary *)xref_obj->m_dict->Get(PDF_NAME_DP);
 	if (pDP && pDP->m_type != PDF_OBJ_DICTIONARY)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"DecodeParms\" key was not a dictionary @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
-	pdfName *pFilter = (pdfName *)xref_obj->m_dict->m_entries[wxT("Filter")];
+	pdfName *pFilter = (pdfName *)xref_obj->m_dict->Get(PDF_NAME_FILTER);
 	if (pFilter && pFilter->m_type != PDF_OBJ_NAME)
 	{
 		wxLogError(wxT("%s: Xref stream dictionary \"Filter\" key was not a name @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-		delete xref_obj;
 		return false;
 	}
 
@@ -669,24 +642,22 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 	wxInputStream *p_in = new wxMemoryInputStream((const char *)xref_obj->m_stream->m_ptr, xref_obj->m_stream->m_len);
 
 	// flate decoded?
-	if (pFilter && pFilter->m_value == wxT("FlateDecode"))
+	if (pFilter && pFilter->m_name == PDF_NAME_FLATEDECODE)
 		p_in = new wxZlibInputStream(p_in, wxZLIB_ZLIB);
 
 	if (pDP)
 	{
-		pdfInteger *pCols = (pdfInteger *)pDP->m_entries[wxT("Columns")];
+		pdfInteger *pCols = (pdfInteger *)pDP->Get(PDF_NAME_COLUMNS);
 		if (!pCols || pCols->m_type != PDF_OBJ_INTEGER)
 		{
 			wxLogError(wxT("%s: Xref stream dictionary \"DecodeParms\" key has illegal \"Columns\" key @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-			delete xref_obj;
 			return false;
 		}
 
-		pdfInteger *pPredictor = (pdfInteger *)pDP->m_entries[wxT("Predictor")];
+		pdfInteger *pPredictor = (pdfInteger *)pDP->Get(PDF_NAME_PREDICTOR);
 		if (!pPredictor || pPredictor->m_type != PDF_OBJ_INTEGER)
 		{
 			wxLogError(wxT("%s: Xref stream dictionary \"DecodeParms\" key has illegal \"Predictor\" key @ 0x%x!"), wxT("DissectXref"), xref_obj->m_offset);
-			delete xref_obj;
 			return false;
 		}
 
@@ -699,27 +670,28 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 	if (idx)
 	{
 		// XXX: need to check if these are indeed integers!
-		pdfInteger *pStart = (pdfInteger *)idx->m_list[0];
+		pdfInteger *pStart = (pdfInteger *)idx->m_items[0];
 		first_obj = pStart->m_value;
-		pdfInteger *pEnd = (pdfInteger *)idx->m_list[1];
+		pdfInteger *pEnd = (pdfInteger *)idx->m_items[1];
 		cnt = pEnd->m_value;
 	}
 	else
 		cnt = sz->m_value;
+	if (sz->m_value > 0 && sz->m_value <= m_file->Length())
+		(void) m_objects.Reserve(sz->m_value);
 
 	// what follows is a hard-coded 1,2,1 xref table decode.
 	unsigned long j = 0;
-	unsigned long value[3] = { 0 }; // the fmt->m_list was already validated to be exactly 3 entries
+	unsigned long value[3] = { 0 }; // the fmt->m_items was already validated to be exactly 3 entries
 	for (unsigned long i = 0; i < cnt; i++)
 	{
 		wxString strEntry;
 		strEntry = wxString::Format(wxT("Entry %d -"), first_obj + i);
 
-		j = 0;
 		memset(value, 0, sizeof(value));
-		for (pdfObjectList::iterator it = fmt->m_list.begin(), en = fmt->m_list.end(); it != en; ++it, ++j)
+		for (j = 0; j < fmt->m_count; j++)
 		{
-			pdfInteger *pFldSz = (pdfInteger *)*it;
+			pdfInteger *pFldSz = (pdfInteger *)fmt->m_items[j];
 			wxByte buf[4];
 
 			// XXX: TODO: check if its an integer!
@@ -766,33 +738,33 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 		}
 
 		// indirect object
-		if (value[0] == 0x01)
+		if (value[0] == 0x01 && !m_objects.Find(first_obj + i, value[2], value[1]))
+		{
+			if (m_objects.Find(first_obj + i, value[2]))
+				wxLogWarning(wxT("%s(%lu %lu): Object number already defined!"), wxT("DissectTrailer"), first_obj + i, value[2]);
+			(void) m_objects.Add(first_obj + i, value[1], value[2]);
+		}
+
+		// compressed object, value[1] is the object stream and value[2] the index in it
+		if (value[0] == 0x02)
 		{
-			wxString key = wxString::Format(wxT("%u %u"), first_obj + i, value[2]);
-			pdfObjectList *pOL = (pdfObjectList *)m_objects[key];
-			if (!pOL)
+			size_t k, nv = m_objects.Count(first_obj + i);
+			for (k = 0; k < nv; k++)
 			{
-				m_objects[key] = pOL = new pdfObjectList();
-				pOL->Append(new pdfIndirect(first_obj + i, value[1], value[2]));
+				pdfIndirect *pInd = m_objects.Get(first_obj + i, k);
+				if (pInd->m_container == value[1] && pInd->m_container_idx == value[2])
+					break;
 			}
-			else
+			if (k == nv)
 			{
-				bool found = false;
-				pdfObjectList::iterator pli = pOL->begin();
-				pdfObjectList::iterator ple = pOL->end();
-				for (; pli != ple; ++pli)
+				if (m_objects.Find(first_obj + i, 0))
+					wxLogWarning(wxT("%s(%lu %lu): Object number already defined!"), wxT("DissectTrailer"), first_obj + i, 0UL);
+				// (the generation of a compressed object is always zero)
+				pdfIndirect *pInd = m_objects.Add(first_obj + i, 0, 0);
+				if (pInd)
 				{
-					pdfIndirect *pInd = (pdfIndirect *)*pli;
-					if (pInd->m_offset == value[1])
-					{
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-				{
-					wxLogWarning(wxT("%s(%u %u): Object number already defined!"), wxT("DissectTrailer"), first_obj + i, value[2]);
-					pOL->Append(new pdfIndirect(first_obj + i, value[1], value[2]));
+					pInd->m_container = value[1];
+					pInd->m_container_idx = value[2];
 				}
 			}
 		}
@@ -811,52 +783,143 @@ bool pdf::DissectXrefStm(wxByte *ptr, wxByte *base)
 
 	// everything must have been good, clean up and return true
 	delete p_in;
-	delete xref_obj; // we don't need this object because we'll end up reading it again...
 	return true;
 }
 
 
-bool pdf::DissectObjects(void)
+/*
+ * add every "N G obj" the index found that the xref(s) didn't already give us.
+ * this is the whole object table when the xref is broken or missing, and it
+ * picks up objects that were left out of an otherwise good one.
+ */
+bool pdf::RecoverObjects(void)
 {
-	m_indobj_id = m_tree->AppendItem(m_root_id, wxT("Indirect Objects")); // no offset assoicated
+	unsigned long added = 0;
+	size_t i, n = m_index.HeaderCount();
 
-	for (pdfObjectsHashMap::iterator oi = m_objects.begin(); 
-		oi != m_objects.end();
-		oi++)
+	for (i = 0; i < n; i++)
 	{
-		pdfObjectList *pOL = (pdfObjectList *)oi->second;
-		if (!pOL) // skip empty elements
-			continue;
+		const pdfObjHeader *ph = m_index.GetHeader(i);
 
-		for (pdfObjectList::iterator oli = pOL->begin();
-			oli != pOL->end();
-			++oli)
+		// xref offsets needn't point right at the number, so compare
+		// the "obj" each one leads to
+		bool found = false;
+		size_t j, nv = m_objects.Count(ph->m_number);
+		for (j = 0; j < nv; j++)
 		{
-			pdfIndirect *pObj = (pdfIndirect *)*oli;
-			if (pObj->m_type != PDF_OBJ_INDIRECT)
-				continue;
+			pdfIndirect *pInd = m_objects.Get(ph->m_number, j);
+			if (pInd->m_generation == ph->m_generation
+				&& m_index.Next(PDF_TOK_OBJ, pInd->m_offset, pInd->m_offset + PDF_OBJ_HEADER_MAX) == ph->m_obj)
+			{
+				found = true;
+				break;
+			}
+		}
+		if (found)
+			continue;
 
-			pObj->m_id = m_tree->AppendItem(m_indobj_id, wxString::Format(wxT("Object %u %u"), pObj->m_number, pObj->m_generation));
+		if (m_objects.Add(ph->m_number, (unsigned long)ph->m_offset, ph->m_generation))
+			added++;
+	}
 
-			if (!ReadIndirect(pObj))
-				continue;
+	if (added)
+		wxLogWarning(wxT("%s: Found %lu objects that are not in the xref"), wxT("RecoverObjects"), added);
+	return true;
+}
 
-			m_tree->SetItemData(pObj->m_id, new fdTIData(pObj->m_offset, pObj->m_length));
 
-			if (!DissectData(pObj->m_id, pObj))
+bool pdf::DissectObjects(void)
+{
+	m_indobj_id = m_tree->AppendItem(m_root_id, wxT("Indirect Objects")); // no offset assoicated
+
+	// the table is in object number order, so the tree comes out sorted
+	size_t num, nobjs = m_objects.Size();
+	for (num = 0; num < nobjs; num++)
+	{
+		size_t i, nv = m_objects.Count(num);
+		for (i = 0; i < nv; i++)
+		{
+			pdfIndirect *pObj = m_objects.Get(num, i);
+
+			pObj->m_id = m_tree->AppendItem(m_indobj_id, wxString::Format(wxT("Object %lu %lu"), pObj->m_number, pObj->m_generation));
+
+			// compressed objects wait until somebody opens them, by then
+			// every object stream has been read
+			if (pObj->m_container != 0xffffffff && i < (1 << PDF_LAZY_IDX_BITS))
+			{
+				m_tree->SetItemExpander(pObj->m_id, this, PDF_LAZY_COOKIE(num, i, PDF_LAZY_OBJECT));
 				continue;
+			}
 
-			if (pObj->m_stream)
-				(void) DissectStream(pObj);
+			DissectIndirect(pObj);
 		}
 	}
 
-	// XXX: TODO: can we sort numerically instead of lexigraphically?
-	m_tree->SortChildren(m_indobj_id);
 	return true;
 }
 
 
+void pdf::DissectIndirect(pdfIndirect *pObj)
+{
+	// what LoadObjStm parsed has no nodes, start over
+	if (pObj->m_offtree)
+	{
+		pObj->m_dict = NULL;
+		pObj->m_stream = NULL;
+		pObj->m_obj = NULL;
+		pObj->m_offtree = false;
+	}
+
+	if (!LoadIndirect(pObj))
+		return;
+
+	m_tree->SetItemData(pObj->m_id, DataRange(pObj, m_file->GetBaseAddress() + pObj->m_offset, pObj->m_length));
+
+	if (!DissectData(pObj->m_id, pObj))
+		return;
+
+	if (pObj->m_stream)
+		(void) DissectStream(pObj);
+}
+
+
+void pdf::ExpandNode(fileDissectNodes *nodes, const wxTreeItemId &id, wxUIntPtr cookie)
+{
+	unsigned long num = (unsigned long)(cookie >> (PDF_LAZY_IDX_BITS + 1));
+	size_t idx = (size_t)(cookie >> 1) & ((1 << PDF_LAZY_IDX_BITS) - 1);
+
+	// the file may have been closed since the node was made
+	if (idx >= m_objects.Count(num))
+		return;
+	pdfIndirect *pObj = m_objects.Get(num, idx);
+
+	// the dissection routines all append through m_tree
+	fileDissectNodes *tree = m_tree;
+	m_tree = nodes;
+	switch (cookie & 1)
+	{
+		case PDF_LAZY_OBJECT:
+			if (pObj->m_id == id)
+				DissectIndirect(pObj);
+			break;
+
+		case PDF_LAZY_STREAM:
+			if (pObj->m_stream && pObj->m_stream->m_id == id)
+				(void) DissectDecoded(pObj);
+			break;
+	}
+	m_tree = tree;
+}
+
+
+bool pdf::LoadIndirect(pdfIndirect *pObj)
+{
+	if (pObj->m_container != 0xffffffff)
+		return ReadCompressed(pObj);
+	return ReadIndirect(pObj);
+}
+
+
 bool pdf::ReadIndirect(pdfIndirect *pObj)
 {
 	// beware, calling this on a 'free' object is naughty.
@@ -868,29 +931,29 @@ bool pdf::ReadIndirect(pdfIndirect *pObj)
 		return false;
 	}
 
-	wxFileOffset oldoff = m_file->Seek(pObj->m_offset);
-	if (oldoff == wxInvalidOffset)
+	wxByte *p = (wxByte *)m_file->View(pObj->m_offset, 0);
+	if (!p)
 	{
-		wxLogError(wxT("%s: Failed to seek for object #%u at 0x%x!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
+		wxLogError(wxT("%s: Object #%u at 0x%x is out of range!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
 		return false;
 	}
 
 	// look for the beginning of the indirect object
-	wxByte *p = m_file->GetAddress();
-	wxByte *p_start = m_file->FindString("obj");
-	if (!p_start)
+	// (the "N G obj" line is short, don't go looking all the way to EOF)
+	wxByte *base = m_file->GetBaseAddress();
+	wxFileOffset off = m_index.Next(PDF_TOK_OBJ, pObj->m_offset, pObj->m_offset + PDF_OBJ_HEADER_MAX);
+	if (off == wxInvalidOffset)
 	{
 		wxLogError(wxT("%s: Failed to find \"obj\" (object #%u at 0x%x)!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
-		m_file->Seek(oldoff);
 		return false;
 	}
+	wxByte *p_start = base + off;
 
 	// try to parse the numbers
 	size_t len = p_start - p;
 	if (len < 4)
 	{
 		wxLogError(wxT("%s: Malformed object line (object #%u at 0x%x)!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
-		m_file->Seek(oldoff);
 		return false;
 	}
 
@@ -900,7 +963,6 @@ bool pdf::ReadIndirect(pdfIndirect *pObj)
 	if (!parse_two_integers(p, p_start - p, &num, NULL, &p_1end, &gen, &p_2nd, &p_2end))
 	{
 		wxLogError(wxT("%s: Unable to parse object number (object #%u at 0x%x)!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
-		m_file->Seek(oldoff);
 		return false;
 	}
 
@@ -908,19 +970,18 @@ bool pdf::ReadIndirect(pdfIndirect *pObj)
 	if (memcmp(p_2end, " obj", 4) != 0)
 	{
 		wxLogError(wxT("%s: \"obj\" does not follow generation (object #%u at 0x%x)!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
-		m_file->Seek(oldoff);
 		return false;
 	}
 
 	// look for endobj
 	// XXX: this is very error prone
-	wxByte *pEnd = m_file->FindString("endobj");
-	if (!pEnd)
+	off = m_index.Next(PDF_TOK_ENDOBJ, p_2end - base);
+	if (off == wxInvalidOffset)
 	{
 		wxLogError(wxT("%s: Unable to find \"endobj\" (object #%u at 0x%x)!"), wxT("ReadObject"), pObj->m_number, pObj->m_offset);
-		m_file->Seek(oldoff);
 		return false;
 	}
+	wxByte *pEnd = base + off;
 
 	// double-check the numbers if they were known coming in!
 	if (pObj->m_number != 0xffffffff)
@@ -951,23 +1012,183 @@ bool pdf::ReadIndirect(pdfIndirect *pObj)
 		pObj->m_data = pDataStart;
 	}
 
-	m_file->Seek(oldoff);
 	return true;
 }
 
 
-static inline wxByte decode_hex_nibble(wxByte *p)
+/*
+ * find a compressed object in its object stream. the stream is decoded (or
+ * taken from the cache) and its header read the first time, then the object's
+ * bytes are copied out, since everything parsed from them points into them
+ * and the cache can let go of the stream whenever it likes.
+ */
+bool pdf::ReadCompressed(pdfIndirect *pObj)
+{
+	// already got it (probably for a /Length)
+	if (pObj->m_data)
+		return true;
+
+	// object streams are normally read by the time their objects are wanted,
+	// but a /Length can point into one that comes later in the file
+	pdfIndirect *pStm = m_objects.Find(pObj->m_container, 0);
+	if (pStm && !pStm->m_stream && !pStm->m_dict && !pStm->m_offtree)
+		(void) LoadObjStm(pStm);
+	if (!pStm || !pStm->m_stream || !pStm->m_dict)
+	{
+		wxLogError(wxT("%s: Object stream #%lu has not been read (object #%lu)!"), wxT("ReadCompressed"), pObj->m_container, pObj->m_number);
+		return false;
+	}
+
+	size_t len;
+	const wxByte *data = StreamData(pStm, &len);
+	if (!data)
+		return false;
+	if (!pStm->m_objstm && !IndexObjStm(pStm, data, len))
+		return false;
+
+	pdfObjStmIndex *pIdx = pStm->m_objstm;
+	unsigned long idx = pObj->m_container_idx;
+	if (idx >= pIdx->m_count)
+	{
+		wxLogError(wxT("%s: Object stream #%lu has no object at index %lu (object #%lu)!"), wxT("ReadCompressed"), pObj->m_container, idx, pObj->m_number);
+		return false;
+	}
+	if (pIdx->m_numbers[idx] != pObj->m_number)
+		wxLogWarning(wxT("%s: Object number does not match object stream #%lu (object #%lu)!"), wxT("ReadCompressed"), pObj->m_container, pObj->m_number);
+
+	// IndexObjStm made sure these are in order and inside the data
+	size_t start = pIdx->m_first + pIdx->m_offsets[idx];
+	size_t stop = len;
+	if (idx + 1 < pIdx->m_count)
+		stop = pIdx->m_first + pIdx->m_offsets[idx + 1];
+
+	wxByte *copy = (wxByte *)m_arena.Alloc(stop - start);
+	if (!copy)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for object #%lu!"), wxT("ReadCompressed"), pObj->m_number);
+		return false;
+	}
+	memcpy(copy, data + start, stop - start);
+
+	pObj->m_data = copy;
+	pObj->m_datalen = stop - start;
+	pObj->m_length = stop - start;
+	return true;
+}
+
+
+/*
+ * read and parse an object stream ahead of its turn. the parse goes into an
+ * overlay that is thrown away afterwards, so nothing shows up in the tree
+ * yet, and DissectIndirect parses it again when it gets there.
+ */
+bool pdf::LoadObjStm(pdfIndirect *pStm)
+{
+	// an object stream can't be compressed itself
+	if (pStm->m_container != 0xffffffff)
+	{
+		wxLogError(wxT("%s: Object stream #%lu is compressed!"), wxT("LoadObjStm"), pStm->m_number);
+		return false;
+	}
+
+	// whatever happens, don't try this one again
+	pStm->m_offtree = true;
+	if (!ReadIndirect(pStm))
+		return false;
+
+	// nested loads (for a /Length) can share the same overlay
+	if (m_offtree)
+		return DissectData(m_root_id, pStm);
+
+	fileDissectNodes *tree = m_tree;
+	fileDissectNodes scratch(tree);
+	m_tree = &scratch;
+	m_offtree = true;
+	bool ret = DissectData(m_root_id, pStm);
+	m_offtree = false;
+	m_tree = tree;
+	return ret;
+}
+
+
+// read the "N1 off1 N2 off2 ..." header at the start of a decoded object stream
+bool pdf::IndexObjStm(pdfIndirect *pStm, const wxByte *data, size_t len)
 {
-	wxByte b = 0;
-
-	if (*p >= 'a' && *p <= 'f')
-		b = *p - 'a' + 0xa;
-	else if (*p >= 'A' && *p <= 'F')
-		b = *p - 'A' + 0xa;
-	else if (*p >= '0' && *p <= '9')
-		b = *p - '0';
-	// else error!
-	return b;
+	pdfName *pType = (pdfName *)pStm->m_dict->Get(PDF_NAME_TYPE);
+	if (!pType || pType->m_type != PDF_OBJ_NAME || pType->m_name != PDF_NAME_OBJSTM)
+	{
+		wxLogError(wxT("%s: Object #%lu is not an object stream!"), wxT("IndexObjStm"), pStm->m_number);
+		return false;
+	}
+
+	pdfInteger *pN = (pdfInteger *)pStm->m_dict->Get(PDF_NAME_N);
+	pdfInteger *pFirst = (pdfInteger *)pStm->m_dict->Get(PDF_NAME_FIRST);
+	if (!pN || pN->m_type != PDF_OBJ_INTEGER || pN->m_value < 0)
+	{
+		wxLogError(wxT("%s: Object stream dictionary \"N\" key was not a count (object #%lu)!"), wxT("IndexObjStm"), pStm->m_number);
+		return false;
+	}
+	if (!pFirst || pFirst->m_type != PDF_OBJ_INTEGER || pFirst->m_value < 0 || (unsigned long)pFirst->m_value > len)
+	{
+		wxLogError(wxT("%s: Object stream dictionary \"First\" key was not an offset into the data (object #%lu)!"), wxT("IndexObjStm"), pStm->m_number);
+		return false;
+	}
+
+	unsigned long count = pN->m_value;
+	unsigned long first = pFirst->m_value;
+	// every pair takes at least "N O " in the header
+	if (count > first / 4 + 1)
+	{
+		wxLogError(wxT("%s: Object stream header is too short for %lu objects (object #%lu)!"), wxT("IndexObjStm"), count, pStm->m_number);
+		return false;
+	}
+
+	pdfObjStmIndex *pIdx = (pdfObjStmIndex *)m_arena.Alloc(sizeof(pdfObjStmIndex));
+	unsigned long *values = (unsigned long *)m_arena.Alloc((count ? count : 1) * 2 * sizeof(unsigned long));
+	if (!pIdx || !values)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for object stream #%lu!"), wxT("IndexObjStm"), pStm->m_number);
+		return false;
+	}
+	pIdx->m_count = count;
+	pIdx->m_first = first;
+	pIdx->m_numbers = values;
+	pIdx->m_offsets = values + count;
+
+	const wxByte *p = data, *end = data + first;
+	unsigned long i;
+	for (i = 0; i < count * 2; i++)
+	{
+		while (p < end && memchr(PDF_WHITESPACE_CHARS, *p, PDF_WHITESPACE_CHARSLEN))
+			p++;
+		const wxByte *mark = p;
+		unsigned long v = 0;
+		while (p < end && *p >= '0' && *p <= '9' && p - mark < 10)
+			v = v * 10 + (*p++ - '0');
+		if (p == mark)
+		{
+			wxLogError(wxT("%s: Malformed object stream header (object #%lu)!"), wxT("IndexObjStm"), pStm->m_number);
+			return false;
+		}
+
+		if (i & 1)
+			pIdx->m_offsets[i / 2] = v;
+		else
+			pIdx->m_numbers[i / 2] = v;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (pIdx->m_offsets[i] > len - first
+			|| (i > 0 && pIdx->m_offsets[i] < pIdx->m_offsets[i - 1]))
+		{
+			wxLogError(wxT("%s: Object stream offset for object #%lu is out of order or range (object #%lu)!"), wxT("IndexObjStm"), pIdx->m_numbers[i], pStm->m_number);
+			return false;
+		}
+	}
+
+	pStm->m_objstm = pIdx;
+	return true;
 }
 
 
@@ -1005,7 +1226,6 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 	wxByte *beg = pObj->m_data;
 	wxByte *end = pObj->m_data + pObj->m_datalen;
 	wxByte *p_token, *p = beg;
-	wxByte *base = m_file->GetBaseAddress();
 	
 	// XXX: TODO: FIX/REMOVE THIS BIG NASTY FKN HACK.
 	if (pObj->m_obj)
@@ -1020,7 +1240,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 #else
 		// just create a new item data (probably faster than moving it...)
 		wxTreeItemId id = m_tree->AppendItem(parent, wxString::Format(wxT("%u"), pInt->m_value), -1, -1, 
-			new fdTIData(pInt->m_ptr - base, pInt->m_len));
+			DataRange(pObj, pInt->m_ptr, pInt->m_len));
 #endif
 		m_tree->Delete(pInt->m_id);
 		pInt->m_id = id;
@@ -1030,7 +1250,8 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 	// for tracking which container we're in
 	wxTreeItemId new_node;
 	pdfObjectList conts;
-	pdfObjectBase *cur_cont = new pdfObjectBase(parent, pObj->m_ptr);
+	pdfObjectBase root(parent, pObj->m_ptr);
+	pdfObjectBase *cur_cont = &root;
 	pdfObjectBase *cur_obj;
 	bool got_value;
 
@@ -1066,7 +1287,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 
 				// push the current container since we're becoming a new one
 				conts.push_back(cur_cont);
-				cur_cont = new pdfDictionary(new_node, p - 2);
+				cur_cont = new (m_arena) pdfDictionary(new_node, p - 2);
 				continue; // don't need to post-process this token
 			}
 			else
@@ -1074,9 +1295,6 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				// hexadecimal string object
 				p++;
 				p_token = p;
-				str = wxT("");
-				int b = -1;
-				// need to put the content somewhere...
 				while (p < end && !got_value)
 				{
 					if (*p == '>')
@@ -1086,27 +1304,6 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 						got_value = true;
 						break;
 					}
-
-					if ((*p >= 'A' && *p <= 'F') ||
-						(*p >= 'a' && *p <= 'f') ||
-						(*p >= '0' && *p <= '9'))
-					{
-						if (b == -1)
-							b = decode_hex_nibble(p) << 4;
-						else
-						{
-							b |= decode_hex_nibble(p);
-							str += b;
-							b = -1;
-						}
-					}
-
-					// what should we do when we get something invalid?
-					// -- we'll ignore for now...
-#if 0
-					if (!memchr(PDF_WHITESPACE_CHARS, *p, PDF_WHITESPACE_CHARSLEN))
-						// ??
-#endif
 					p++;
 				}
 
@@ -1118,10 +1315,6 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				}
 				else
 				{
-					// we might have half a byte left over..
-					if (b != -1)
-						str += b;
-
 					size_t len = 0;
 					if (p > p_token)
 						len = p - 1 - p_token;
@@ -1130,12 +1323,9 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 					// XXX: it would be nice to put a sanitized version of the decoded string instead
 					new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Hex String: %s"), 
 						wxString::From8BitData((const char *)p_token, len)), -1, -1,
-						new fdTIData(p_token - base, len));
+						DataRange(pObj, p_token, len));
 
-					// here we store the original value in ->m_value and the decoded stuff in ->m_decoded
-					pdfHexString *pHex = new pdfHexString(new_node, p_token, len);
-					cur_obj = pHex;
-					pHex->m_decoded = str;
+					cur_obj = new (m_arena) pdfHexString(new_node, p_token, len);
 				}
 			}
 			break;
@@ -1149,7 +1339,10 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				// set the array node length and item data
 				cur_cont->m_len = p - cur_cont->m_ptr;
 				cur_obj = cur_cont;
-				m_tree->SetItemData(cur_cont->m_id, new fdTIData(cur_cont->m_ptr - base, cur_cont->m_len));
+				m_tree->SetItemData(cur_cont->m_id, DataRange(pObj, cur_cont->m_ptr, cur_cont->m_len));
+				// all the keys are in, sort them for lookups
+				if (cur_cont->m_type == PDF_OBJ_DICTIONARY)
+					((pdfDictionary *)cur_cont)->Seal();
 				// pop out of thise container
 				cur_cont = conts.back();
 				conts.pop_back();
@@ -1195,10 +1388,10 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 					if (p > p_token)
 						len = p - 1 - p_token;
 
-					pdfLiteral *pLit = new pdfLiteral(new_node, p_token, len); // wrong node for now
+					pdfLiteral *pLit = new (m_arena) pdfLiteral(new_node, p_token, len); // wrong node for now
 					cur_obj = pLit;
-					new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Literal String: %s"), pLit->m_value.c_str()), -1, -1, 
-						new fdTIData(p_token - base, len));
+					new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Literal String: %s"), pLit->GetValue().c_str()), -1, -1, 
+						DataRange(pObj, p_token, len));
 					cur_obj->m_id = new_node;
 					got_value = true;
 				}
@@ -1229,10 +1422,10 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 			if (p >= p_token)
 			{
 				size_t len = p - p_token;
-				pdfName *pName = new pdfName(new_node, p_token, len);
+				pdfName *pName = new (m_arena) pdfName(new_node, p_token, len, m_names.Intern(p_token, len));
 				cur_obj = pName;
-				new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Name: %s"), pName->m_value.c_str()), -1, -1, 
-					new fdTIData(p_token - base, len));
+				new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Name: %s"), pName->GetValue().c_str()), -1, -1, 
+					DataRange(pObj, p_token, len));
 				pName->m_id = new_node;
 				
 				// push a container for this item if we're inside a dictionary
@@ -1254,7 +1447,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 
 			// push the current container since we're becoming a new one
 			conts.push_back(cur_cont);
-			cur_cont = new pdfArray(new_node, p - 1);
+			cur_cont = new (m_arena) pdfArray(new_node, p - 1);
 			continue; // don't need to post-process this token
 			break;
 
@@ -1269,7 +1462,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 			// set the array node length and item data
 			cur_cont->m_len = p - cur_cont->m_ptr;
 			cur_obj = cur_cont;
-			m_tree->SetItemData(cur_cont->m_id, new fdTIData(cur_cont->m_ptr - base, cur_cont->m_len));
+			m_tree->SetItemData(cur_cont->m_id, DataRange(pObj, cur_cont->m_ptr, cur_cont->m_len));
 			// pop out from this container
 			cur_cont = conts.back();
 			conts.pop_back();
@@ -1319,7 +1512,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				if (pObj->m_dict && cur_cont->m_type == PDF_OBJ_BASE)
 				{
 					// This is REQUIRED! However, if we dont get it, we'll try to detect the length..
-					pLen = (pdfInteger *)pObj->m_dict->m_entries[wxT("Length")];
+					pLen = (pdfInteger *)pObj->m_dict->Get(PDF_NAME_LENGTH);
 					if (!pLen || (pLen->m_type != PDF_OBJ_INTEGER && pLen->m_type != PDF_OBJ_REFERENCE))
 					{
 						wxLogWarning(wxT("%s(%u %u): Object does not contain \"Length\" key for stream!"), wxT("DissectData"), pObj->m_number, pObj->m_generation);
@@ -1331,18 +1524,19 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 						if (pLen->m_type == PDF_OBJ_REFERENCE)
 						{
 							pdfReference *pRef = (pdfReference *)pLen;
-							wxString key = wxString::Format(wxT("%u %u"), pRef->m_refnum, pRef->m_refgen);
-							pdfObjectList *pOL = m_objects[key];
-							if (pOL)
+							pdfIndirect *pInd = m_objects.Find(pRef->m_refnum, pRef->m_refgen);
+							if (pInd)
 							{
-								pdfIndirect *pInd = (pdfIndirect *)pOL->front();
 								// maybe its there but hasn't been read in yet, lets go get it
 								if (!pInd->m_obj)
 								{
-									if (!ReadIndirect(pInd))
+									if (!LoadIndirect(pInd))
 										continue;
 									if (!DissectData(m_root_id, pInd))
 										continue;
+									// its node went with the overlay
+									if (m_offtree)
+										pInd->m_offtree = true;
 								}
 								pdfInteger *pInt = (pdfInteger *)pInd->m_obj;
 								if (!pInt || pInt->m_type != PDF_OBJ_INTEGER)
@@ -1409,9 +1603,9 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				else if (!pLen)
 					wxLogWarning(wxT("%s(%u %u): Detected stream length to be %u bytes!"), wxT("DissectData"), pObj->m_number, pObj->m_generation, len);
 
-				pdfStream *pStm = new pdfStream(new_node, p_token, len);
+				pdfStream *pStm = new (m_arena) pdfStream(new_node, p_token, len);
 				cur_obj = pStm;
-				new_node = m_tree->AppendItem(cur_cont->m_id, wxT("Stream Data"), -1, -1, new fdTIData(p_token - base, len));
+				new_node = m_tree->AppendItem(cur_cont->m_id, wxT("Stream Data"), -1, -1, DataRange(pObj, p_token, len));
 				pStm->m_id = new_node;
 
 				p += 9; // skip "endstream"
@@ -1427,13 +1621,13 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				got_value = true;
 				if (memcmp(p_token, "null", 4) == 0)
 				{
-					new_node = m_tree->AppendItem(cur_cont->m_id, wxT("null"), -1, -1, new fdTIData(p_token - base, 4));
-					cur_obj = new pdfNull(new_node, p_token, 4);
+					new_node = m_tree->AppendItem(cur_cont->m_id, wxT("null"), -1, -1, DataRange(pObj, p_token, 4));
+					cur_obj = new (m_arena) pdfNull(new_node, p_token, 4);
 				}
 				else if (memcmp(p_token, "true", 4) == 0)
 				{
-					new_node = m_tree->AppendItem(cur_cont->m_id, wxT("Boolean: True"), -1, -1, new fdTIData(p_token - base, 4));
-					pdfBoolean *pBool = new pdfBoolean(new_node, p_token, 4);
+					new_node = m_tree->AppendItem(cur_cont->m_id, wxT("Boolean: True"), -1, -1, DataRange(pObj, p_token, 4));
+					pdfBoolean *pBool = new (m_arena) pdfBoolean(new_node, p_token, 4);
 					pBool->m_value = true;
 					cur_obj = pBool;
 				}
@@ -1447,8 +1641,8 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 			// how about false?
 			if (len >= 5 && memcmp(p_token, "false", 5) == 0)
 			{
-				m_tree->AppendItem(cur_cont->m_id, wxT("Boolean: False"), -1, -1, new fdTIData(p_token - base, 5));
-				pdfBoolean *pBool = new pdfBoolean(new_node, p_token, 4);
+				m_tree->AppendItem(cur_cont->m_id, wxT("Boolean: False"), -1, -1, DataRange(pObj, p_token, 5));
+				pdfBoolean *pBool = new (m_arena) pdfBoolean(new_node, p_token, 4);
 				pBool->m_value = false;
 				cur_obj = pBool;
 				got_value = true;
@@ -1468,8 +1662,8 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 				{
 					double d = strtod((char *)p_token, NULL);
 					size_t len2 = p - p_token;
-					new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Real: %g"), d), -1, -1, new fdTIData(p_token - base, len2));
-					pdfReal *pReal = new pdfReal(new_node, p_token, len2);
+					new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Real: %g"), d), -1, -1, DataRange(pObj, p_token, len2));
+					pdfReal *pReal = new (m_arena) pdfReal(new_node, p_token, len2);
 					pReal->m_value = d;
 					cur_obj = pReal;
 					got_value = true;
@@ -1494,8 +1688,8 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 						len = p - p_token;
 						str = wxString::From8BitData((const char *)p_token, len);
 						new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Reference: %s"), str.c_str()), -1, -1, 
-							new fdTIData(p_token - base, len));
-						pdfReference *pRef = new pdfReference(new_node, p_token, len);
+							DataRange(pObj, p_token, len));
+						pdfReference *pRef = new (m_arena) pdfReference(new_node, p_token, len);
 						pRef->m_refnum = num1;
 						pRef->m_refgen = strtol((char *)p_numend + 1, NULL, 10);
 						cur_obj = pRef;
@@ -1506,8 +1700,8 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 
 				// otherwise, we just process the first number
 				len = p - p_token;
-				new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Integer: %ld"), num1), -1, -1, new fdTIData(p_token - base, len));
-				pdfInteger *pInt = new pdfInteger(new_node, p_token, len);
+				new_node = m_tree->AppendItem(cur_cont->m_id, wxString::Format(wxT("Integer: %ld"), num1), -1, -1, DataRange(pObj, p_token, len));
+				pdfInteger *pInt = new (m_arena) pdfInteger(new_node, p_token, len);
 				pInt->m_value = num1;
 				cur_obj = pInt;
 				got_value = true;
@@ -1545,7 +1739,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 		case PDF_OBJ_ARRAY:
 			{
 				pdfArray *pCont = (pdfArray *)cur_cont;
-				pCont->m_list.Append(cur_obj);
+				(void) pCont->Add(m_arena, cur_obj);
 			}
 			break;
 
@@ -1564,10 +1758,7 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 						wxLogError(wxT("%s(%u %u): Dictionary erroneously contains a non-name entry!"), wxT("DissectData"), pObj->m_number, pObj->m_generation);
 #endif
 					pdfDictionary *pDict = (pdfDictionary *)cur_cont;
-					if (pDict->m_entries[pName->m_value])
-						pDict->m_entries.erase(pName->m_value);
-					pDict->m_entries[pName->m_value] = cur_obj;
-					delete pName;
+					(void) pDict->Add(m_arena, pName->m_name, cur_obj);
 				}
 				else
 					wxLogError(wxT("%s(%u %u): A name was treated as a container when not inside a dictionary!"), wxT("DissectData"), pObj->m_number, pObj->m_generation);
@@ -1612,18 +1803,11 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 		}
 	}
 
-	if (cur_cont && cur_cont->m_type == PDF_OBJ_BASE)
-		delete cur_cont;
-
+	// (the containers themselves belong to the arena)
 	if (conts.size() > 0)
 	{
 		wxLogWarning(wxT("%s(%u %u): Containers remain on the container stack!"), wxT("DissectData"), pObj->m_number, pObj->m_generation);
-		while (conts.size() > 0)
-		{
-			cur_cont = conts.back();
-			conts.pop_back();
-			delete cur_cont;
-		}
+		conts.clear();
 		return false;
 	}
 
@@ -1633,15 +1817,64 @@ bool pdf::DissectData(wxTreeItemId &parent, pdfIndirect *pObj)
 
 bool pdf::DissectStream(pdfIndirect *pObj)
 {
-	pdfStream *pStm = pObj->m_stream;
-
-	// decode stream data
-	wxInputStream *p_in = new wxMemoryInputStream((const char *)pStm->m_ptr, pStm->m_len);
-
 	// NOTE: XRefStm and XRef objects have already been processed before,
 	// but we process them again for completeness. They only real down side 
 	// here is that they end up occurring multiple times in the tree.
-	// figure out how to decode
+	if (!ReadFilters(pObj))
+		return false;
+
+	// decoding waits until the node is opened
+	size_t i, nv = m_objects.Count(pObj->m_number);
+	for (i = 0; i < nv; i++)
+	{
+		if (m_objects.Get(pObj->m_number, i) == pObj)
+			break;
+	}
+	if (i < nv && i < (1 << PDF_LAZY_IDX_BITS))
+	{
+		m_tree->SetItemExpander(pObj->m_stream->m_id, this, PDF_LAZY_COOKIE(pObj->m_number, i, PDF_LAZY_STREAM));
+		return true;
+	}
+	return DissectDecoded(pObj);
+}
+
+
+// what there is to show of the decoded data
+bool pdf::DissectDecoded(pdfIndirect *pObj)
+{
+	size_t len;
+	if (!StreamData(pObj, &len))
+		return false;
+	m_tree->AppendItem(pObj->m_stream->m_id, wxString::Format(wxT("Length: %lu"), (unsigned long)len));
+	return true;
+}
+
+
+// a stream's decoded data, decoding it only if the cache doesn't have it.
+// the pointer is good until the next StreamData call
+const wxByte *pdf::StreamData(pdfIndirect *pObj, size_t *plen)
+{
+	const wxByte *data = m_streams.Get(pObj, plen);
+	if (data)
+		return data;
+
+	wxByte *buf;
+	size_t len;
+	if (!DecodeStream(pObj, &buf, &len))
+		return NULL;
+	data = m_streams.Put(pObj, buf, len);
+	if (data && plen)
+		*plen = len;
+	return data;
+}
+
+
+// fill in the stream's filter chain from its dictionary
+bool pdf::ReadFilters(pdfIndirect *pObj)
+{
+	pdfStream *pStm = pObj->m_stream;
+	if (pStm->m_chain)
+		return true;
 
 	// This object must have a dictionary in order to have any filters or predictors, etc
 	if (pObj->m_dict)
@@ -1649,82 +1882,124 @@ bool pdf::DissectStream(pdfIndirect *pObj)
 		// XXX: TODO: support an array of filters / decode parms dictionarys
 
 		// See if we have Decode Parameters
-		pdfDictionary *pDP = (pdfDictionary *)pObj->m_dict->m_entries[wxT("DecodeParms")];
+		pdfDictionary *pDP = (pdfDictionary *)pObj->m_dict->Get(PDF_NAME_DECODEPARMS);
 		if (!pDP)
-			pDP = (pdfDictionary *)pObj->m_dict->m_entries[wxT("DP")];
+			pDP = (pdfDictionary *)pObj->m_dict->Get(PDF_NAME_DP);
 		if (pDP && pDP->m_type != PDF_OBJ_DICTIONARY)
 		{
 			wxLogError(wxT("%s: Stream dictionary \"DecodeParms\" key was not a dictionary @ 0x%x!"), wxT("DissectStream"), pObj->m_offset);
-			delete pObj;
 			return false;
 		}
 
 		// See if we have any filters set
-		pdfName *pFilter = (pdfName *)pObj->m_dict->m_entries[wxT("Filter")];
-		if (pFilter)
+		pdfName *pFilter = (pdfName *)pObj->m_dict->Get(PDF_NAME_FILTER);
+		if (pFilter && pFilter->m_type != PDF_OBJ_NAME)
 		{
-			if (pFilter->m_type != PDF_OBJ_NAME)
-			{
-				wxLogError(wxT("%s: Stream dictionary \"Filter\" key was not a name @ 0x%x!"), wxT("DissectStream"), pObj->m_offset);
-				delete pObj;
-				return false;
-			}
-
-			// flate decoded?
-			if (pFilter->m_value == wxT("FlateDecode"))
-				p_in = new wxZlibInputStream(p_in, wxZLIB_ZLIB);
+			wxLogError(wxT("%s: Stream dictionary \"Filter\" key was not a name @ 0x%x!"), wxT("DissectStream"), pObj->m_offset);
+			return false;
 		}
 
 		// If we have a predictor set, we need to pipe the stream data through the proper predictor
 		if (pDP)
 		{
-			pdfInteger *pCols = (pdfInteger *)pDP->m_entries[wxT("Columns")];
+			pdfInteger *pCols = (pdfInteger *)pDP->Get(PDF_NAME_COLUMNS);
 			if (!pCols || pCols->m_type != PDF_OBJ_INTEGER)
 			{
 				wxLogError(wxT("%s: Xref stream dictionary \"DecodeParms\" key has illegal \"Columns\" key @ 0x%x!"), wxT("DissectStream"), pObj->m_offset);
-				delete pObj;
 				return false;
 			}
 
-			pdfInteger *pPredictor = (pdfInteger *)pDP->m_entries[wxT("Predictor")];
+			pdfInteger *pPredictor = (pdfInteger *)pDP->Get(PDF_NAME_PREDICTOR);
 			if (!pPredictor || pPredictor->m_type != PDF_OBJ_INTEGER)
 			{
 				wxLogError(wxT("%s: Xref stream dictionary \"DecodeParms\" key has illegal \"Predictor\" key @ 0x%x!"), wxT("DissectStream"), pObj->m_offset);
-				delete pObj;
 				return false;
 			}
 
 			if (pPredictor->m_value != 0x0c)
 				wxLogWarning(wxT("%s(%u %u): Unsupported predictor 0x%x!"), wxT("DissectStream"), pObj->m_number, pObj->m_generation, pPredictor->m_value);
 
-			p_in = new pdfPredInputStream(p_in, pPredictor->m_value, pCols->m_value);
+			pStm->m_predictor = pPredictor->m_value;
+			pStm->m_columns = pCols->m_value;
 		}
+
+		if (pFilter)
+			pStm->m_filter = pFilter->m_name;
 	}
 
-	// read all the data into the memory output stream for this stream
-	p_in->Read(pStm->m_decoded);
-	m_tree->AppendItem(pStm->m_id, wxString::Format(wxT("Length: %u"), pStm->m_decoded.GetLength()));
+	pStm->m_chain = true;
+	return true;
+}
 
-	// we wont do it this way, since its uber slow.
-#if 0
-	// now we have an auto-magic stack of stream filters that will give us raw data when we read.
-	pStm->m_decoded.Empty();
-	while (!p_in->Eof())
+
+// run a stream through its filters into a buffer from malloc
+bool pdf::DecodeStream(pdfIndirect *pObj, wxByte **pdata, size_t *plen)
+{
+	pdfStream *pStm = pObj->m_stream;
+	if (!ReadFilters(pObj))
+		return false;
+
+	// now build an auto-magic stack of stream filters that gives us raw data when we read
+	wxInputStream *p_in = new wxMemoryInputStream((const char *)pStm->m_ptr, pStm->m_len);
+	// flate decoded?
+	if (pStm->m_filter == PDF_NAME_FLATEDECODE)
+		p_in = new wxZlibInputStream(p_in, wxZLIB_ZLIB);
+	if (pStm->m_predictor)
+		p_in = new pdfPredInputStream(p_in, pStm->m_predictor, pStm->m_columns);
+
+	// read it all, growing the buffer as we go
+	size_t len = 0, max = pStm->m_len + 4096;
+	wxByte *buf = (wxByte *)malloc(max);
+	while (buf)
 	{
-		wxByte byte;
-		p_in->Read(&byte, 1);
-		pStm->m_decoded += byte;
+		if (len == max)
+		{
+			wxByte *tmp = (wxByte *)realloc(buf, max * 2);
+			if (!tmp)
+			{
+				free(buf);
+				buf = NULL;
+				break;
+			}
+			buf = tmp;
+			max *= 2;
+		}
+
+		p_in->Read(buf + len, max - len);
+		if (p_in->LastRead() == 0)
+			break;
+		len += p_in->LastRead();
 	}
+	delete p_in;
 
-	// we don't have an offset for this because its the result of uber decode
-	m_tree->AppendItem(pStm->m_id, pStm->m_decoded);
-#endif
+	if (!buf)
+	{
+		wxLogError(wxT("%s(%lu %lu): Unable to allocate memory for the decoded stream!"), wxT("DissectStream"), pObj->m_number, pObj->m_generation);
+		return false;
+	}
 
-	delete p_in;
+	*pdata = buf;
+	*plen = len;
 	return true;
 }
 
 
+// the bytes a node stands for. compressed objects aren't in the file as such,
+// so everything in one points at the data of its object stream instead
+fdTIData *pdf::DataRange(pdfIndirect *pObj, wxByte *ptr, size_t len)
+{
+	wxByte *base = m_file->GetBaseAddress();
+
+	if (pObj->m_container == 0xffffffff)
+		return new fdTIData(ptr - base, len);
+
+	pdfIndirect *pStm = m_objects.Find(pObj->m_container, 0);
+	if (!pStm || !pStm->m_stream)
+		return NULL;
+	return new fdTIData(pStm->m_stream->m_ptr - base, pStm->m_stream->m_len);
+}
+
+
 static wxByte *read_line_fwd(wxByte *str, size_t len, wxByte **ptr, size_t *plen)
 {
 	wxByte *p = *ptr;
@@ -12,20 +12,33 @@
 #include "pdf_defs.h" // portable document format
 
 #include "pdfObjects.h"
+#include "pdfStreamCache.h"
+#include "pdfTokenIndex.h"
 
+// what a lazy node holds, the low bit of the expander cookie. the rest is the
+// object number and which of that number's objects it is
+#define PDF_LAZY_OBJECT			0
+#define PDF_LAZY_STREAM			1
+#define PDF_LAZY_IDX_BITS		7
+#define PDF_LAZY_COOKIE(num, idx, kind) \
+	(((((wxUIntPtr)(num) << PDF_LAZY_IDX_BITS) | (idx)) << 1) | (kind))
 
-class pdf : public fileDissectPlugin
+
+class pdf : public fileDissectPlugin, public fileDissectExpander
 {
 public:
-	pdf(wxLog *plog, fileDissectTreeCtrl *tree);
+	pdf(wxLog *plog, fileDissectNodes *tree);
 	~pdf(void);
 
 	// plugin member functions
-	bool SupportsExtension(const wxChar *extension);
 	void Dissect(void);
 	void CloseFile(void);
 	void Destroy(void);
 
+	// compressed objects are only unpacked, and streams only decoded, when
+	// their node is opened
+	void ExpandNode(fileDissectNodes *nodes, const wxTreeItemId &id, wxUIntPtr cookie);
+
 private:
 	void DestroyFileData(void);
 	void InitFileData(void);
@@ -36,25 +49,47 @@ private:
 	wxTreeItemId m_xref_id;
 	wxTreeItemId m_indobj_id;
 
-	// PDF data items
-	pdfObjectsHashMap m_objects;
+	// PDF data items, all of which live in m_arena
+	pdfArena m_arena;
+	pdfNameTable m_names;
+	pdfObjectTable m_objects;
 	wxFileOffset m_xref_off;
 
+	// where the keywords are, built once per file
+	pdfTokenIndex m_index;
+
+	// decoded streams, keyed by their pdfIndirect
+	pdfStreamCache m_streams;
+
 	// we use an indirect object here even though thats not *EXACTLY* what a trailer is...
 	pdfIndirect *m_trailer;
 
+	// set while LoadObjStm parses into a throwaway tree
+	bool m_offtree;
+
 	// additional dissection routines
 	bool DissectHeader(void);
 	bool DissectTrailer(void);
 	bool DissectXref(wxFileOffset offset = wxInvalidOffset);
 	bool DissectXrefStm(wxByte *ptr, wxByte *base);
+	bool RecoverObjects(void);
 	bool DissectObjects(void);
+	void DissectIndirect(pdfIndirect *pObj);
 	bool DissectStream(pdfIndirect *pObj);
+	bool DissectDecoded(pdfIndirect *pObj);
 
 	bool DissectData(wxTreeItemId &parent, pdfIndirect *pObj);
+	fdTIData *DataRange(pdfIndirect *pObj, wxByte *ptr, size_t len);
 
 	// private file format functionality
+	bool LoadIndirect(pdfIndirect *pObj);
 	bool ReadIndirect(pdfIndirect *pObj);
+	bool ReadCompressed(pdfIndirect *pObj);
+	bool LoadObjStm(pdfIndirect *pStm);
+	bool IndexObjStm(pdfIndirect *pStm, const wxByte *data, size_t len);
+	bool ReadFilters(pdfIndirect *pObj);
+	bool DecodeStream(pdfIndirect *pObj, wxByte **pdata, size_t *plen);
+	const wxByte *StreamData(pdfIndirect *pObj, size_t *plen);
 };
 
 #endif
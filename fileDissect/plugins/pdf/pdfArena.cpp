@@ -0,0 +1,118 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfArena.cpp:
+ * implementation for pdfArena class
+ */
+#include "pdfArena.h"
+
+#define PDF_ARENA_ROUND(x)	(((x) + PDF_ARENA_ALIGN - 1) & ~((size_t)PDF_ARENA_ALIGN - 1))
+// the block header, rounded so the first allocation is aligned too
+#define PDF_ARENA_HDR		PDF_ARENA_ROUND(sizeof(pdfArenaBlock))
+
+
+pdfArena::pdfArena(void)
+{
+	m_blocks = NULL;
+	m_cur = m_end = m_last = NULL;
+}
+
+pdfArena::~pdfArena(void)
+{
+	Reset();
+	if (m_blocks)
+		free(m_blocks);
+}
+
+
+bool pdfArena::NewBlock(size_t size)
+{
+	pdfArenaBlock *pb = (pdfArenaBlock *)malloc(PDF_ARENA_HDR + size);
+	if (!pb)
+		return false;
+	pb->m_size = size;
+	pb->m_next = m_blocks;
+	m_blocks = pb;
+	m_cur = (wxByte *)pb + PDF_ARENA_HDR;
+	m_end = m_cur + size;
+	return true;
+}
+
+
+void *pdfArena::Alloc(size_t size)
+{
+	wxByte *ret;
+
+	if (!size)
+		size = 1;
+	size = PDF_ARENA_ROUND(size);
+	if (size > (size_t)(m_end - m_cur))
+	{
+		// big ones get a block of their own, linked in behind the current
+		// one so what's left of it is still used
+		if (size > PDF_ARENA_BLOCK / 4 && m_blocks)
+		{
+			pdfArenaBlock *pb = (pdfArenaBlock *)malloc(PDF_ARENA_HDR + size);
+			if (!pb)
+				return NULL;
+			pb->m_size = size;
+			pb->m_next = m_blocks->m_next;
+			m_blocks->m_next = pb;
+			return (wxByte *)pb + PDF_ARENA_HDR;
+		}
+		if (!NewBlock(size > PDF_ARENA_BLOCK ? size : PDF_ARENA_BLOCK))
+			return NULL;
+	}
+
+	ret = m_cur;
+	m_cur += size;
+	m_last = ret;
+	return ret;
+}
+
+
+void *pdfArena::Realloc(void *old, size_t oldsize, size_t newsize)
+{
+	if (!old)
+		return Alloc(newsize);
+
+	// the last allocation can just take more of the block
+	if ((wxByte *)old == m_last
+		&& PDF_ARENA_ROUND(newsize) <= (size_t)(m_end - m_last))
+	{
+		m_cur = m_last + PDF_ARENA_ROUND(newsize);
+		return old;
+	}
+
+	void *p = Alloc(newsize);
+	if (p)
+		memcpy(p, old, oldsize < newsize ? oldsize : newsize);
+	return p;
+}
+
+
+void pdfArena::Reset(void)
+{
+	pdfArenaBlock *keep = NULL;
+
+	while (m_blocks)
+	{
+		pdfArenaBlock *next = m_blocks->m_next;
+		// hang on to one ordinary block for the next document
+		if (!keep && m_blocks->m_size == PDF_ARENA_BLOCK)
+			keep = m_blocks;
+		else
+			free(m_blocks);
+		m_blocks = next;
+	}
+
+	m_cur = m_end = m_last = NULL;
+	if (keep)
+	{
+		keep->m_next = NULL;
+		m_blocks = keep;
+		m_cur = (wxByte *)keep + PDF_ARENA_HDR;
+		m_end = m_cur + keep->m_size;
+	}
+}
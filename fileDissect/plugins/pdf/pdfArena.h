@@ -0,0 +1,49 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfArena.h:
+ * class declaration for pdfArena
+ *
+ * everything parsed out of a document comes from here. allocation is a
+ * pointer bump, nothing is ever freed on its own, and closing the file
+ * gives back whole blocks at once.
+ */
+#ifndef __pdfArena_h_
+#define __pdfArena_h_
+
+#include "fileDissect.h"
+
+#define PDF_ARENA_BLOCK		(64 * 1024)
+#define PDF_ARENA_ALIGN		8
+
+
+class pdfArena
+{
+public:
+	pdfArena(void);
+	~pdfArena(void);
+
+	// NULL when out of memory
+	void *Alloc(size_t size);
+	// grow an allocation, in place when it was the last one made
+	void *Realloc(void *old, size_t oldsize, size_t newsize);
+	// forget everything, keeping the first block for the next document
+	void Reset(void);
+
+private:
+	struct pdfArenaBlock
+	{
+		pdfArenaBlock *m_next;
+		size_t m_size;
+	};
+
+	bool NewBlock(size_t size);
+
+	pdfArenaBlock *m_blocks;
+	wxByte *m_cur;
+	wxByte *m_end;
+	wxByte *m_last;
+};
+
+#endif
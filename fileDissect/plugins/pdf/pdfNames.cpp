@@ -0,0 +1,132 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfNames.cpp:
+ * implementation for pdfNameTable class
+ */
+#include "pdfNames.h"
+
+// in pdfNameId order
+static const char *pdf_predefined_names[] =
+{
+	"Columns",
+	"DecodeParms",
+	"DP",
+	"Filter",
+	"First",
+	"FlateDecode",
+	"Index",
+	"Length",
+	"N",
+	"ObjStm",
+	"Predictor",
+	"Prev",
+	"Size",
+	"Type",
+	"W",
+	"XRef",
+	"XRefStm",
+	NULL
+};
+
+
+// FNV-1a
+static wxUint32 pdf_name_hash(const wxByte *ptr, size_t len)
+{
+	wxUint32 h = 2166136261U;
+	size_t i;
+
+	for (i = 0; i < len; i++)
+	{
+		h ^= ptr[i];
+		h *= 16777619U;
+	}
+	return h;
+}
+
+
+pdfNameTable::pdfNameTable(void)
+{
+	m_table = NULL;
+	m_size = 0;
+	m_count = 0;
+	m_next = PDF_NAME_NONE + 1;
+	Clear();
+}
+
+pdfNameTable::~pdfNameTable(void)
+{
+	if (m_table)
+		free(m_table);
+}
+
+
+void pdfNameTable::Clear(void)
+{
+	int i;
+
+	if (m_table)
+		memset(m_table, 0, m_size * sizeof(pdfNameEntry));
+	m_count = 0;
+	m_next = PDF_NAME_NONE + 1;
+
+	for (i = 0; pdf_predefined_names[i]; i++)
+		(void) Intern((const wxByte *)pdf_predefined_names[i], strlen(pdf_predefined_names[i]));
+}
+
+
+bool pdfNameTable::Grow(void)
+{
+	size_t i, size = m_size ? m_size * 2 : 64;
+	pdfNameEntry *table = (pdfNameEntry *)calloc(size, sizeof(pdfNameEntry));
+	if (!table)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for the name table"), wxT("pdfNameTable::Grow()"));
+		return false;
+	}
+
+	// rehash
+	for (i = 0; i < m_size; i++)
+	{
+		pdfNameEntry *pe = m_table + i;
+		if (pe->m_id == PDF_NAME_NONE)
+			continue;
+		size_t j = pe->m_hash & (size - 1);
+		while (table[j].m_id != PDF_NAME_NONE)
+			j = (j + 1) & (size - 1);
+		table[j] = *pe;
+	}
+
+	if (m_table)
+		free(m_table);
+	m_table = table;
+	m_size = size;
+	return true;
+}
+
+
+wxUint32 pdfNameTable::Intern(const wxByte *ptr, size_t len)
+{
+	// keep it at most half full
+	if ((m_count + 1) * 2 > m_size && !Grow())
+		return PDF_NAME_NONE;
+
+	wxUint32 h = pdf_name_hash(ptr, len);
+	size_t j = h & (m_size - 1);
+	while (m_table[j].m_id != PDF_NAME_NONE)
+	{
+		pdfNameEntry *pe = m_table + j;
+		if (pe->m_hash == h && pe->m_len == len && memcmp(pe->m_ptr, ptr, len) == 0)
+			return pe->m_id;
+		j = (j + 1) & (m_size - 1);
+	}
+
+	pdfNameEntry *pe = m_table + j;
+	pe->m_ptr = ptr;
+	pe->m_len = len;
+	pe->m_hash = h;
+	pe->m_id = m_next++;
+	m_count++;
+	return pe->m_id;
+}
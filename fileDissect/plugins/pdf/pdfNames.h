@@ -0,0 +1,71 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfNames.h:
+ * class declaration for pdfNameTable
+ *
+ * every distinct name in a document gets a small integer, so dictionary
+ * keys compare as integers. the names we look up ourselves are entered up
+ * front and always get the ids below.
+ */
+#ifndef __pdfNames_h_
+#define __pdfNames_h_
+
+#include "fileDissect.h"
+
+
+enum pdfNameId
+{
+	PDF_NAME_NONE = 0,
+	PDF_NAME_COLUMNS,
+	PDF_NAME_DECODEPARMS,
+	PDF_NAME_DP,
+	PDF_NAME_FILTER,
+	PDF_NAME_FIRST,
+	PDF_NAME_FLATEDECODE,
+	PDF_NAME_INDEX,
+	PDF_NAME_LENGTH,
+	PDF_NAME_N,
+	PDF_NAME_OBJSTM,
+	PDF_NAME_PREDICTOR,
+	PDF_NAME_PREV,
+	PDF_NAME_SIZE,
+	PDF_NAME_TYPE,
+	PDF_NAME_W,
+	PDF_NAME_XREF,
+	PDF_NAME_XREFSTM,
+	PDF_NAME_PREDEFINED
+};
+
+
+class pdfNameTable
+{
+public:
+	pdfNameTable(void);
+	~pdfNameTable(void);
+
+	// the id for these bytes (without the '/'), PDF_NAME_NONE if out of memory.
+	// the bytes must stay put until Clear, they usually live in the mapping
+	wxUint32 Intern(const wxByte *ptr, size_t len);
+	// back to just the predefined names
+	void Clear(void);
+
+private:
+	struct pdfNameEntry
+	{
+		const wxByte *m_ptr;
+		size_t m_len;
+		wxUint32 m_hash;
+		wxUint32 m_id;		// PDF_NAME_NONE for an empty slot
+	};
+
+	bool Grow(void);
+
+	pdfNameEntry *m_table;
+	size_t m_size;			// a power of two
+	size_t m_count;
+	wxUint32 m_next;
+};
+
+#endif
@@ -6,6 +6,7 @@
  * implementation for pdfObject class
  */
 #include "pdfObjects.h"
+#include <stdlib.h> // qsort
 
 #include <wx/listimpl.cpp>
 WX_DEFINE_LIST(pdfObjectList);
@@ -35,30 +36,103 @@ pdfObjectBase::pdfObjectBase(wxTreeItemId &id, wxByte *ptr, size_t len)
 }
 
 
-pdfArray::~pdfArray(void)
+bool pdfArray::Add(pdfArena &arena, pdfObjectBase *pObj)
 {
-	pdfObjectList::iterator it, en;
-    for (it = m_list.begin(), en = m_list.end(); it != en; ++it)
-		Delete(*it);
-	m_list.clear();
+	if (m_count == m_max)
+	{
+		size_t max = m_max ? m_max * 2 : 8;
+		pdfObjectBase **items = (pdfObjectBase **)arena.Realloc(m_items,
+			m_max * sizeof(pdfObjectBase *), max * sizeof(pdfObjectBase *));
+		if (!items)
+			return false;
+		m_items = items;
+		m_max = max;
+	}
+	m_items[m_count++] = pObj;
+	return true;
 }
 
 
-pdfDictionary::~pdfDictionary(void)
+bool pdfDictionary::Add(pdfArena &arena, wxUint32 name, pdfObjectBase *value)
 {
-	pdfDictHashMap::iterator it = m_entries.begin();
-	pdfDictHashMap::iterator en = m_entries.end();
-    for (; it != en; ++it)
-	{
-		pdfObjectBase *pObj = (pdfObjectBase *)it->second;
-		// For some reason, wxHashMap creates keys with NULL values whenever
-		// you access an element that didn't exist. We can't delete NULL
-		// so we just skip them..
-		if (!pObj)
-			continue;
-		Delete(pObj);
-	}
-	m_entries.clear();
+	if (m_count == m_max)
+	{
+		size_t max = m_max ? m_max * 2 : 8;
+		pdfDictEntry *entries = (pdfDictEntry *)arena.Realloc(m_entries,
+			m_max * sizeof(pdfDictEntry), max * sizeof(pdfDictEntry));
+		if (!entries)
+			return false;
+		m_entries = entries;
+		m_max = max;
+	}
+	pdfDictEntry *pe = m_entries + m_count;
+	pe->m_name = name;
+	pe->m_seq = (wxUint32)m_count;
+	pe->m_value = value;
+	m_count++;
+	m_sealed = false;
+	return true;
+}
+
+
+static int pdf_dict_entry_cmp(const void *a, const void *b)
+{
+	const pdfDictEntry *pa = (const pdfDictEntry *)a;
+	const pdfDictEntry *pb = (const pdfDictEntry *)b;
+
+	if (pa->m_name != pb->m_name)
+		return pa->m_name < pb->m_name ? -1 : 1;
+	if (pa->m_seq != pb->m_seq)
+		return pa->m_seq < pb->m_seq ? -1 : 1;
+	return 0;
+}
+
+// sort by name, and of any duplicate keys keep the last one like a viewer would
+void pdfDictionary::Seal(void)
+{
+	size_t i, n = 0;
+
+	if (m_count > 1)
+	{
+		qsort(m_entries, m_count, sizeof(pdfDictEntry), pdf_dict_entry_cmp);
+		for (i = 0; i < m_count; i++)
+		{
+			if (i + 1 < m_count && m_entries[i + 1].m_name == m_entries[i].m_name)
+				continue;
+			m_entries[n++] = m_entries[i];
+		}
+		m_count = n;
+	}
+	m_sealed = true;
+}
+
+
+pdfObjectBase *pdfDictionary::Get(wxUint32 name) const
+{
+	if (!m_sealed)
+	{
+		size_t i = m_count;
+		while (i > 0)
+		{
+			i--;
+			if (m_entries[i].m_name == name)
+				return m_entries[i].m_value;
+		}
+		return NULL;
+	}
+
+	size_t lo = 0, hi = m_count;
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (m_entries[mid].m_name < name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < m_count && m_entries[lo].m_name == name)
+		return m_entries[lo].m_value;
+	return NULL;
 }
 
 
@@ -79,69 +153,149 @@ pdfIndirect::pdfIndirect(unsigned long num, unsigned long offset, unsigned long
 	m_dict = 0;
 	m_stream = 0;
 	m_obj = 0;
+
+	m_container = 0xffffffff;
+	m_container_idx = 0;
+	m_objstm = 0;
+	m_offtree = false;
+}
+
+
+
+pdfObjectTable::pdfObjectTable(pdfArena *arena)
+{
+	m_arena = arena;
+	m_slots = NULL;
+	m_nSlots = 0;
+	m_limit = PDF_MAX_OBJECTS + 1;
+}
+
+pdfObjectTable::~pdfObjectTable(void)
+{
+	Clear();
+}
+
+
+void pdfObjectTable::Clear(void)
+{
+	size_t i;
+
+	for (i = 0; i < m_nSlots; i++)
+	{
+		if (m_slots[i].m_more)
+			free(m_slots[i].m_more);
+	}
+	if (m_slots)
+		free(m_slots);
+	m_slots = NULL;
+	m_nSlots = 0;
+	m_limit = PDF_MAX_OBJECTS + 1;
+}
+
+
+void pdfObjectTable::SetLimit(wxFileOffset limit)
+{
+	if (limit < 0 || limit > PDF_MAX_OBJECTS + 1)
+		limit = PDF_MAX_OBJECTS + 1;
+	m_limit = (unsigned long)limit;
+}
+
+
+bool pdfObjectTable::Reserve(unsigned long count)
+{
+	if (count <= m_nSlots)
+		return true;
+	if (count > m_limit)
+	{
+		wxLogError(wxT("%s: Object count %lu is over the limit of %lu!"), wxT("pdfObjectTable::Reserve()"), count, m_limit - 1);
+		return false;
+	}
+
+	pdfObjectSlot *slots = (pdfObjectSlot *)realloc(m_slots, count * sizeof(pdfObjectSlot));
+	if (!slots)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for %lu objects"), wxT("pdfObjectTable::Reserve()"), count);
+		return false;
+	}
+	memset(slots + m_nSlots, 0, (count - m_nSlots) * sizeof(pdfObjectSlot));
+	m_slots = slots;
+	m_nSlots = count;
+	return true;
 }
 
-pdfIndirect::~pdfIndirect(void)
-{
-	if (m_dict)
-		delete m_dict;
-	if (m_stream)
-		delete m_stream;
-	if (m_obj)
-		pdfObjectBase::Delete(m_obj);
-}
-
-
-void pdfObjectBase::Delete(pdfObjectBase *pObj)
-{
-	switch (pObj->m_type)
-	{
-	case PDF_OBJ_STREAM:
-		delete (pdfStream *)pObj;
-		break;
-
-	case PDF_OBJ_DICTIONARY:
-		delete (pdfDictionary *)pObj;
-		break;
-
-	case PDF_OBJ_INDIRECT:
-		delete (pdfIndirect *)pObj;
-		break;
-
-	case PDF_OBJ_ARRAY:
-		delete (pdfArray *)pObj;
-		break;
-
-	case PDF_OBJ_LITERAL:
-		delete (pdfLiteral *)pObj;
-		break;
-
-	case PDF_OBJ_HEXSTRING:
-		delete (pdfHexString *)pObj;
-		break;
-
-	case PDF_OBJ_REFERENCE:
-		delete (pdfReference *)pObj;
-		break;
-
-	case PDF_OBJ_NAME:
-		delete (pdfName *)pObj;
-		break;
-
-	case PDF_OBJ_REAL:
-		delete (pdfReal *)pObj;
-		break;
-
-	case PDF_OBJ_INTEGER:
-		delete (pdfInteger *)pObj;
-		break;
-
-	case PDF_OBJ_BOOLEAN:
-		delete (pdfBoolean *)pObj;
-		break;
-
-	case PDF_OBJ_NULL:
-		delete (pdfNull *)pObj;
-		break;
-	}
+
+pdfIndirect *pdfObjectTable::Add(unsigned long num, unsigned long offset, unsigned long generation)
+{
+	if (num >= m_nSlots)
+	{
+		// grow geometrically, files that lie about /Size shouldn't cost a realloc per object
+		unsigned long count = (unsigned long)m_nSlots * 2;
+		if (count <= num)
+			count = num + 1;
+		if (count > m_limit)
+			count = m_limit;
+		if (num >= count || !Reserve(count))
+		{
+			wxLogWarning(wxT("%s: Ignoring object %lu %lu, the number is out of range!"), wxT("pdfObjectTable::Add()"), num, generation);
+			return NULL;
+		}
+	}
+
+	pdfObjectSlot *ps = m_slots + num;
+	pdfIndirect *pObj = new (*m_arena) pdfIndirect(num, offset, generation);
+	if (!ps->m_obj)
+	{
+		ps->m_obj = pObj;
+		return pObj;
+	}
+
+	pdfIndirect **more = (pdfIndirect **)realloc(ps->m_more, (ps->m_nMore + 1) * sizeof(pdfIndirect *));
+	if (!more)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for object %lu %lu"), wxT("pdfObjectTable::Add()"), num, generation);
+		return NULL;
+	}
+	more[ps->m_nMore++] = pObj;
+	ps->m_more = more;
+	return pObj;
+}
+
+
+size_t pdfObjectTable::Size(void) const
+{
+	return m_nSlots;
+}
+
+
+size_t pdfObjectTable::Count(unsigned long num) const
+{
+	if (num >= m_nSlots || !m_slots[num].m_obj)
+		return 0;
+	return 1 + m_slots[num].m_nMore;
+}
+
+
+pdfIndirect *pdfObjectTable::Get(unsigned long num, size_t idx) const
+{
+	if (idx >= Count(num))
+		return NULL;
+	if (idx == 0)
+		return m_slots[num].m_obj;
+	return m_slots[num].m_more[idx - 1];
+}
+
+
+pdfIndirect *pdfObjectTable::Find(unsigned long num, unsigned long generation, wxFileOffset offset) const
+{
+	size_t i, n = Count(num);
+
+	for (i = 0; i < n; i++)
+	{
+		pdfIndirect *pObj = Get(num, i);
+		if (pObj->m_generation != generation)
+			continue;
+		if (offset == wxInvalidOffset || pObj->m_offset == offset)
+			return pObj;
+	}
+	return NULL;
 }
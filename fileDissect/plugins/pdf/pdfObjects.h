@@ -9,14 +9,18 @@
 #define __pdfObject_h_
 
 #include "fileDissect.h"
+#include <new>
 #include <wx/string.h>
 #include <wx/treectrl.h>
-#include <wx/mstream.h>
 
 #include "pdf_defs.h"
+#include "pdfArena.h"
+#include "pdfNames.h"
 
 
-// this defines the most basic pdf object
+// this defines the most basic pdf object. objects are made in the document's
+// arena with "new (arena) pdfXxx(...)" and are never deleted on their own, so
+// nothing derived from this may own memory that needs a destructor.
 class pdfObjectBase
 {
 public:
@@ -24,7 +28,21 @@ public:
 	pdfObjectBase(wxTreeItemId &id, wxByte *ptr);
 	pdfObjectBase(wxTreeItemId &id, wxByte *ptr, size_t len);
 
-	static void Delete(pdfObjectBase *pObj);
+	void *operator new(size_t size, pdfArena &arena)
+	{
+		// fail the same way plain new would
+		void *p = arena.Alloc(size);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	};
+	void operator delete(void *, pdfArena &)
+	{
+	};
+	// the arena frees everything, there is nothing to do for a single object
+	void operator delete(void *)
+	{
+	};
 
 	// internal object type, refers to PDF_OBJ_xxx macros
 	pdfObjType m_type;
@@ -44,36 +62,72 @@ public:
 	pdfStream(wxTreeItemId &id, wxByte *ptr) : pdfObjectBase(id, ptr)
 	{
 		m_type = PDF_OBJ_STREAM;
+		m_chain = false;
+		m_filter = PDF_NAME_NONE;
+		m_predictor = m_columns = 0;
 	};
 	pdfStream(wxTreeItemId &id, wxByte *ptr, size_t len) : pdfObjectBase(id, ptr, len)
 	{
 		m_type = PDF_OBJ_STREAM;
+		m_chain = false;
+		m_filter = PDF_NAME_NONE;
+		m_predictor = m_columns = 0;
 	};
 
-	wxMemoryOutputStream m_decoded;
+	// the filter chain, taken from the stream dictionary. that's all that is
+	// kept, the data is decoded whenever somebody wants it (see pdf::StreamData)
+	bool m_chain;			// the ones below have been filled in
+	wxUint32 m_filter;		// PDF_NAME_NONE if there isn't one
+	long m_predictor;		// 0 if there isn't one
+	long m_columns;
 };
 
 
-#include <wx/hashmap.h>
-WX_DECLARE_STRING_HASH_MAP(pdfObjectBase *, pdfDictHashMap);
+// dictionaries are a flat array of (name id, value). entries are appended
+// while parsing and sorted once the dictionary is closed, after which lookups
+// are a binary search. (until then they're a scan, and the last one wins)
+struct pdfDictEntry
+{
+	wxUint32 m_name;
+	wxUint32 m_seq;		// keeps duplicate keys in file order while sorting
+	pdfObjectBase *m_value;
+};
 
 class pdfDictionary : public pdfObjectBase
 {
 public:
-	~pdfDictionary(void);
 	pdfDictionary(wxTreeItemId &id, wxByte *ptr) : pdfObjectBase(id, ptr)
 	{
 		m_type = PDF_OBJ_DICTIONARY;
+		m_entries = NULL;
+		m_count = m_max = 0;
+		m_sealed = false;
 	};
 
-	pdfDictHashMap m_entries;
+	bool Add(pdfArena &arena, wxUint32 name, pdfObjectBase *value);
+	void Seal(void);
+	pdfObjectBase *Get(wxUint32 name) const;
+
+	pdfDictEntry *m_entries;
+	size_t m_count;
+	size_t m_max;
+	bool m_sealed;
+};
+
+
+// the header of a decoded object stream (/Type /ObjStm), "N1 off1 N2 off2 ..."
+struct pdfObjStmIndex
+{
+	unsigned long m_count;		// /N
+	unsigned long m_first;		// /First, where the objects start
+	unsigned long *m_numbers;
+	unsigned long *m_offsets;	// from m_first
 };
 
 
 class pdfIndirect : public pdfObjectBase
 {
 public:
-	~pdfIndirect(void);
 	pdfIndirect(unsigned long num, unsigned long offset, unsigned long generation);
 
 	// for processing
@@ -94,6 +148,15 @@ public:
 	pdfDictionary *m_dict;
 	pdfObjectBase *m_obj;
 	pdfStream *m_stream;
+
+	// compressed objects (xref type 2) live in another object's stream,
+	// m_container is 0xffffffff for everything else
+	unsigned long m_container;
+	unsigned long m_container_idx;
+	// set on an object stream the first time it is decoded
+	pdfObjStmIndex *m_objstm;
+	// parsed without tree nodes (see LoadObjStm), parse it again to show it
+	bool m_offtree;
 };
 
 
@@ -104,20 +167,66 @@ WX_DECLARE_LIST(pdfObjectBase, pdfObjectList);
 class pdfArray : public pdfObjectBase
 {
 public:
-	~pdfArray(void);
 	pdfArray(wxTreeItemId &id, wxByte *ptr) : pdfObjectBase(id, ptr)
 	{
 		m_type = PDF_OBJ_ARRAY;
+		m_items = NULL;
+		m_count = m_max = 0;
 	};
 
-	pdfObjectList m_list;
+	bool Add(pdfArena &arena, pdfObjectBase *pObj);
+
+	pdfObjectBase **m_items;
+	size_t m_count;
+	size_t m_max;
 };
 
 
-// this one is for storing all objects in the file
-WX_DECLARE_STRING_HASH_MAP(pdfObjectList *, pdfObjectsHashMap);
+// this one is for storing all objects in the file, indexed by object number.
+// nearly every number has one object, so that one sits in the slot itself and
+// any other generations or revisions go in a small array hanging off it.
+struct pdfObjectSlot
+{
+	pdfIndirect *m_obj;
+	pdfIndirect **m_more;
+	size_t m_nMore;
+};
+
+class pdfObjectTable
+{
+public:
+	// the objects themselves come from arena
+	pdfObjectTable(pdfArena *arena);
+	~pdfObjectTable(void);
+
+	// object numbers at or above limit are dropped. every object takes up
+	// at least a byte of the file, so its length is a safe limit
+	void SetLimit(wxFileOffset limit);
+	// make room for object numbers below count (ie. the trailer's /Size)
+	bool Reserve(unsigned long count);
+	// create an object and file it under its number, NULL if out of range
+	pdfIndirect *Add(unsigned long num, unsigned long offset, unsigned long generation);
+	// the objects go when the arena is reset
+	void Clear(void);
+
+	// one more than the highest object number there's room for
+	size_t Size(void) const;
+	// how many objects have this number, and each of them
+	size_t Count(unsigned long num) const;
+	pdfIndirect *Get(unsigned long num, size_t idx) const;
+	// the first num/generation object, or the one at offset if one is given
+	pdfIndirect *Find(unsigned long num, unsigned long generation, wxFileOffset offset = wxInvalidOffset) const;
+
+private:
+	pdfArena *m_arena;
+	pdfObjectSlot *m_slots;
+	size_t m_nSlots;
+	unsigned long m_limit;
+};
 
 
+// strings and names don't copy anything, m_ptr/m_len is the raw text in the
+// mapping (without the delimiters) and these give the text when it's wanted
 class pdfLiteral : public pdfObjectBase
 {
 public:
@@ -128,10 +237,12 @@ public:
 	pdfLiteral(wxTreeItemId &id, wxByte *ptr, size_t len) : pdfObjectBase(id, ptr, len)
 	{
 		m_type = PDF_OBJ_LITERAL;
-		m_value = wxString::From8BitData((const char *)ptr, len);
 	};
 
-	wxString m_value;
+	wxString GetValue(void) const
+	{
+		return wxString::From8BitData((const char *)m_ptr, m_len);
+	};
 };
 
 
@@ -145,11 +256,12 @@ public:
 	pdfHexString(wxTreeItemId &id, wxByte *ptr, size_t len) : pdfObjectBase(id, ptr, len)
 	{
 		m_type = PDF_OBJ_HEXSTRING;
-		m_value.From8BitData((const char *)ptr, len);
 	};
 
-	wxString m_value;
-	wxString m_decoded;
+	wxString GetValue(void) const
+	{
+		return wxString::From8BitData((const char *)m_ptr, m_len);
+	};
 };
 
 
@@ -178,15 +290,21 @@ public:
 	pdfName(wxTreeItemId &id, wxByte *ptr) : pdfObjectBase(id, ptr)
 	{
 		m_type = PDF_OBJ_NAME;
+		m_name = PDF_NAME_NONE;
 	};
-	pdfName(wxTreeItemId &id, wxByte *ptr, size_t len) : pdfObjectBase(id, ptr, len)
+	pdfName(wxTreeItemId &id, wxByte *ptr, size_t len, wxUint32 name) : pdfObjectBase(id, ptr, len)
 	{
 		m_type = PDF_OBJ_NAME;
-		if (len > 0)
-			m_value = wxString::From8BitData((const char *)ptr, len);
+		m_name = name;
+	};
+
+	wxString GetValue(void) const
+	{
+		return wxString::From8BitData((const char *)m_ptr, m_len);
 	};
 
-	wxString m_value;
+	// from the document's pdfNameTable
+	wxUint32 m_name;
 };
 
 
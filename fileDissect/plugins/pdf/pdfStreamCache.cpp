@@ -0,0 +1,115 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfStreamCache.cpp:
+ * implementation for pdfStreamCache class
+ */
+#include "pdfStreamCache.h"
+
+
+pdfStreamCache::pdfStreamCache(size_t budget)
+{
+	m_head = m_tail = NULL;
+	m_bytes = 0;
+	m_budget = budget;
+}
+
+pdfStreamCache::~pdfStreamCache(void)
+{
+	Clear();
+}
+
+
+void pdfStreamCache::Clear(void)
+{
+	while (m_head)
+		Drop(m_head);
+	m_map.clear();
+	m_bytes = 0;
+}
+
+
+void pdfStreamCache::Unlink(pdfCacheEntry *pe)
+{
+	if (pe->m_prev)
+		pe->m_prev->m_next = pe->m_next;
+	else
+		m_head = pe->m_next;
+	if (pe->m_next)
+		pe->m_next->m_prev = pe->m_prev;
+	else
+		m_tail = pe->m_prev;
+	pe->m_prev = pe->m_next = NULL;
+}
+
+
+void pdfStreamCache::Drop(pdfCacheEntry *pe)
+{
+	Unlink(pe);
+	m_map.erase((void *)pe->m_key);
+	m_bytes -= pe->m_len;
+	if (pe->m_data)
+		free(pe->m_data);
+	free(pe);
+}
+
+
+const wxByte *pdfStreamCache::Get(const void *key, size_t *plen)
+{
+	pdfCacheMap::iterator it = m_map.find((void *)key);
+	if (it == m_map.end())
+		return NULL;
+
+	// move it to the front
+	pdfCacheEntry *pe = it->second;
+	if (pe != m_head)
+	{
+		Unlink(pe);
+		pe->m_next = m_head;
+		if (m_head)
+			m_head->m_prev = pe;
+		m_head = pe;
+		if (!m_tail)
+			m_tail = pe;
+	}
+
+	if (plen)
+		*plen = pe->m_len;
+	return pe->m_data;
+}
+
+
+const wxByte *pdfStreamCache::Put(const void *key, wxByte *data, size_t len)
+{
+	pdfCacheMap::iterator it = m_map.find((void *)key);
+	if (it != m_map.end())
+		Drop(it->second);
+
+	pdfCacheEntry *pe = (pdfCacheEntry *)calloc(1, sizeof(pdfCacheEntry));
+	if (!pe)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory for a cache entry"), wxT("pdfStreamCache::Put()"));
+		if (data)
+			free(data);
+		return NULL;
+	}
+	pe->m_key = key;
+	pe->m_data = data;
+	pe->m_len = len;
+
+	pe->m_next = m_head;
+	if (m_head)
+		m_head->m_prev = pe;
+	m_head = pe;
+	if (!m_tail)
+		m_tail = pe;
+	m_map[(void *)key] = pe;
+	m_bytes += len;
+
+	// make room, oldest first
+	while (m_bytes > m_budget && m_tail != pe)
+		Drop(m_tail);
+
+	return data;
+}
@@ -0,0 +1,60 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfStreamCache.h:
+ * class declaration for pdfStreamCache
+ *
+ * decoded stream data, kept around for a while so the same stream isn't
+ * inflated over and over. the total size is bounded, the least recently
+ * used streams are dropped to stay under it.
+ */
+#ifndef __pdfStreamCache_h_
+#define __pdfStreamCache_h_
+
+#include "fileDissect.h"
+#include <wx/hashmap.h>
+
+#define PDF_STREAM_CACHE_MAX	(32 * 1024 * 1024)
+
+
+struct pdfCacheEntry
+{
+	const void *m_key;
+	wxByte *m_data;
+	size_t m_len;
+
+	// most recently used first
+	pdfCacheEntry *m_prev;
+	pdfCacheEntry *m_next;
+};
+WX_DECLARE_VOIDPTR_HASH_MAP(pdfCacheEntry *, pdfCacheMap);
+
+
+class pdfStreamCache
+{
+public:
+	pdfStreamCache(size_t budget = PDF_STREAM_CACHE_MAX);
+	~pdfStreamCache(void);
+
+	// the data cached for key, NULL if there isn't any (or not any more).
+	// the pointer is good until the next Put or Clear
+	const wxByte *Get(const void *key, size_t *plen);
+	// take over data (from malloc) as key's, returns it or NULL if out of
+	// memory (data is freed either way). older entries are dropped until
+	// the total fits, but never the one just added
+	const wxByte *Put(const void *key, wxByte *data, size_t len);
+	void Clear(void);
+
+private:
+	void Unlink(pdfCacheEntry *pe);
+	void Drop(pdfCacheEntry *pe);
+
+	pdfCacheMap m_map;
+	pdfCacheEntry *m_head;
+	pdfCacheEntry *m_tail;
+	size_t m_bytes;
+	size_t m_budget;
+};
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfTokenIndex.cpp:
+ * implementation for pdfTokenIndex class
+ */
+#include "pdfTokenIndex.h"
+#include "pdf_defs.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define PDF_HAVE_SSE2
+# include <emmintrin.h>
+#endif
+
+
+static const struct
+{
+	const char *m_text;
+	size_t m_len;
+	pdfTokenKind m_kind;
+} pdf_keywords[] =
+{
+	{ "obj",		3, PDF_TOK_OBJ },
+	{ "endobj",		6, PDF_TOK_ENDOBJ },
+	{ "endstream",	9, PDF_TOK_ENDSTREAM },
+	{ "stream",		6, PDF_TOK_STREAM },
+	{ "startxref",	9, PDF_TOK_STARTXREF },
+	{ "xref",		4, PDF_TOK_XREF },
+	{ "trailer",	7, PDF_TOK_TRAILER },
+	{ "%%EOF",		5, PDF_TOK_EOF },
+	{ NULL, 0, PDF_TOK_COUNT }
+};
+
+
+static inline bool pdf_is_space(wxByte c)
+{
+	return memchr(PDF_WHITESPACE_CHARS, c, PDF_WHITESPACE_CHARSLEN) != NULL;
+}
+
+static inline bool pdf_is_delim(wxByte c)
+{
+	return memchr(PDF_NAME_DELIM_CHARS, c, PDF_NAME_DELIM_CHARSLEN) != NULL;
+}
+
+
+/*
+ * every keyword starts with one of "ob", "en", "st", "xr", "tr" or "%%", so
+ * the scan looks for those pairs and only tries the keywords where one is.
+ */
+static inline bool pdf_tok_pair(const wxByte *p)
+{
+	switch (p[0])
+	{
+	case 'o':
+		return p[1] == 'b';
+	case 'e':
+		return p[1] == 'n';
+	case 's':
+		return p[1] == 't';
+	case 'x':
+	case 't':
+		return p[1] == 'r';
+	case '%':
+		return p[1] == '%';
+	}
+	return false;
+}
+
+
+#ifdef PDF_HAVE_SSE2
+static inline unsigned pdf_ctz(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, x);
+	return (unsigned)idx;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+#endif
+
+
+static const wxByte *pdf_next_candidate(const wxByte *p, const wxByte *end)
+{
+#ifdef PDF_HAVE_SSE2
+	const __m128i vo = _mm_set1_epi8('o');
+	const __m128i vb = _mm_set1_epi8('b');
+	const __m128i ve = _mm_set1_epi8('e');
+	const __m128i vn = _mm_set1_epi8('n');
+	const __m128i vs = _mm_set1_epi8('s');
+	const __m128i vt = _mm_set1_epi8('t');
+	const __m128i vx = _mm_set1_epi8('x');
+	const __m128i vr = _mm_set1_epi8('r');
+	const __m128i vpct = _mm_set1_epi8('%');
+
+	// 16 first bytes and the 16 bytes after them at once
+	while (end - p >= 17)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)p);
+		__m128i b = _mm_loadu_si128((const __m128i *)(p + 1));
+		__m128i m;
+
+		m = _mm_and_si128(_mm_cmpeq_epi8(a, vo), _mm_cmpeq_epi8(b, vb));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(a, ve), _mm_cmpeq_epi8(b, vn)));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(a, vs), _mm_cmpeq_epi8(b, vt)));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi8(a, vx), _mm_cmpeq_epi8(a, vt)),
+			_mm_cmpeq_epi8(b, vr)));
+		m = _mm_or_si128(m, _mm_and_si128(_mm_cmpeq_epi8(a, vpct), _mm_cmpeq_epi8(b, vpct)));
+
+		unsigned mask = (unsigned)_mm_movemask_epi8(m);
+		if (mask)
+			return p + pdf_ctz(mask);
+		p += 16;
+	}
+#endif
+	for (; end - p >= 2; p++)
+	{
+		if (pdf_tok_pair(p))
+			return p;
+	}
+	return NULL;
+}
+
+
+static int pdf_match_keyword(const wxByte *p, const wxByte *end)
+{
+	int i;
+
+	for (i = 0; pdf_keywords[i].m_text; i++)
+	{
+		if ((size_t)(end - p) >= pdf_keywords[i].m_len
+			&& memcmp(p, pdf_keywords[i].m_text, pdf_keywords[i].m_len) == 0)
+			return i;
+	}
+	return -1;
+}
+
+
+pdfTokenIndex::pdfTokenIndex(void)
+{
+	int i;
+
+	for (i = 0; i < PDF_TOK_COUNT; i++)
+	{
+		m_tokens[i] = NULL;
+		m_nTokens[i] = 0;
+		m_maxTokens[i] = 0;
+	}
+	m_headers = NULL;
+	m_nHeaders = 0;
+	m_maxHeaders = 0;
+}
+
+pdfTokenIndex::~pdfTokenIndex(void)
+{
+	Clear();
+}
+
+
+void pdfTokenIndex::Clear(void)
+{
+	int i;
+
+	for (i = 0; i < PDF_TOK_COUNT; i++)
+	{
+		if (m_tokens[i])
+			free(m_tokens[i]);
+		m_tokens[i] = NULL;
+		m_nTokens[i] = 0;
+		m_maxTokens[i] = 0;
+	}
+	if (m_headers)
+		free(m_headers);
+	m_headers = NULL;
+	m_nHeaders = 0;
+	m_maxHeaders = 0;
+}
+
+
+bool pdfTokenIndex::Build(wxFileMap *file)
+{
+	Clear();
+
+	const wxByte *base = file->GetBaseAddress();
+	if (!base)
+	{
+		wxLogError(wxT("%s: The file must be mapped in its entirety"), wxT("pdfTokenIndex::Build()"));
+		return false;
+	}
+	const wxByte *end = base + file->Length();
+	const wxByte *p = base;
+
+	while ((p = pdf_next_candidate(p, end)))
+	{
+		int i = pdf_match_keyword(p, end);
+		if (i < 0)
+		{
+			p++;
+			continue;
+		}
+
+		// keywords stand alone. the end markers are taken anywhere, writers
+		// often butt them up against the data before them
+		pdfTokenKind kind = pdf_keywords[i].m_kind;
+		size_t klen = pdf_keywords[i].m_len;
+		if (kind != PDF_TOK_EOF && kind != PDF_TOK_ENDOBJ && kind != PDF_TOK_ENDSTREAM
+			&& ((p > base && !pdf_is_delim(p[-1]))
+				|| (p + klen < end && !pdf_is_delim(p[klen]))))
+		{
+			p++;
+			continue;
+		}
+
+		if (!Add(kind, p - base))
+			return false;
+		if (kind == PDF_TOK_OBJ && !AddHeader(base, p))
+			return false;
+		p += klen;
+	}
+	return true;
+}
+
+
+bool pdfTokenIndex::Add(pdfTokenKind kind, wxFileOffset off)
+{
+	if (m_nTokens[kind] == m_maxTokens[kind])
+	{
+		size_t max = m_maxTokens[kind] ? m_maxTokens[kind] * 2 : 64;
+		wxFileOffset *tokens = (wxFileOffset *)realloc(m_tokens[kind], max * sizeof(wxFileOffset));
+		if (!tokens)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for the token index"), wxT("pdfTokenIndex::Add()"));
+			return false;
+		}
+		m_tokens[kind] = tokens;
+		m_maxTokens[kind] = max;
+	}
+	m_tokens[kind][m_nTokens[kind]++] = off;
+	return true;
+}
+
+
+/*
+ * walk back from "obj" over the generation and object numbers. anything that
+ * isn't "N G obj" just isn't recorded as a header.
+ */
+bool pdfTokenIndex::AddHeader(const wxByte *base, const wxByte *obj)
+{
+	const wxByte *q = obj, *gen, *num, *mark;
+	unsigned long n = 0, g = 0;
+
+	mark = q;
+	while (q > base && pdf_is_space(q[-1]))
+		q--;
+	if (q == mark)
+		return true;
+
+	mark = q;
+	while (q > base && q[-1] >= '0' && q[-1] <= '9' && mark - q < 10)
+		q--;
+	if (q == mark)
+		return true;
+	gen = q;
+
+	mark = q;
+	while (q > base && pdf_is_space(q[-1]))
+		q--;
+	if (q == mark)
+		return true;
+
+	mark = q;
+	while (q > base && q[-1] >= '0' && q[-1] <= '9' && mark - q < 10)
+		q--;
+	if (q == mark || (q > base && !pdf_is_delim(q[-1])))
+		return true;
+	num = q;
+
+	for (q = num; *q >= '0' && *q <= '9'; q++)
+		n = n * 10 + (*q - '0');
+	for (q = gen; *q >= '0' && *q <= '9'; q++)
+		g = g * 10 + (*q - '0');
+
+	if (m_nHeaders == m_maxHeaders)
+	{
+		size_t max = m_maxHeaders ? m_maxHeaders * 2 : 64;
+		pdfObjHeader *headers = (pdfObjHeader *)realloc(m_headers, max * sizeof(pdfObjHeader));
+		if (!headers)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for the token index"), wxT("pdfTokenIndex::AddHeader()"));
+			return false;
+		}
+		m_headers = headers;
+		m_maxHeaders = max;
+	}
+
+	pdfObjHeader *ph = m_headers + m_nHeaders++;
+	ph->m_offset = num - base;
+	ph->m_obj = obj - base;
+	ph->m_number = n;
+	ph->m_generation = g;
+	return true;
+}
+
+
+// the index of the first token at or after off
+size_t pdfTokenIndex::LowerBound(pdfTokenKind kind, wxFileOffset off) const
+{
+	const wxFileOffset *tokens = m_tokens[kind];
+	size_t lo = 0, hi = m_nTokens[kind];
+
+	while (lo < hi)
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if (tokens[mid] < off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+
+size_t pdfTokenIndex::Count(pdfTokenKind kind) const
+{
+	return m_nTokens[kind];
+}
+
+wxFileOffset pdfTokenIndex::Get(pdfTokenKind kind, size_t idx) const
+{
+	if (idx >= m_nTokens[kind])
+		return wxInvalidOffset;
+	return m_tokens[kind][idx];
+}
+
+
+wxFileOffset pdfTokenIndex::Next(pdfTokenKind kind, wxFileOffset from, wxFileOffset limit) const
+{
+	size_t i = LowerBound(kind, from);
+	if (i >= m_nTokens[kind])
+		return wxInvalidOffset;
+	if (limit != wxInvalidOffset && m_tokens[kind][i] >= limit)
+		return wxInvalidOffset;
+	return m_tokens[kind][i];
+}
+
+
+wxFileOffset pdfTokenIndex::Last(pdfTokenKind kind, wxFileOffset limit) const
+{
+	size_t i = m_nTokens[kind];
+	if (limit != wxInvalidOffset)
+		i = LowerBound(kind, limit);
+	if (i == 0)
+		return wxInvalidOffset;
+	return m_tokens[kind][i - 1];
+}
+
+
+size_t pdfTokenIndex::HeaderCount(void) const
+{
+	return m_nHeaders;
+}
+
+const pdfObjHeader *pdfTokenIndex::GetHeader(size_t idx) const
+{
+	if (idx >= m_nHeaders)
+		return NULL;
+	return m_headers + idx;
+}
@@ -0,0 +1,79 @@
+/*
+ * Adobe Portable Document Format implementation
+ * Joshua J. Drake <jdrake accuvant.com>
+ *
+ * pdfTokenIndex.h:
+ * class declaration for pdfTokenIndex
+ *
+ * one pass over the mapping records where the structural keywords are, so
+ * finding "obj"/"endobj" for an object is a binary search instead of a scan
+ * that may run to EOF. the "N G obj" headers found along the way are enough
+ * to rebuild the object table when the xref is broken or missing.
+ */
+#ifndef __pdfTokenIndex_h_
+#define __pdfTokenIndex_h_
+
+#include "fileDissect.h"
+#include "wxFileMap.h"
+
+
+// the keywords we track
+enum pdfTokenKind
+{
+	PDF_TOK_OBJ = 0,
+	PDF_TOK_ENDOBJ,
+	PDF_TOK_STREAM,
+	PDF_TOK_ENDSTREAM,
+	PDF_TOK_XREF,
+	PDF_TOK_STARTXREF,
+	PDF_TOK_TRAILER,
+	PDF_TOK_EOF,			// %%EOF
+	PDF_TOK_COUNT
+};
+
+
+// an "N G obj" line
+struct pdfObjHeader
+{
+	wxFileOffset m_offset;		// where N starts
+	wxFileOffset m_obj;			// where "obj" starts
+	unsigned long m_number;
+	unsigned long m_generation;
+};
+
+
+class pdfTokenIndex
+{
+public:
+	pdfTokenIndex(void);
+	~pdfTokenIndex(void);
+
+	bool Build(wxFileMap *file);
+	void Clear(void);
+
+	size_t Count(pdfTokenKind kind) const;
+	wxFileOffset Get(pdfTokenKind kind, size_t idx) const;
+	// the first token at or after from and before limit (-1 for no limit)
+	wxFileOffset Next(pdfTokenKind kind, wxFileOffset from, wxFileOffset limit = wxInvalidOffset) const;
+	// the last token that starts before limit (-1 for anywhere)
+	wxFileOffset Last(pdfTokenKind kind, wxFileOffset limit = wxInvalidOffset) const;
+
+	// object headers, in file order
+	size_t HeaderCount(void) const;
+	const pdfObjHeader *GetHeader(size_t idx) const;
+
+private:
+	bool Add(pdfTokenKind kind, wxFileOffset off);
+	bool AddHeader(const wxByte *base, const wxByte *obj);
+	size_t LowerBound(pdfTokenKind kind, wxFileOffset off) const;
+
+	wxFileOffset *m_tokens[PDF_TOK_COUNT];
+	size_t m_nTokens[PDF_TOK_COUNT];
+	size_t m_maxTokens[PDF_TOK_COUNT];
+
+	pdfObjHeader *m_headers;
+	size_t m_nHeaders;
+	size_t m_maxHeaders;
+};
+
+#endif
@@ -31,6 +31,8 @@ typedef ULONG DWORD;
 
 
 #define PDF_TRAILER_MIN_SIZE 18 // startxref\nN\n%%EOF\n
+#define PDF_OBJ_HEADER_MAX	64 // "4294967295 65535 obj" plus generous whitespace
+#define PDF_MAX_OBJECTS		8388607 // implementation limit on indirect objects (Appendix C)
 
 #define PDF_WHITESPACE_CHARS	"\x00\x09\x0a\x0c\x0d\x20"
 #define PDF_WHITESPACE_CHARSLEN 6
@@ -19,6 +19,10 @@
 #define FDT_NEW(member,stru)			new fdTIData( FDT_OFFSET_OF(member,stru), FDT_SIZE_OF(member,stru))
 #define FDT_NEW_OFF(off,member,stru)	new fdTIData( off + FDT_OFFSET_OF(member,stru), FDT_SIZE_OF(member,stru))
 
+// same, but as start/length arguments for fileDissectNodes::AppendRange
+#define FDT_RANGE(member,stru)			FDT_OFFSET_OF(member,stru), FDT_SIZE_OF(member,stru)
+#define FDT_RANGE_OFF(off,member,stru)	off + FDT_OFFSET_OF(member,stru), FDT_SIZE_OF(member,stru)
+
 
 /*
  * the item data class for our tree 
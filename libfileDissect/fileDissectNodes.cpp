@@ -0,0 +1,819 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectNodes.cpp:
+ * in-memory dissection node model
+ */
+
+#include "fileDissectNodes.h"
+
+#define FDN_NONE		((wxUint32)-1)
+
+// node flags
+#define FDN_EXPANDED	0x01
+#define FDN_DELETED		0x02
+#define FDN_RANGE		0x04	// u.range is valid
+#define FDN_DATA		0x08	// u.data is valid
+#define FDN_LAZY		0x10	// children come from an expander (see m_lazy)
+#define FDN_ANCHOR		0x20	// overlay stand-in for u.range.start of the tree underneath
+
+// initial number of node slots / label pool bytes
+#define FDN_INITIAL		1024
+#define FDN_POOL_INITIAL	(64 * 1024)
+
+
+fileDissectNodes::fileDissectNodes(void)
+{
+	m_nodes = 0;
+	m_used = m_alloc = m_live = 0;
+	m_pool = 0;
+	m_pool_used = m_pool_alloc = 0;
+	m_root = m_selection = FDN_NONE;
+	m_base = 0;
+}
+
+
+fileDissectNodes::fileDissectNodes(const fileDissectNodes *under)
+{
+	m_nodes = 0;
+	m_used = m_alloc = m_live = 0;
+	m_pool = 0;
+	m_pool_used = m_pool_alloc = 0;
+	m_root = m_selection = FDN_NONE;
+	// our own ids start above every id the other tree has handed out
+	m_base = under ? under->m_base + under->m_used : 0;
+}
+
+
+// ids handed out are index + 1 (+ m_base), so a zero id is never valid
+wxTreeItemId fileDissectNodes::ToId(wxUint32 idx) const
+{
+	if (idx == FDN_NONE)
+		return wxTreeItemId();
+	return wxTreeItemId((void *)(wxUIntPtr)((size_t)idx + m_base + 1));
+}
+
+// ids that aren't ours come back as FDN_NONE
+wxUint32 fileDissectNodes::ToIndex(const wxTreeItemId &id) const
+{
+	size_t raw = (size_t)(wxUIntPtr)id.GetID() - 1;
+	if (raw < m_base)
+		return FDN_NONE;
+	return (wxUint32)(raw - m_base);
+}
+
+
+fileDissectNodes::~fileDissectNodes(void)
+{
+	DeleteAllItems();
+	if (m_nodes)
+		free(m_nodes);
+	if (m_pool)
+		free(m_pool);
+}
+
+
+bool fileDissectNodes::IsValid(wxUint32 idx) const
+{
+	if (idx >= m_used)
+		return false;
+	if (m_nodes[idx].flags & FDN_DELETED)
+		return false;
+	return true;
+}
+
+
+bool fileDissectNodes::IsValidId(const wxTreeItemId &id) const
+{
+	if (!id.IsOk())
+		return false;
+	return IsValid(ToIndex(id));
+}
+
+
+bool fileDissectNodes::GrowPool(size_t len)
+{
+	if (m_pool_used + len <= m_pool_alloc)
+		return true;
+
+	size_t nalloc = m_pool_alloc ? m_pool_alloc : FDN_POOL_INITIAL;
+	while (m_pool_used + len > nalloc)
+		nalloc *= 2;
+	char *pp = (char *)realloc(m_pool, nalloc);
+	if (!pp)
+	{
+		wxLogError(wxT("%s: Unable to allocate %lu bytes for node labels"), wxT("fileDissectNodes::AddLabel()"), (unsigned long)nalloc);
+		return false;
+	}
+	m_pool = pp;
+	m_pool_alloc = nalloc;
+	return true;
+}
+
+
+// copy a label into the pool as UTF-8
+bool fileDissectNodes::AddLabel(fdNode *pn, const wxString &text)
+{
+	size_t len = text.Len();
+	const char *src = NULL;
+#if wxUSE_UNICODE
+	wxCharBuffer buf;
+	const wxChar *pch = text.c_str();
+	size_t i;
+
+	// most labels are plain ASCII, skip the conversion for those
+	for (i = 0; i < len; i++)
+	{
+		if ((unsigned)pch[i] >= 0x80)
+			break;
+	}
+	if (i < len)
+	{
+		buf = text.mb_str(wxConvUTF8);
+		src = buf.data();
+		len = src ? strlen(src) : 0;
+	}
+#else
+	src = text.c_str();
+#endif
+
+	if (!GrowPool(len))
+		return false;
+
+	char *dst = m_pool + m_pool_used;
+#if wxUSE_UNICODE
+	if (!src)
+	{
+		for (i = 0; i < len; i++)
+			dst[i] = (char)pch[i];
+	}
+	else
+#endif
+		memcpy(dst, src, len);
+
+	pn->label_off = m_pool_used;
+	pn->label_len = (wxUint32)len;
+	m_pool_used += len;
+	return true;
+}
+
+
+// a label that's already UTF-8 (from another tree's pool)
+bool fileDissectNodes::AddLabel(fdNode *pn, const char *label, size_t len)
+{
+	if (!GrowPool(len))
+		return false;
+	memcpy(m_pool + m_pool_used, label, len);
+	pn->label_off = m_pool_used;
+	pn->label_len = (wxUint32)len;
+	m_pool_used += len;
+	return true;
+}
+
+
+// the next free slot, not counted as used until LinkNode
+fileDissectNodes::fdNode *fileDissectNodes::ReserveNode(void)
+{
+	// grow the node array as needed
+	if (m_used == m_alloc)
+	{
+		wxUint32 nalloc = m_alloc ? m_alloc * 2 : FDN_INITIAL;
+		if (nalloc <= m_alloc || nalloc == FDN_NONE)
+		{
+			wxLogError(wxT("%s: Too many nodes"), wxT("fileDissectNodes::NewNode()"));
+			return NULL;
+		}
+		fdNode *pn = (fdNode *)realloc(m_nodes, (size_t)nalloc * sizeof(fdNode));
+		if (!pn)
+		{
+			wxLogError(wxT("%s: Unable to allocate memory for %lu nodes"), wxT("fileDissectNodes::NewNode()"), (unsigned long)nalloc);
+			return NULL;
+		}
+		m_nodes = pn;
+		m_alloc = nalloc;
+	}
+
+	fdNode *pn = m_nodes + m_used;
+	pn->first = pn->last = pn->next = FDN_NONE;
+	pn->flags = 0;
+	return pn;
+}
+
+
+wxUint32 fileDissectNodes::LinkNode(wxUint32 parent)
+{
+	wxUint32 idx = m_used;
+	m_nodes[idx].parent = parent;
+	m_used++;
+	m_live++;
+
+	// link it in as the last child
+	if (parent != FDN_NONE)
+	{
+		fdNode *pp = m_nodes + parent;
+		if (pp->last == FDN_NONE)
+			pp->first = idx;
+		else
+			m_nodes[pp->last].next = idx;
+		pp->last = idx;
+	}
+	return idx;
+}
+
+
+wxUint32 fileDissectNodes::NewNode(wxUint32 parent, const wxString &text)
+{
+	fdNode *pn = ReserveNode();
+	if (!pn || !AddLabel(pn, text))
+		return FDN_NONE;
+	return LinkNode(parent);
+}
+
+
+wxUint32 fileDissectNodes::NewNode(wxUint32 parent, const char *label, size_t len)
+{
+	fdNode *pn = ReserveNode();
+	if (!pn || !AddLabel(pn, label, len))
+		return FDN_NONE;
+	return LinkNode(parent);
+}
+
+
+void fileDissectNodes::FreeData(wxUint32 idx)
+{
+	fdNode *pn = m_nodes + idx;
+	if (pn->flags & FDN_DATA)
+		delete pn->u.data;
+	pn->flags &= ~(FDN_DATA | FDN_RANGE);
+}
+
+
+// plugins only ever pass fdTIData, keep single ranges inline
+void fileDissectNodes::SetData(wxUint32 idx, wxTreeItemData *data)
+{
+	fdNode *pn = m_nodes + idx;
+
+	if (!data)
+		return;
+
+	fdTIData *pTID = (fdTIData *)data;
+	fdTIData::iterator i = pTID->begin();
+	if (i != pTID->end())
+	{
+		fileDissectSel *pSel = *i;
+		if (++i == pTID->end())
+		{
+			pn->u.range.start = pSel->m_start;
+			pn->u.range.end = pSel->m_end;
+			pn->flags |= FDN_RANGE;
+			delete data;
+			return;
+		}
+	}
+	pn->u.data = data;
+	pn->flags |= FDN_DATA;
+}
+
+
+// resolve a parent for appending. in an overlay, items of the tree
+// underneath get a stand-in node the first time something is added to them
+wxUint32 fileDissectNodes::ParentIndex(const wxTreeItemId &id)
+{
+	if (!id.IsOk())
+		return FDN_NONE;
+	size_t raw = (size_t)(wxUIntPtr)id.GetID() - 1;
+	if (raw >= m_base)
+		return IsValidId(id) ? ToIndex(id) : FDN_NONE;
+
+	fdAnchorMap::iterator it = m_anchors.find((wxUint32)raw);
+	if (it != m_anchors.end())
+		return it->second;
+
+	wxUint32 idx = NewNode(FDN_NONE, wxEmptyString);
+	if (idx == FDN_NONE)
+		return FDN_NONE;
+	m_nodes[idx].flags |= FDN_ANCHOR;
+	m_nodes[idx].u.range.start = (wxFileOffset)raw;
+	m_live--;
+	m_anchors[(wxUint32)raw] = idx;
+	return idx;
+}
+
+
+wxTreeItemId fileDissectNodes::AddRoot(const wxString &text, int WXUNUSED(image), int WXUNUSED(selImage),
+	wxTreeItemData *data)
+{
+	// only one root, just like wxTreeCtrl
+	DeleteAllItems();
+
+	m_root = NewNode(FDN_NONE, text);
+	if (m_root == FDN_NONE)
+	{
+		delete data;
+		return wxTreeItemId();
+	}
+	SetData(m_root, data);
+	return ToId(m_root);
+}
+
+
+wxTreeItemId fileDissectNodes::AppendItem(const wxTreeItemId &parent, const wxString &text,
+	int WXUNUSED(image), int WXUNUSED(selImage), wxTreeItemData *data)
+{
+	wxUint32 idx, pidx = ParentIndex(parent);
+
+	if (pidx == FDN_NONE
+		|| (idx = NewNode(pidx, text)) == FDN_NONE)
+	{
+		delete data;
+		return wxTreeItemId();
+	}
+	SetData(idx, data);
+	return ToId(idx);
+}
+
+
+wxTreeItemId fileDissectNodes::AppendRange(const wxTreeItemId &parent, const wxString &text,
+	wxFileOffset start, wxFileOffset length)
+{
+	wxUint32 idx, pidx = ParentIndex(parent);
+
+	if (pidx == FDN_NONE
+		|| (idx = NewNode(pidx, text)) == FDN_NONE)
+		return wxTreeItemId();
+
+	fdNode *pn = m_nodes + idx;
+	pn->u.range.start = start;
+	pn->u.range.end = start + length;
+	pn->flags |= FDN_RANGE;
+	return ToId(idx);
+}
+
+
+void fileDissectNodes::SetItemText(const wxTreeItemId &id, const wxString &text)
+{
+	if (!IsValidId(id))
+		return;
+	// the old label is just left in the pool
+	AddLabel(m_nodes + ToIndex(id), text);
+}
+
+
+void fileDissectNodes::SetItemData(const wxTreeItemId &id, wxTreeItemData *data)
+{
+	if (!IsValidId(id))
+	{
+		delete data;
+		return;
+	}
+	wxUint32 idx = ToIndex(id);
+	fdNode *pn = m_nodes + idx;
+
+	// wxTreeCtrl leaks the old data here, we don't
+	if ((pn->flags & FDN_DATA) && pn->u.data == data)
+		return;
+	FreeData(idx);
+	SetData(idx, data);
+}
+
+
+void fileDissectNodes::DeleteSubtree(wxUint32 idx)
+{
+	// walk the subtree without recursing, children always have larger indexes
+	// than their parents, but siblings may not be in order after a sort
+	wxUint32 cur = idx;
+	while (cur != FDN_NONE)
+	{
+		fdNode *pn = m_nodes + cur;
+		if (pn->first != FDN_NONE)
+		{
+			// descend first, detaching as we go
+			wxUint32 child = pn->first;
+			pn->first = m_nodes[child].next;
+			if (pn->first == FDN_NONE)
+				pn->last = FDN_NONE;
+			cur = child;
+			continue;
+		}
+
+		// leaf, kill it and go back up
+		wxUint32 up = (cur == idx) ? FDN_NONE : pn->parent;
+		if (pn->flags & FDN_LAZY)
+			m_lazy.erase(cur);
+		FreeData(cur);
+		pn->flags |= FDN_DELETED;
+		m_live--;
+		if (m_selection == cur)
+			m_selection = FDN_NONE;
+		cur = up;
+	}
+}
+
+
+void fileDissectNodes::Delete(const wxTreeItemId &id)
+{
+	if (!IsValidId(id))
+		return;
+	wxUint32 idx = ToIndex(id);
+
+	// unlink from the parent
+	wxUint32 parent = m_nodes[idx].parent;
+	if (parent != FDN_NONE)
+	{
+		fdNode *pp = m_nodes + parent;
+		wxUint32 prev = FDN_NONE, cur = pp->first;
+		while (cur != FDN_NONE && cur != idx)
+		{
+			prev = cur;
+			cur = m_nodes[cur].next;
+		}
+		if (cur == idx)
+		{
+			if (prev == FDN_NONE)
+				pp->first = m_nodes[idx].next;
+			else
+				m_nodes[prev].next = m_nodes[idx].next;
+			if (pp->last == idx)
+				pp->last = prev;
+		}
+	}
+	else
+		m_root = FDN_NONE;
+
+	DeleteSubtree(idx);
+}
+
+
+void fileDissectNodes::DeleteAllItems(void)
+{
+	wxUint32 i;
+	for (i = 0; i < m_used; i++)
+	{
+		if (m_nodes[i].flags & FDN_DATA)
+			delete m_nodes[i].u.data;
+	}
+	m_used = m_live = 0;
+	m_pool_used = 0;
+	m_root = m_selection = FDN_NONE;
+	m_lazy.clear();
+	m_anchors.clear();
+}
+
+
+// compare two pooled labels, UTF-8 byte order is code point order
+static inline int fdn_cmp(const char *pool, const void *pa, const void *pb)
+{
+	const size_t *a = (const size_t *)pa;
+	const size_t *b = (const size_t *)pb;
+	size_t len = a[1] < b[1] ? a[1] : b[1];
+	int ret = memcmp(pool + a[0], pool + b[0], len);
+	if (ret)
+		return ret;
+	if (a[1] == b[1])
+		return 0;
+	return a[1] < b[1] ? -1 : 1;
+}
+
+// merge sort (stable, like wxTreeCtrl) of { label_off, label_len, idx } triples
+static void fdn_sort(size_t *list, size_t *tmp, size_t cnt, const char *pool)
+{
+	if (cnt < 2)
+		return;
+
+	size_t half = cnt / 2;
+	fdn_sort(list, tmp, half, pool);
+	fdn_sort(list + half * 3, tmp, cnt - half, pool);
+
+	size_t i = 0, j = half, k = 0;
+	while (i < half && j < cnt)
+	{
+		if (fdn_cmp(pool, list + j * 3, list + i * 3) < 0)
+			memcpy(tmp + (k++) * 3, list + (j++) * 3, 3 * sizeof(size_t));
+		else
+			memcpy(tmp + (k++) * 3, list + (i++) * 3, 3 * sizeof(size_t));
+	}
+	if (i < half)
+		memcpy(tmp + k * 3, list + i * 3, (half - i) * 3 * sizeof(size_t));
+	// anything left in the upper half is already in place
+	memcpy(list, tmp, (k + half - i) * 3 * sizeof(size_t));
+}
+
+
+void fileDissectNodes::SortChildren(const wxTreeItemId &id)
+{
+	if (!IsValidId(id))
+		return;
+
+	// count the children
+	fdNode *pp = m_nodes + ToIndex(id);
+	size_t cnt = 0;
+	wxUint32 cur;
+	for (cur = pp->first; cur != FDN_NONE; cur = m_nodes[cur].next)
+		cnt++;
+	if (cnt < 2)
+		return;
+
+	size_t *list = (size_t *)malloc(cnt * 6 * sizeof(size_t));
+	if (!list)
+	{
+		wxLogError(wxT("%s: Unable to allocate memory to sort %lu nodes"), wxT("fileDissectNodes::SortChildren()"), (unsigned long)cnt);
+		return;
+	}
+
+	size_t i = 0;
+	for (cur = pp->first; cur != FDN_NONE; cur = m_nodes[cur].next, i++)
+	{
+		list[i * 3] = m_nodes[cur].label_off;
+		list[i * 3 + 1] = m_nodes[cur].label_len;
+		list[i * 3 + 2] = cur;
+	}
+	fdn_sort(list, list + cnt * 3, cnt, m_pool);
+
+	// relink in sorted order
+	pp->first = (wxUint32)list[2];
+	for (i = 0; i < cnt - 1; i++)
+		m_nodes[list[i * 3 + 2]].next = (wxUint32)list[(i + 1) * 3 + 2];
+	pp->last = (wxUint32)list[(cnt - 1) * 3 + 2];
+	m_nodes[pp->last].next = FDN_NONE;
+
+	free(list);
+}
+
+
+void fileDissectNodes::SetItemExpander(const wxTreeItemId &id, fileDissectExpander *expander, wxUIntPtr cookie)
+{
+	if (!IsValidId(id) || !expander)
+		return;
+	wxUint32 idx = ToIndex(id);
+
+	fdLazy lz;
+	lz.expander = expander;
+	lz.cookie = cookie;
+	m_lazy[idx] = lz;
+	m_nodes[idx].flags |= FDN_LAZY;
+}
+
+
+bool fileDissectNodes::IsLazy(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return false;
+	return (m_nodes[ToIndex(id)].flags & FDN_LAZY) ? true : false;
+}
+
+
+// build a lazy node's children now, does nothing for ordinary nodes
+void fileDissectNodes::LoadChildren(const wxTreeItemId &id)
+{
+	if (!IsLazy(id))
+		return;
+	wxUint32 idx = ToIndex(id);
+
+	// unmark first, the expander appends through the normal interface
+	m_nodes[idx].flags &= ~FDN_LAZY;
+	fdLazyMap::iterator it = m_lazy.find(idx);
+	if (it == m_lazy.end())
+		return;
+	fdLazy lz = it->second;
+	m_lazy.erase(it);
+
+	lz.expander->ExpandNode(this, id, lz.cookie);
+}
+
+
+// copy one node of src to the end of parent's children, taking over its data
+wxUint32 fileDissectNodes::CopyNode(fileDissectNodes *src, wxUint32 sidx, wxUint32 parent)
+{
+	fdNode *ps = src->m_nodes + sidx;
+	wxUint32 idx = NewNode(parent, src->m_pool + ps->label_off, ps->label_len);
+	if (idx == FDN_NONE)
+		return FDN_NONE;
+
+	fdNode *pn = m_nodes + idx;
+	pn->flags = ps->flags & (FDN_EXPANDED | FDN_RANGE | FDN_DATA | FDN_LAZY);
+	pn->u = ps->u;
+	ps->flags &= ~FDN_DATA;
+
+	if (ps->flags & FDN_LAZY)
+	{
+		fdLazyMap::iterator it = src->m_lazy.find(sidx);
+		if (it != src->m_lazy.end())
+		{
+			m_lazy[idx] = it->second;
+			src->m_lazy.erase(it);
+		}
+		else
+			pn->flags &= ~FDN_LAZY;
+		ps->flags &= ~FDN_LAZY;
+	}
+	return idx;
+}
+
+
+void fileDissectNodes::Graft(fileDissectNodes *overlay)
+{
+	if (!overlay || overlay == this)
+		return;
+
+	// stand-ins were made in the order they were first used
+	wxUint32 a;
+	for (a = 0; a < overlay->m_used; a++)
+	{
+		const fdNode *pa = overlay->m_nodes + a;
+		if ((pa->flags & (FDN_ANCHOR | FDN_DELETED)) != FDN_ANCHOR)
+			continue;
+		size_t raw = (size_t)pa->u.range.start;
+		if (raw < m_base || !IsValid((wxUint32)(raw - m_base)))
+			continue;
+
+		// copy each subtree in pre-order, without recursing
+		wxUint32 dparent = (wxUint32)(raw - m_base);
+		wxUint32 cur = pa->first;
+		while (cur != FDN_NONE)
+		{
+			wxUint32 copy = CopyNode(overlay, cur, dparent);
+			if (copy == FDN_NONE)
+				return;
+
+			const fdNode *pc = overlay->m_nodes + cur;
+			if (pc->first != FDN_NONE)
+			{
+				dparent = copy;
+				cur = pc->first;
+				continue;
+			}
+
+			// no children, next sibling (of us or of an ancestor)
+			while (cur != a && overlay->m_nodes[cur].next == FDN_NONE)
+			{
+				cur = overlay->m_nodes[cur].parent;
+				if (cur != a)
+					dparent = m_nodes[dparent].parent;
+			}
+			cur = (cur == a) ? FDN_NONE : overlay->m_nodes[cur].next;
+		}
+	}
+}
+
+
+void fileDissectNodes::Expand(const wxTreeItemId &id)
+{
+	if (!IsValidId(id))
+		return;
+	m_nodes[ToIndex(id)].flags |= FDN_EXPANDED;
+}
+
+
+void fileDissectNodes::SelectItem(const wxTreeItemId &id)
+{
+	if (!IsValidId(id))
+		return;
+	m_selection = ToIndex(id);
+}
+
+
+bool fileDissectNodes::IsExpanded(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return false;
+	return (m_nodes[ToIndex(id)].flags & FDN_EXPANDED) ? true : false;
+}
+
+
+wxTreeItemId fileDissectNodes::GetSelection(void) const
+{
+	return ToId(m_selection);
+}
+
+
+wxTreeItemId fileDissectNodes::GetRootItem(void) const
+{
+	return ToId(m_root);
+}
+
+
+wxTreeItemId fileDissectNodes::GetItemParent(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return wxTreeItemId();
+	return ToId(m_nodes[ToIndex(id)].parent);
+}
+
+
+wxTreeItemId fileDissectNodes::GetFirstChild(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return wxTreeItemId();
+	return ToId(m_nodes[ToIndex(id)].first);
+}
+
+
+wxTreeItemId fileDissectNodes::GetNextSibling(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return wxTreeItemId();
+	return ToId(m_nodes[ToIndex(id)].next);
+}
+
+
+// lazy nodes count as having children, even before they're loaded
+bool fileDissectNodes::HasChildren(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return false;
+	const fdNode *pn = m_nodes + ToIndex(id);
+	return (pn->first != FDN_NONE || (pn->flags & FDN_LAZY));
+}
+
+
+size_t fileDissectNodes::GetChildrenCount(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return 0;
+
+	size_t cnt = 0;
+	wxUint32 cur;
+	for (cur = m_nodes[ToIndex(id)].first; cur != FDN_NONE; cur = m_nodes[cur].next)
+		cnt++;
+	return cnt;
+}
+
+
+wxString fileDissectNodes::GetItemText(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return wxEmptyString;
+
+	const fdNode *pn = m_nodes + ToIndex(id);
+#if wxUSE_UNICODE
+	return wxString(m_pool + pn->label_off, wxConvUTF8, pn->label_len);
+#else
+	return wxString(m_pool + pn->label_off, pn->label_len);
+#endif
+}
+
+
+wxTreeItemData *fileDissectNodes::GetItemData(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return NULL;
+
+	const fdNode *pn = m_nodes + ToIndex(id);
+	if (pn->flags & FDN_DATA)
+		return pn->u.data;
+	return NULL;
+}
+
+
+bool fileDissectNodes::HasItemSelection(const wxTreeItemId &id) const
+{
+	if (!IsValidId(id))
+		return false;
+	return (m_nodes[ToIndex(id)].flags & (FDN_RANGE | FDN_DATA)) ? true : false;
+}
+
+
+// get an inline range, false if the node has none (it may still have data)
+bool fileDissectNodes::GetItemRange(const wxTreeItemId &id, wxFileOffset &start, wxFileOffset &end) const
+{
+	if (!IsValidId(id))
+		return false;
+
+	const fdNode *pn = m_nodes + ToIndex(id);
+	if (!(pn->flags & FDN_RANGE))
+		return false;
+	start = pn->u.range.start;
+	end = pn->u.range.end;
+	return true;
+}
+
+
+bool fileDissectNodes::GetItemSelection(const wxTreeItemId &id, fileDissectSelList &sel) const
+{
+	wxFileOffset start, end;
+
+	if (GetItemRange(id, start, end))
+	{
+		sel.AddToSelection(start, end);
+		return true;
+	}
+
+	fdTIData *pTID = (fdTIData *)GetItemData(id);
+	if (!pTID)
+		return false;
+	for (fdTIData::iterator i = pTID->begin();
+		i != pTID->end();
+		i++)
+	{
+		fileDissectSel *pSel = *i;
+		sel.AddToSelection(pSel->m_start, pSel->m_end);
+	}
+	return true;
+}
+
+
+size_t fileDissectNodes::GetCount(void) const
+{
+	return m_live;
+}
@@ -0,0 +1,167 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectNodes.h:
+ * in-memory dissection node model
+ *
+ * plugins build their output into one of these instead of talking to a
+ * wxTreeCtrl directly. the GUI mirrors it into the tree view, fd-cli just
+ * walks it and prints it. the interface is the subset of wxTreeCtrl that
+ * plugins have always used, so dissection code looks the same either way.
+ *
+ * nodes are small fixed size records in one array, linked by index. labels
+ * live in a shared UTF-8 pool and single byte ranges are stored inline, so a
+ * node costs a few dozen bytes rather than a native tree item, a wxString
+ * and a heap allocated fdTIData.
+ *
+ * a node can also be given an expander instead of children. its children
+ * are then only built when somebody calls LoadChildren on it (the GUI does
+ * when the item is opened), so detail nobody looks at costs nothing.
+ *
+ * an overlay is a private buffer layered over another tree. it accepts that
+ * tree's items as parents (without touching it), so code can build output
+ * in another thread and the results get grafted back later in one go.
+ */
+#ifndef __fileDissectNodes_h_
+#define __fileDissectNodes_h_
+
+#include "fileDissectItemData.h"
+#include <wx/treebase.h>
+#include <wx/hashmap.h>
+
+class fileDissectNodes;
+
+// builds the children of a lazy node, cookie is whatever was passed to SetItemExpander
+class fileDissectExpander
+{
+public:
+	virtual ~fileDissectExpander(void) { }
+	virtual void ExpandNode(fileDissectNodes *nodes, const wxTreeItemId &id, wxUIntPtr cookie) = 0;
+};
+
+struct fdLazy
+{
+	fileDissectExpander *expander;
+	wxUIntPtr cookie;
+};
+WX_DECLARE_HASH_MAP(wxUint32, fdLazy, wxIntegerHash, wxIntegerEqual, fdLazyMap);
+// base tree index -> stand-in node index
+WX_DECLARE_HASH_MAP(wxUint32, wxUint32, wxIntegerHash, wxIntegerEqual, fdAnchorMap);
+
+
+class fileDissectNodes
+{
+public:
+	__declspec(dllexport) fileDissectNodes(void);
+	// an overlay of under, which must not change until the overlay is grafted
+	__declspec(dllexport) fileDissectNodes(const fileDissectNodes *under);
+	__declspec(dllexport) ~fileDissectNodes(void);
+
+	// building the tree (same semantics as wxTreeCtrl)
+	__declspec(dllexport) wxTreeItemId AddRoot(const wxString &text, int image = -1, int selImage = -1,
+		wxTreeItemData *data = NULL);
+	__declspec(dllexport) wxTreeItemId AppendItem(const wxTreeItemId &parent, const wxString &text,
+		int image = -1, int selImage = -1, wxTreeItemData *data = NULL);
+	// same as AppendItem with a new fdTIData, without the allocation
+	__declspec(dllexport) wxTreeItemId AppendRange(const wxTreeItemId &parent, const wxString &text,
+		wxFileOffset start, wxFileOffset length);
+	__declspec(dllexport) void SetItemText(const wxTreeItemId &id, const wxString &text);
+	__declspec(dllexport) void SetItemData(const wxTreeItemId &id, wxTreeItemData *data);
+	__declspec(dllexport) void Delete(const wxTreeItemId &id);
+	__declspec(dllexport) void DeleteAllItems(void);
+	__declspec(dllexport) void SortChildren(const wxTreeItemId &id);
+
+	// lazy children, the expander must outlive the node (or DeleteAllItems)
+	__declspec(dllexport) void SetItemExpander(const wxTreeItemId &id, fileDissectExpander *expander, wxUIntPtr cookie = 0);
+	__declspec(dllexport) bool IsLazy(const wxTreeItemId &id) const;
+	__declspec(dllexport) void LoadChildren(const wxTreeItemId &id);
+
+	// move everything an overlay of this tree appended into place, in the
+	// order it was appended. the overlay is left with nothing worth keeping
+	__declspec(dllexport) void Graft(fileDissectNodes *overlay);
+
+	// view state hints (applied by whoever displays the nodes)
+	__declspec(dllexport) void Expand(const wxTreeItemId &id);
+	__declspec(dllexport) void SelectItem(const wxTreeItemId &id);
+	__declspec(dllexport) bool IsExpanded(const wxTreeItemId &id) const;
+	__declspec(dllexport) wxTreeItemId GetSelection(void) const;
+
+	// walking the tree
+	__declspec(dllexport) wxTreeItemId GetRootItem(void) const;
+	__declspec(dllexport) wxTreeItemId GetItemParent(const wxTreeItemId &id) const;
+	__declspec(dllexport) wxTreeItemId GetFirstChild(const wxTreeItemId &id) const;
+	__declspec(dllexport) wxTreeItemId GetNextSibling(const wxTreeItemId &id) const;
+	__declspec(dllexport) bool HasChildren(const wxTreeItemId &id) const;
+	__declspec(dllexport) wxString GetItemText(const wxTreeItemId &id) const;
+	__declspec(dllexport) wxTreeItemData *GetItemData(const wxTreeItemId &id) const;
+	__declspec(dllexport) size_t GetChildrenCount(const wxTreeItemId &id) const;
+
+	// selected bytes, whether they are stored inline or in item data
+	__declspec(dllexport) bool HasItemSelection(const wxTreeItemId &id) const;
+	__declspec(dllexport) bool GetItemRange(const wxTreeItemId &id, wxFileOffset &start, wxFileOffset &end) const;
+	__declspec(dllexport) bool GetItemSelection(const wxTreeItemId &id, fileDissectSelList &sel) const;
+
+	// number of live nodes
+	__declspec(dllexport) size_t GetCount(void) const;
+
+private:
+	struct fdNode
+	{
+		wxUint32 parent;
+		wxUint32 first;
+		wxUint32 last;
+		wxUint32 next;
+		wxUint32 flags;
+		wxUint32 label_len;
+		size_t label_off;
+		union
+		{
+			struct
+			{
+				wxFileOffset start;
+				wxFileOffset end;
+			} range;
+			wxTreeItemData *data;
+		} u;
+	};
+
+	wxUint32 NewNode(wxUint32 parent, const wxString &text);
+	wxUint32 NewNode(wxUint32 parent, const char *label, size_t len);
+	fdNode *ReserveNode(void);
+	wxUint32 LinkNode(wxUint32 parent);
+	wxUint32 CopyNode(fileDissectNodes *src, wxUint32 sidx, wxUint32 parent);
+	bool IsValid(wxUint32 idx) const;
+	bool IsValidId(const wxTreeItemId &id) const;
+	wxTreeItemId ToId(wxUint32 idx) const;
+	wxUint32 ToIndex(const wxTreeItemId &id) const;
+	wxUint32 ParentIndex(const wxTreeItemId &id);
+	void SetData(wxUint32 idx, wxTreeItemData *data);
+	void FreeData(wxUint32 idx);
+	void DeleteSubtree(wxUint32 idx);
+	bool AddLabel(fdNode *pn, const wxString &text);
+	bool AddLabel(fdNode *pn, const char *label, size_t len);
+	bool GrowPool(size_t len);
+
+	fdNode *m_nodes;
+	wxUint32 m_used;
+	wxUint32 m_alloc;
+	wxUint32 m_live;
+
+	// label pool
+	char *m_pool;
+	size_t m_pool_used;
+	size_t m_pool_alloc;
+
+	wxUint32 m_root;
+	wxUint32 m_selection;
+
+	// overlays: ids up to m_base belong to the tree underneath
+	wxUint32 m_base;
+	fdAnchorMap m_anchors;
+
+	// pending expansions, by node index
+	fdLazyMap m_lazy;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectRecord.cpp:
+ * table driven decoding of fixed size records
+ */
+#include "fileDissectRecord.h"
+
+
+static const wxChar fdHexDigits[] = wxT("0123456789abcdef");
+
+
+// n bytes from p, least significant first unless big endian
+static wxUint64 fdGetBytes(const wxByte *p, size_t n, bool be)
+{
+	wxUint64 v = 0;
+	size_t i;
+
+	if (n > 8)
+		n = 8;
+	for (i = 0; i < n; i++)
+	{
+		if (be)
+			v = (v << 8) | p[i];
+		else
+			v |= (wxUint64)p[i] << (8 * i);
+	}
+	return v;
+}
+
+
+static void fdAppendHex(wxString &dest, wxUint64 v, int digits)
+{
+	wxChar buf[17];
+	int i;
+
+	if (digits > 16)
+		digits = 16;
+	for (i = digits - 1; i >= 0; i--)
+	{
+		buf[i] = fdHexDigits[v & 0xf];
+		v >>= 4;
+	}
+	buf[digits] = 0;
+	dest += buf;
+}
+
+
+static void fdAppendDec(wxString &dest, wxUint64 v)
+{
+	wxChar buf[21];
+	int i = 20;
+
+	buf[i] = 0;
+	do
+	{
+		buf[--i] = (wxChar)(wxT('0') + (int)(v % 10));
+		v /= 10;
+	} while (v && i > 0);
+	dest += buf + i;
+}
+
+
+wxUint64 fdGetField(const wxByte *rec, const fdField *pf)
+{
+	return fdGetBytes(rec + pf->m_offset, pf->m_size, (pf->m_format & FDF_BE) != 0);
+}
+
+
+void fdFormatField(const wxByte *rec, const fdField *pf, wxString &dest)
+{
+	const wxByte *p = rec + pf->m_offset;
+	size_t i;
+
+	dest = pf->m_name;
+	dest += wxT(": ");
+	switch (pf->m_format & FDF_TYPEMASK)
+	{
+		case FDF_DEC:
+			fdAppendDec(dest, fdGetField(rec, pf));
+			break;
+
+		case FDF_BYTES:
+			for (i = 0; i < pf->m_size; i++)
+			{
+				if (i)
+					dest += wxT(" ");
+				fdAppendHex(dest, p[i], 2);
+			}
+			break;
+
+		case FDF_GUID:
+			// the first three groups are little endian, the rest is bytes
+			if (pf->m_size < 16)
+				break;
+			fdAppendHex(dest, fdGetBytes(p, 4, false), 8);
+			dest += wxT("-");
+			fdAppendHex(dest, fdGetBytes(p + 4, 2, false), 4);
+			dest += wxT("-");
+			fdAppendHex(dest, fdGetBytes(p + 6, 2, false), 4);
+			dest += wxT("-");
+			for (i = 8; i < 16; i++)
+			{
+				if (i == 10)
+					dest += wxT("-");
+				fdAppendHex(dest, p[i], 2);
+			}
+			break;
+
+		default:
+			dest += wxT("0x");
+			fdAppendHex(dest, fdGetField(rec, pf), (int)pf->m_size * 2);
+			break;
+	}
+
+	if (pf->m_annotate)
+	{
+		wxString extra;
+		pf->m_annotate(fdGetField(rec, pf), extra);
+		if (!extra.IsEmpty())
+		{
+			dest += wxT(" (");
+			dest += extra;
+			dest += wxT(")");
+		}
+	}
+}
+
+
+size_t fdAppendFields(fileDissectNodes *nodes, const wxTreeItemId &parent,
+	const fdField *fields, const wxByte *rec, size_t len, wxFileOffset off)
+{
+	const fdField *pf;
+	wxString str;
+	size_t n = 0;
+
+	for (pf = fields; pf->m_name; pf++)
+	{
+		if (pf->m_offset + pf->m_size > len)
+			continue;
+		fdFormatField(rec, pf, str);
+		nodes->AppendRange(parent, str, off + pf->m_offset, pf->m_size);
+		n++;
+	}
+	return n;
+}
@@ -0,0 +1,57 @@
+/*
+ * fileDissect - a cross platform file dissection tool
+ * Joshua J. Drake <jdrake idefense.com>
+ *
+ * fileDissectRecord.h:
+ * table driven decoding of fixed size records
+ *
+ * a record is described once, as a static table of its fields. the table
+ * drives both reading the values (always little endian unless a field says
+ * otherwise, whatever the host is) and adding one node per field, so a
+ * plugin no longer spells out an AppendItem/Format pair for every member.
+ */
+#ifndef __fileDissectRecord_h__
+#define __fileDissectRecord_h__
+
+#include "fileDissectNodes.h"
+#include <stddef.h>
+
+// how a field is shown
+#define FDF_HEX				0x00	// 0x0000, zero padded to the field size
+#define FDF_DEC				0x01
+#define FDF_BYTES			0x02	// "d0 cf 11 e0 ..."
+#define FDF_GUID			0x03	// 00000000-0000-0000-0000-000000000000
+#define FDF_TYPEMASK		0x0f
+// stored big endian
+#define FDF_BE				0x10
+
+// adds a description of the value, shown in parentheses after it
+typedef void (*fdFieldAnnotate)(wxUint64 value, wxString &dest);
+
+struct fdField
+{
+	const wxChar *m_name;
+	size_t m_offset;
+	size_t m_size;
+	int m_format;
+	fdFieldAnnotate m_annotate;
+};
+
+// field tables are built from these, and end with FD_FIELD_END
+#define FD_FIELD(type, member, name, format) \
+	{ name, offsetof(type, member), sizeof(((type *)0)->member), format, NULL }
+#define FD_FIELD_A(type, member, name, format, annotate) \
+	{ name, offsetof(type, member), sizeof(((type *)0)->member), format, annotate }
+#define FD_FIELD_END \
+	{ NULL, 0, 0, 0, NULL }
+
+// the value of a 1, 2, 4 or 8 byte field of rec
+__declspec(dllexport) wxUint64 fdGetField(const wxByte *rec, const fdField *pf);
+// "Name: value (annotation)"
+__declspec(dllexport) void fdFormatField(const wxByte *rec, const fdField *pf, wxString &dest);
+// one node per field under parent, rec sits at off in the file and has len
+// bytes. fields that don't fit in len are left out, returns how many were added
+__declspec(dllexport) size_t fdAppendFields(fileDissectNodes *nodes, const wxTreeItemId &parent,
+	const fdField *fields, const wxByte *rec, size_t len, wxFileOffset off);
+
+#endif
@@ -8,22 +8,294 @@
  */
 #include "wxFileMap.h"
 
+#if (defined(__UNIX__) || defined(__GNUWIN32__)) && !defined(__WXMSW__)
+# include <unistd.h>
+# include <fcntl.h>
+# include <errno.h>
+# include <sys/stat.h>
+#endif
+#ifdef __linux__
+# include <sys/syscall.h>
+#endif
+
+// vector units for the substring search
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define FM_HAVE_SSE2
+# include <emmintrin.h>
+#endif
+#if defined(FM_HAVE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define FM_HAVE_AVX2
+# include <immintrin.h>
+#endif
+
+
+/*
+ * substring search
+ *
+ * the vector versions compare a block of candidate positions against both the
+ * first and last byte of the needle at once, and only memcmp where both hit.
+ * which implementation gets used is decided once, at the first search.
+ */
+typedef const wxByte *(*fm_search_fn)(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen);
+
+static fm_search_fn fm_search = NULL;
+static fm_search_fn fm_rsearch = NULL;
+
+
+static const wxByte *fm_search_generic(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen == 0)
+		return hay;
+	if (nlen > hlen)
+		return NULL;
+
+	const wxByte *p = hay;
+	const wxByte *last = hay + (hlen - nlen);
+	while (p <= last)
+	{
+		// memchr is about as fast as it gets for the first byte
+		p = (const wxByte *)memchr(p, needle[0], (last - p) + 1);
+		if (!p)
+			break;
+		if (memcmp(p + 1, needle + 1, nlen - 1) == 0)
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+
+static const wxByte *fm_rsearch_generic(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen == 0)
+		return hay + hlen;
+	if (nlen > hlen)
+		return NULL;
+
+	const wxByte *p = hay + (hlen - nlen);
+	while (1)
+	{
+		if (*p == needle[0] 
+			&& p[nlen - 1] == needle[nlen - 1]
+			&& memcmp(p, needle, nlen) == 0)
+			return p;
+		if (p == hay)
+			break;
+		p--;
+	}
+	return NULL;
+}
+
+
+#ifdef FM_HAVE_SSE2
+static inline unsigned fm_ctz(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, x);
+	return (unsigned)idx;
+#else
+	return (unsigned)__builtin_ctz(x);
+#endif
+}
+
+static inline unsigned fm_top(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanReverse(&idx, x);
+	return (unsigned)idx;
+#else
+	return 31 - (unsigned)__builtin_clz(x);
+#endif
+}
+
+
+static const wxByte *fm_search_sse2(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen < 2 || nlen > hlen)
+		return fm_search_generic(hay, hlen, needle, nlen);
+
+	const __m128i vfirst = _mm_set1_epi8((char)needle[0]);
+	const __m128i vlast = _mm_set1_epi8((char)needle[nlen - 1]);
+	size_t npos = hlen - nlen + 1;
+	size_t i;
+
+	for (i = 0; i + 16 <= npos; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(hay + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(hay + i + nlen - 1));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vfirst), _mm_cmpeq_epi8(b, vlast)));
+		while (mask)
+		{
+			unsigned bit = fm_ctz(mask);
+			if (memcmp(hay + i + bit + 1, needle + 1, nlen - 2) == 0)
+				return hay + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return fm_search_generic(hay + i, hlen - i, needle, nlen);
+}
+
+
+static const wxByte *fm_rsearch_sse2(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen < 2 || nlen > hlen)
+		return fm_rsearch_generic(hay, hlen, needle, nlen);
+
+	const __m128i vfirst = _mm_set1_epi8((char)needle[0]);
+	const __m128i vlast = _mm_set1_epi8((char)needle[nlen - 1]);
+	size_t j = hlen - nlen + 1;
+
+	while (j >= 16)
+	{
+		j -= 16;
+		__m128i a = _mm_loadu_si128((const __m128i *)(hay + j));
+		__m128i b = _mm_loadu_si128((const __m128i *)(hay + j + nlen - 1));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, vfirst), _mm_cmpeq_epi8(b, vlast)));
+		while (mask)
+		{
+			unsigned bit = fm_top(mask);
+			if (memcmp(hay + j + bit + 1, needle + 1, nlen - 2) == 0)
+				return hay + j + bit;
+			mask &= ~(1U << bit);
+		}
+	}
+	// whatever is left at the front
+	return fm_rsearch_generic(hay, j + nlen - 1, needle, nlen);
+}
+#endif
+
+
+#ifdef FM_HAVE_AVX2
+__attribute__((target("avx2")))
+static const wxByte *fm_search_avx2(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen < 2 || nlen > hlen)
+		return fm_search_generic(hay, hlen, needle, nlen);
+
+	const __m256i vfirst = _mm256_set1_epi8((char)needle[0]);
+	const __m256i vlast = _mm256_set1_epi8((char)needle[nlen - 1]);
+	size_t npos = hlen - nlen + 1;
+	size_t i;
+
+	for (i = 0; i + 32 <= npos; i += 32)
+	{
+		__m256i a = _mm256_loadu_si256((const __m256i *)(hay + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(hay + i + nlen - 1));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, vfirst), _mm256_cmpeq_epi8(b, vlast)));
+		while (mask)
+		{
+			unsigned bit = fm_ctz(mask);
+			if (memcmp(hay + i + bit + 1, needle + 1, nlen - 2) == 0)
+				return hay + i + bit;
+			mask &= mask - 1;
+		}
+	}
+	return fm_search_sse2(hay + i, hlen - i, needle, nlen);
+}
+
+
+__attribute__((target("avx2")))
+static const wxByte *fm_rsearch_avx2(const wxByte *hay, size_t hlen, const wxByte *needle, size_t nlen)
+{
+	if (nlen < 2 || nlen > hlen)
+		return fm_rsearch_generic(hay, hlen, needle, nlen);
+
+	const __m256i vfirst = _mm256_set1_epi8((char)needle[0]);
+	const __m256i vlast = _mm256_set1_epi8((char)needle[nlen - 1]);
+	size_t j = hlen - nlen + 1;
+
+	while (j >= 32)
+	{
+		j -= 32;
+		__m256i a = _mm256_loadu_si256((const __m256i *)(hay + j));
+		__m256i b = _mm256_loadu_si256((const __m256i *)(hay + j + nlen - 1));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, vfirst), _mm256_cmpeq_epi8(b, vlast)));
+		while (mask)
+		{
+			unsigned bit = fm_top(mask);
+			if (memcmp(hay + j + bit + 1, needle + 1, nlen - 2) == 0)
+				return hay + j + bit;
+			mask &= ~(1U << bit);
+		}
+	}
+	return fm_rsearch_sse2(hay, j + nlen - 1, needle, nlen);
+}
+#endif
+
+
+static void fm_init_search(void)
+{
+	fm_search_fn fwd = fm_search_generic;
+	fm_search_fn rev = fm_rsearch_generic;
+
+#ifdef FM_HAVE_SSE2
+	fwd = fm_search_sse2;
+	rev = fm_rsearch_sse2;
+#endif
+#ifdef FM_HAVE_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		fwd = fm_search_avx2;
+		rev = fm_rsearch_avx2;
+	}
+#endif
+
+	// racing threads all store the same values
+	fm_rsearch = rev;
+	fm_search = fwd;
+}
+
+
+
+// mapping offsets must be a multiple of this
+static size_t fm_granularity(void)
+{
+	static size_t gran = 0;
+
+	if (!gran)
+	{
+#ifdef __WXMSW__
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		gran = si.dwAllocationGranularity;
+#else
+		long pgsz = sysconf(_SC_PAGESIZE);
+		gran = (pgsz > 0) ? (size_t)pgsz : 4096;
+#endif
+	}
+	return gran;
+}
+
 
 wxFileMap::wxFileMap (void)
 {
 	m_ptr = NULL;
-	m_offset = 0;
+	m_len = m_offset = 0;
+	m_windowed = false;
+	m_spooled = false;
+#ifdef __WXMSW__
+	m_hMap = NULL;
+#endif
+	m_windows = NULL;
+	m_window = 0;
+	m_nWindows = 0;
+	m_tick = 0;
 }
 
 wxFileMap::~wxFileMap (void)
 {
-	if (m_ptr)
+	if (m_ptr || m_windowed)
 		Close();
 	m_ptr = NULL;
 	m_offset = 0;
 }
 
-bool wxFileMap::Open(const wxChar *filename, OpenMode mode, int WXUNUSED(perms))
+
+// open the file and set up for mapping, but don't map anything yet
+bool wxFileMap::OpenFile(const wxChar *filename, OpenMode mode)
 {
 	// open the file
 	if (!wxFile::Open(filename, mode))
@@ -31,11 +303,11 @@ bool wxFileMap::Open(const wxChar *filename, OpenMode mode, int WXUNUSED(perms))
 
 	// get the length
 	m_len = wxFile::Length();
-	int fd = wxFile::fd();
+	m_mode = mode;
 
 // windows version
 #if defined(__WXMSW__)
-	HANDLE hFile = (HANDLE)_get_osfhandle(fd);
+	HANDLE hFile = (HANDLE)_get_osfhandle(wxFile::fd());
 	if (hFile == INVALID_HANDLE_VALUE)
 	{
 		wxFile::Close();
@@ -50,55 +322,421 @@ bool wxFileMap::Open(const wxChar *filename, OpenMode mode, int WXUNUSED(perms))
 		wxFile::Close();
 		return false;
 	}
+#endif
+	return true;
+}
 
+
+wxByte *wxFileMap::MapRange(wxFileOffset start, size_t len)
+{
+	wxByte *ptr;
+
+#if defined(__WXMSW__)
 	DWORD desiredAccess = FILE_MAP_READ;
-	if (mode == wxFile::read_write)
+	if (m_mode == wxFile::read_write)
 		desiredAccess = FILE_MAP_ALL_ACCESS;
-	m_ptr = (wxByte *)MapViewOfFile(m_hMap, desiredAccess, 0, 0, 0);
+	ptr = (wxByte *)MapViewOfFile(m_hMap, desiredAccess, (DWORD)(start >> 32), (DWORD)(start & 0xffffffff), len);
+
+#elif (defined(__UNIX__) || defined(__GNUWIN32__))
+	int prot = PROT_READ;
+	if (m_mode == wxFile::read_write)
+		prot |= PROT_WRITE;
+	ptr = (wxByte *)mmap(NULL, len, prot, MAP_PRIVATE, wxFile::fd(), start);
+	if (ptr == MAP_FAILED)
+		ptr = NULL;
+#endif
+
+	return ptr;
+}
+
+
+void wxFileMap::UnmapRange(wxByte *ptr, size_t len)
+{
+#ifdef __WXMSW__
+	(void)len;
+	UnmapViewOfFile(ptr);
+#elif (defined(__UNIX__) || defined(__GNUWIN32__))
+	if (munmap(ptr, len) == -1)
+		/* need error report */;
+#endif
+}
+
+
+bool wxFileMap::Open(const wxChar *filename, OpenMode mode, int WXUNUSED(perms))
+{
+	if (!OpenFile(filename, mode))
+		return false;
+
+	// (a file bigger than size_t can't be mapped in one go)
+	if ((wxFileOffset)(size_t)m_len == m_len)
+		m_ptr = MapRange(0, (size_t)m_len);
 	if (!m_ptr)
 	{
-		CloseHandle(m_hMap);
-		wxFile::Close();
+		// too big for the address space? try it a window at a time
+		if (m_len > 0 && InitWindows(0, 0))
+		{
+			wxLogMessage(wxT("%s: Unable to map all of \"%s\", using windowed mode"), wxT("wxFileMap::Open()"), filename);
+			m_filename = filename;
+			return true;
+		}
+		CloseFile();
 		return false;
 	}
 
-// *nix version
-#elif (defined(__UNIX__) || defined(__GNUWIN32__))
-	int prot = PROT_READ;
-	if (mode == wxFile::read_write)
-		prot |= PROT_WRITE;
-	m_ptr = (wxByte *)mmap(NULL, m_len, prot, MAP_PRIVATE, fd, 0);
-	if (m_ptr == MAP_FAILED)
+	m_filename = filename;
+	return true;
+}
+
+
+bool wxFileMap::OpenWindowed(const wxChar *filename, size_t window, size_t count)
+{
+	if (!OpenFile(filename, read))
+		return false;
+
+	if (m_len < 1 || !InitWindows(window, count))
 	{
-		m_ptr = NULL;
-		wxFile::Close();
+		CloseFile();
 		return false;
 	}
-#endif
 
 	m_filename = filename;
 	return true;
 }
 
-void wxFileMap::Close(void)
+
+bool wxFileMap::InitWindows(size_t window, size_t count)
+{
+	size_t gran = fm_granularity();
+
+	if (!window)
+		window = WXFM_DEFAULT_WINDOW;
+	if (!count)
+		count = WXFM_DEFAULT_WINDOWS;
+
+	// round the window up to the mapping granularity
+	window = ((window + gran - 1) / gran) * gran;
+
+	m_windows = (wxFileMapWindow *)calloc(count, sizeof(wxFileMapWindow));
+	if (!m_windows)
+		return false;
+	m_window = window;
+	m_nWindows = count;
+	m_tick = 0;
+	m_windowed = true;
+	return true;
+}
+
+
+void wxFileMap::CloseFile(void)
 {
 #ifdef __WXMSW__
-	if (m_ptr)
-	{
-		UnmapViewOfFile(m_ptr);
+	if (m_hMap)
 		CloseHandle(m_hMap);
-	}
-#elif (defined(__UNIX__) || defined(__GNUWIN32__))
-	if (m_ptr && munmap(m_ptr, m_len) == -1)
-		/* need error report */;
+	m_hMap = NULL;
 #endif
-
 	wxFile::Close();
-	m_ptr = NULL;
 	m_len = m_offset = 0;
 }
 
 
+void wxFileMap::Close(void)
+{
+	if (m_windowed)
+	{
+		size_t i;
+		for (i = 0; i < m_nWindows; i++)
+		{
+			if (m_windows[i].ptr)
+				UnmapRange(m_windows[i].ptr, m_windows[i].len);
+		}
+		free(m_windows);
+		m_windows = NULL;
+		m_nWindows = 0;
+		m_windowed = false;
+	}
+	else if (m_spooled)
+	{
+		free(m_ptr);
+		m_spooled = false;
+	}
+	else if (m_ptr)
+		UnmapRange(m_ptr, (size_t)m_len);
+
+	CloseFile();
+	m_ptr = NULL;
+}
+
+
+/*
+ * streaming input
+ *
+ * pipes can't be mapped, so spool everything into memory up front. on linux
+ * that's a memfd (filled with splice where the kernel lets us), which then
+ * gets mapped like any other file. elsewhere it's just a heap buffer. either
+ * way the result looks exactly like a normal mapping to the caller.
+ */
+#if defined(__linux__) && defined(SYS_memfd_create)
+static int fm_memfd_create(void)
+{
+	// MFD_CLOEXEC
+	return (int)syscall(SYS_memfd_create, "wxFileMap", 1U);
+}
+
+// copy everything from one descriptor to another, returning the byte count
+static bool fm_copy_fd(int in, int out, wxFileOffset *ptotal)
+{
+	wxFileOffset total = 0;
+	bool use_splice = true;
+	char *buf = NULL;
+	bool ok = true;
+
+	while (1)
+	{
+		ssize_t n;
+
+		if (use_splice)
+		{
+			n = splice(in, NULL, out, NULL, WXFM_SPOOL_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (n < 0 && (errno == EINVAL || errno == ENOSYS) && total == 0)
+			{
+				// not a pipe, do it the old fashioned way
+				use_splice = false;
+				continue;
+			}
+		}
+		else
+		{
+			if (!buf && !(buf = (char *)malloc(WXFM_SPOOL_CHUNK)))
+			{
+				ok = false;
+				break;
+			}
+			n = read(in, buf, WXFM_SPOOL_CHUNK);
+			if (n > 0)
+			{
+				ssize_t done = 0;
+				while (done < n)
+				{
+					ssize_t nw = write(out, buf + done, n - done);
+					if (nw < 0 && errno == EINTR)
+						continue;
+					if (nw <= 0)
+					{
+						ok = false;
+						break;
+					}
+					done += nw;
+				}
+				if (!ok)
+					break;
+			}
+		}
+
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0)
+		{
+			ok = false;
+			break;
+		}
+		if (n == 0)
+			break;
+		total += n;
+	}
+
+	if (buf)
+		free(buf);
+	*ptotal = total;
+	return ok;
+}
+#endif
+
+
+bool wxFileMap::OpenStream(int fd, const wxChar *name)
+{
+	wxFileOffset total = 0;
+
+#if (defined(__UNIX__) || defined(__GNUWIN32__)) && !defined(__WXMSW__)
+	// redirected from a regular file? just map it
+	struct stat st;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+		&& (wxFileOffset)(size_t)st.st_size == (wxFileOffset)st.st_size)
+	{
+		int dfd = dup(fd);
+		if (dfd >= 0)
+		{
+			wxFile::Attach(dfd);
+			m_len = st.st_size;
+			m_mode = read;
+			if ((m_ptr = MapRange(0, (size_t)m_len)))
+			{
+				m_filename = name;
+				return true;
+			}
+			CloseFile();
+		}
+	}
+#endif
+
+#if defined(__linux__) && defined(SYS_memfd_create)
+	int mfd = fm_memfd_create();
+	if (mfd >= 0)
+	{
+		// once we start reading there's no going back, so failures are final
+		wxFile::Attach(mfd);
+		if (!fm_copy_fd(fd, mfd, &total))
+		{
+			wxLogError(wxT("%s: Error reading \"%s\" after 0x%lx bytes"), wxT("wxFileMap::OpenStream()"), name, (unsigned long)total);
+			CloseFile();
+			return false;
+		}
+		if (total < 1)
+		{
+			wxLogError(wxT("%s: No data to read from \"%s\""), wxT("wxFileMap::OpenStream()"), name);
+			CloseFile();
+			return false;
+		}
+		m_len = total;
+		m_mode = read;
+		if ((wxFileOffset)(size_t)m_len != m_len
+			|| !(m_ptr = MapRange(0, (size_t)m_len)))
+		{
+			wxLogError(wxT("%s: Unable to map 0x%lx bytes spooled from \"%s\""), wxT("wxFileMap::OpenStream()"), (unsigned long)total, name);
+			CloseFile();
+			return false;
+		}
+		m_filename = name;
+		return true;
+	}
+#endif
+
+	// plain heap buffer, grown a chunk at a time
+	size_t alloc = 0;
+	wxByte *buf = NULL;
+	while (1)
+	{
+		if ((size_t)total == alloc)
+		{
+			size_t nalloc = alloc ? alloc * 2 : WXFM_SPOOL_CHUNK;
+			wxByte *nbuf = (wxByte *)realloc(buf, nalloc);
+			if (!nbuf)
+			{
+				wxLogError(wxT("%s: Unable to allocate %lu bytes for \"%s\""), wxT("wxFileMap::OpenStream()"), (unsigned long)nalloc, name);
+				free(buf);
+				return false;
+			}
+			buf = nbuf;
+			alloc = nalloc;
+		}
+
+		ssize_t n = wxRead(fd, buf + total, alloc - (size_t)total);
+		if (n < 0)
+		{
+#ifdef EINTR
+			if (errno == EINTR)
+				continue;
+#endif
+			wxLogError(wxT("%s: Error reading \"%s\" after 0x%lx bytes"), wxT("wxFileMap::OpenStream()"), name, (unsigned long)total);
+			free(buf);
+			return false;
+		}
+		if (n == 0)
+			break;
+		total += n;
+	}
+
+	if (total < 1)
+	{
+		wxLogError(wxT("%s: No data to read from \"%s\""), wxT("wxFileMap::OpenStream()"), name);
+		free(buf);
+		return false;
+	}
+
+	m_ptr = buf;
+	m_len = total;
+	m_mode = read;
+	m_spooled = true;
+	m_filename = name;
+	return true;
+}
+
+
+/*
+ * windowed mode
+ *
+ * the file is mapped in m_window sized pieces, and the last m_nWindows of
+ * them that were used stay mapped. a pointer from View (or FindString, or
+ * GetAddress) is only good until its window gets recycled, so anything that
+ * holds on to data for a while should copy it out with ReadAt. that includes
+ * other threads: any View from one of them can recycle the window another
+ * one is still looking at, so only ReadAt is safe to share a mapping with.
+ */
+const wxByte *wxFileMap::WindowView(wxFileOffset ofs, size_t nCount) const
+{
+	// a zero length view at EOF still needs a window to point into
+	wxFileOffset first = ofs;
+	size_t need = nCount;
+	if (!need)
+	{
+		if (first == m_len)
+			first--;
+		need = 1;
+	}
+
+	// already mapped?
+	size_t i, victim = 0;
+	for (i = 0; i < m_nWindows; i++)
+	{
+		wxFileMapWindow *pw = m_windows + i;
+		if (pw->ptr
+			&& first >= pw->start
+			&& first + (wxFileOffset)need <= pw->start + (wxFileOffset)pw->len)
+		{
+			pw->used = ++m_tick;
+			return pw->ptr + (ofs - pw->start);
+		}
+
+		// track the least recently used (or empty) slot
+		if (m_windows[victim].ptr && (!pw->ptr || pw->used < m_windows[victim].used))
+			victim = i;
+	}
+
+	// map a new one, bigger than usual if the range straddles a boundary
+	wxFileOffset start = first - (first % m_window);
+	wxFileOffset len = first + need - start;
+	wxFileOffset gran = fm_granularity();
+	len = ((len + gran - 1) / gran) * gran;
+	if (len < (wxFileOffset)m_window)
+		len = m_window;
+	if (start + len > m_len)
+		len = m_len - start;
+
+	wxFileMap *self = (wxFileMap *)this;
+	wxByte *ptr = self->MapRange(start, (size_t)len);
+	if (!ptr)
+	{
+		wxLogError(wxT("%s: Unable to map 0x%lx bytes at 0x%lx"), wxT("wxFileMap::WindowView()"), (unsigned long)len, (unsigned long)start);
+		return NULL;
+	}
+
+	wxFileMapWindow *pw = m_windows + victim;
+	if (pw->ptr)
+		self->UnmapRange(pw->ptr, pw->len);
+	pw->start = start;
+	pw->len = (size_t)len;
+	pw->ptr = ptr;
+	pw->used = ++m_tick;
+	return ptr + (ofs - start);
+}
+
+
+bool wxFileMap::IsWindowed(void) const
+{
+	return m_windowed;
+}
+
+
+// NULL in windowed mode, there is no single base address
 wxByte *wxFileMap::GetBaseAddress()
 {
 	return m_ptr;
@@ -106,6 +744,8 @@ wxByte *wxFileMap::GetBaseAddress()
 
 wxByte *wxFileMap::GetAddress()
 {
+	if (m_windowed)
+		return (wxByte *)View(m_offset, 0);
 	return m_ptr + m_offset;
 }
 
@@ -116,29 +756,154 @@ wxFileOffset wxFileMap::Length(void)
 
 ssize_t wxFileMap::Read(void *pBuf, size_t nCount)
 {
-	// must have map
-	if (!m_ptr)
-		return wxInvalidOffset;
+	return ReadAt(m_offset, pBuf, nCount);
+}
 
-	// offset must be in bounds
-	if (m_offset < 0 || m_offset > m_len)
-		return wxInvalidOffset;
 
-	// convert to space after the offset only
-	wxFileOffset left = m_len - m_offset;
+/*
+ * ReadAt doesn't touch m_offset and copies while holding the lock, so any
+ * number of threads can use it on the same mapping at once. View can only
+ * be shared like that when the file isn't windowed (see above).
+ */
+ssize_t wxFileMap::ReadAt(wxFileOffset ofs, void *pBuf, size_t nCount) const
+{
+	if (!m_windowed)
+	{
+		const wxByte *p = View(ofs, nCount);
+		if (!p)
+			return wxInvalidOffset;
+
+		memcpy(pBuf, p, nCount);
+		return nCount;
+	}
 
-	// must have enough data to cover the entire read
-	if ((wxFileOffset)nCount > left)
+	// windowed, copy it a window at a time while holding the lock
+	if (ofs < 0 || ofs > m_len || (wxFileOffset)nCount > m_len - ofs)
 		return wxInvalidOffset;
 
-	memcpy(pBuf, m_ptr + m_offset, nCount);
+	wxMutexLocker lock(m_lock);
+	wxByte *dst = (wxByte *)pBuf;
+	size_t done = 0;
+	while (done < nCount)
+	{
+		wxFileOffset cur = ofs + done;
+		size_t piece = (size_t)(m_window - (cur % m_window));
+		if (piece > nCount - done)
+			piece = nCount - done;
+
+		const wxByte *p = WindowView(cur, piece);
+		if (!p)
+			return wxInvalidOffset;
+		memcpy(dst + done, p, piece);
+		done += piece;
+	}
 	return nCount;
 }
 
+
+// get a pointer to nCount bytes at ofs, or NULL if they aren't all there
+const wxByte *wxFileMap::View(wxFileOffset ofs, size_t nCount) const
+{
+	// must have map
+	if (!m_ptr && !m_windowed)
+		return NULL;
+
+	// offset must be in bounds
+	if (ofs < 0 || ofs > m_len)
+		return NULL;
+
+	// must have enough data to cover the entire range
+	if ((wxFileOffset)nCount > m_len - ofs)
+		return NULL;
+
+	if (m_windowed)
+	{
+		wxMutexLocker lock(m_lock);
+		return WindowView(ofs, nCount);
+	}
+	return m_ptr + ofs;
+}
+
+
+// tell the OS how we are about to use [ofs, ofs + len), or everything if len is 0
+void wxFileMap::Advise(wxFileMapAdvice advice, wxFileOffset ofs, wxFileOffset len)
+{
+#if (defined(__UNIX__) || defined(__GNUWIN32__)) && defined(MADV_SEQUENTIAL)
+	// heap memory from a spooled stream isn't ours to advise on
+	if ((!m_ptr && !m_windowed) || m_spooled)
+		return;
+
+	if (ofs < 0 || ofs > m_len)
+		return;
+	if (len <= 0 || len > m_len - ofs)
+		len = m_len - ofs;
+
+	int madv = MADV_NORMAL;
+	switch (advice)
+	{
+		case wxFM_ADVISE_SEQUENTIAL:
+			madv = MADV_SEQUENTIAL;
+			break;
+		case wxFM_ADVISE_RANDOM:
+			madv = MADV_RANDOM;
+			break;
+		case wxFM_ADVISE_WILLNEED:
+			madv = MADV_WILLNEED;
+			break;
+		default:
+			break;
+	}
+
+	if (!m_windowed)
+	{
+		wxFileOffset gran = fm_granularity();
+		wxFileOffset start = ofs - (ofs % gran);
+		(void)madvise(m_ptr + start, (size_t)(ofs + len - start), madv);
+		return;
+	}
+
+	// windowed, advise the windows we have and the page cache for the rest
+	{
+		wxMutexLocker lock(m_lock);
+		size_t i;
+		for (i = 0; i < m_nWindows; i++)
+		{
+			wxFileMapWindow *pw = m_windows + i;
+			if (pw->ptr && pw->start < ofs + len && pw->start + (wxFileOffset)pw->len > ofs)
+				(void)madvise(pw->ptr, pw->len, madv);
+		}
+	}
+# ifdef POSIX_FADV_SEQUENTIAL
+	int fadv = POSIX_FADV_NORMAL;
+	switch (advice)
+	{
+		case wxFM_ADVISE_SEQUENTIAL:
+			fadv = POSIX_FADV_SEQUENTIAL;
+			break;
+		case wxFM_ADVISE_RANDOM:
+			fadv = POSIX_FADV_RANDOM;
+			break;
+		case wxFM_ADVISE_WILLNEED:
+			fadv = POSIX_FADV_WILLNEED;
+			break;
+		default:
+			break;
+	}
+	(void)posix_fadvise(wxFile::fd(), ofs, len, fadv);
+# endif
+#else
+	// no equivalent we can count on, hints are optional anyway
+	(void)advice;
+	(void)ofs;
+	(void)len;
+#endif
+}
+
+
 wxFileOffset wxFileMap::Seek(wxFileOffset ofs, wxSeekMode mode)
 {
 	// must have map
-	if (!m_ptr)
+	if (!m_ptr && !m_windowed)
 		return wxInvalidOffset;
 
 	if (mode == wxFromStart)
@@ -161,62 +926,106 @@ wxFileOffset wxFileMap::Seek(wxFileOffset ofs, wxSeekMode mode)
 }
 
 
+// search the whole file starting at the current offset
 wxByte *wxFileMap::FindString(const char *str)
 {
-	wxByte *p = m_ptr + m_offset;
-	wxByte *end = m_ptr + m_len;
-	size_t len = strlen(str);
+	return FindString(str, m_offset, m_len);
+}
 
-	while (1)
+
+// search [start, end) for the first occurrence
+wxByte *wxFileMap::FindString(const char *str, wxFileOffset start, wxFileOffset end)
+{
+	if (!m_ptr && !m_windowed)
+		return NULL;
+
+	if (start < 0)
+		start = 0;
+	if (end > m_len)
+		end = m_len;
+	if (start >= end)
+		return NULL;
+
+	if (!fm_search)
+		fm_init_search();
+
+	size_t nlen = strlen(str);
+	if (!m_windowed)
+		return (wxByte *)fm_search(m_ptr + start, (size_t)(end - start), (const wxByte *)str, nlen);
+
+	// a window at a time, overlapping so matches across the seams are found
+	wxFileOffset step = (nlen < m_window) ? (wxFileOffset)(m_window - nlen + 1) : 1;
+	wxFileOffset cur;
+	for (cur = start; cur < end; cur += step)
 	{
-		// find next occurrence of first char
-		while (p < end && *p != *str)
-			p++;
-		// eek!
-		if (p >= end)
+		wxFileOffset clen = end - cur;
+		if (clen > (wxFileOffset)m_window)
+			clen = m_window;
+		if (clen < (wxFileOffset)nlen)
 			break;
-		// check if the entire string is there
-		if (memcmp(p, str, len) == 0)
-			return p;
-		// skip current occurrence of byte
-		p++;
-	}
 
-	// not found :(
+		// searched under the lock, so no one recycles the window halfway
+		wxMutexLocker lock(m_lock);
+		const wxByte *p = WindowView(cur, (size_t)clen);
+		if (!p)
+			break;
+		p = fm_search(p, (size_t)clen, (const wxByte *)str, nlen);
+		if (p)
+			return (wxByte *)p;
+		if (cur + clen >= end)
+			break;
+	}
 	return NULL;
 }
 
 
+// search backwards for an occurrence starting at or before the current offset
 wxByte *wxFileMap::FindStringReverse(const char *str)
 {
-	size_t len = strlen(str);
-	wxByte *p = m_ptr + m_offset;
-	wxByte *end = m_ptr + m_len;
-	do
-	{
-		while (p > m_ptr && *p != *str)
-			p--;
+	return FindStringReverse(str, 0, m_offset + strlen(str));
+}
 
-		if (p <= m_ptr)
-			return NULL;
 
-		if ((size_t)(end - p) < len) // should be safe, so we cast to get rid of warning
-		{
-			// not enough
-			p--;
-			continue;
-		}
+// search [start, end) for the last occurrence
+wxByte *wxFileMap::FindStringReverse(const char *str, wxFileOffset start, wxFileOffset end)
+{
+	if (!m_ptr && !m_windowed)
+		return NULL;
 
-		if (memcmp(p, str, len) != 0)
-		{
-			// mismatch
-			p--;
-			continue;
-		}
+	if (start < 0)
+		start = 0;
+	if (end > m_len)
+		end = m_len;
+	if (start >= end)
+		return NULL;
 
-		// got it
-		break;
-	} while(1);
+	if (!fm_rsearch)
+		fm_init_search();
 
-	return p;
+	size_t nlen = strlen(str);
+	if (!m_windowed)
+		return (wxByte *)fm_rsearch(m_ptr + start, (size_t)(end - start), (const wxByte *)str, nlen);
+
+	wxFileOffset step = (nlen < m_window) ? (wxFileOffset)(m_window - nlen + 1) : 1;
+	wxFileOffset cur;
+	for (cur = end; cur > start; cur -= step)
+	{
+		wxFileOffset clen = cur - start;
+		if (clen > (wxFileOffset)m_window)
+			clen = m_window;
+		if (clen < (wxFileOffset)nlen)
+			break;
+
+		// searched under the lock, so no one recycles the window halfway
+		wxMutexLocker lock(m_lock);
+		const wxByte *p = WindowView(cur - clen, (size_t)clen);
+		if (!p)
+			break;
+		p = fm_rsearch(p, (size_t)clen, (const wxByte *)str, nlen);
+		if (p)
+			return (wxByte *)p;
+		if (cur - start <= step)
+			break;
+	}
+	return NULL;
 }
@@ -25,6 +25,7 @@
 # include <wx/wx.h>
 #endif
 #include <wx/file.h>
+#include <wx/thread.h>
 
 // for mapping code
 #ifdef __WXMSW__
@@ -33,6 +34,22 @@
 # include <sys/mman.h>
 #endif
 
+// windowed mode defaults
+#define WXFM_DEFAULT_WINDOW		(64 * 1024 * 1024)
+#define WXFM_DEFAULT_WINDOWS	8
+
+// read size when spooling a stream
+#define WXFM_SPOOL_CHUNK		(1024 * 1024)
+
+// access pattern hints for Advise()
+enum wxFileMapAdvice
+{
+	wxFM_ADVISE_NORMAL,
+	wxFM_ADVISE_SEQUENTIAL,
+	wxFM_ADVISE_RANDOM,
+	wxFM_ADVISE_WILLNEED
+};
+
 class wxFileMap : private wxFile
 {
 public:
@@ -40,17 +57,28 @@ public:
 	__declspec(dllexport) ~wxFileMap (void);
 
 	__declspec(dllexport) bool Open(const wxChar *filename, OpenMode mode = read, int perms = wxS_DEFAULT);
+	// map the file a window at a time instead of all at once (read only)
+	__declspec(dllexport) bool OpenWindowed(const wxChar *filename, size_t window = 0, size_t count = 0);
+	__declspec(dllexport) bool IsWindowed(void) const;
+	// read a pipe (or any descriptor) to EOF and map the result
+	__declspec(dllexport) bool OpenStream(int fd, const wxChar *name = wxT("-"));
 	__declspec(dllexport) void Close(void);
 
 	__declspec(dllexport) ssize_t Read(void *pBuf, size_t nCount);
+	__declspec(dllexport) ssize_t ReadAt(wxFileOffset ofs, void *pBuf, size_t nCount) const;
+	__declspec(dllexport) const wxByte *View(wxFileOffset ofs, size_t nCount) const;
 	__declspec(dllexport) wxFileOffset Seek(wxFileOffset ofs, wxSeekMode mode = wxFromStart);
 	__declspec(dllexport) wxByte *FindString(const char *str);
+	__declspec(dllexport) wxByte *FindString(const char *str, wxFileOffset start, wxFileOffset end);
 	__declspec(dllexport) wxByte *FindStringReverse(const char *str);
+	__declspec(dllexport) wxByte *FindStringReverse(const char *str, wxFileOffset start, wxFileOffset end);
 
 	__declspec(dllexport) wxByte *GetBaseAddress(void);
 	__declspec(dllexport) wxByte *GetAddress(void);
 	__declspec(dllexport) wxFileOffset Length(void);
 
+	__declspec(dllexport) void Advise(wxFileMapAdvice advice, wxFileOffset ofs = 0, wxFileOffset len = 0);
+
 	wxString m_filename;
 
 protected:
@@ -60,6 +88,31 @@ protected:
 	wxByte *m_ptr;
 	wxFileOffset m_len;
 	wxFileOffset m_offset;
+	OpenMode m_mode;
+
+	// windowed mode
+	struct wxFileMapWindow
+	{
+		wxFileOffset start;
+		size_t len;
+		wxByte *ptr;
+		unsigned long used;
+	};
+	bool m_windowed;
+	bool m_spooled;		// m_ptr is a heap buffer
+	wxFileMapWindow *m_windows;
+	size_t m_window;
+	size_t m_nWindows;
+	mutable unsigned long m_tick;
+	mutable wxMutex m_lock;
+
+private:
+	bool OpenFile(const wxChar *filename, OpenMode mode);
+	void CloseFile(void);
+	bool InitWindows(size_t window, size_t count);
+	wxByte *MapRange(wxFileOffset start, size_t len);
+	void UnmapRange(wxByte *ptr, size_t len);
+	const wxByte *WindowView(wxFileOffset ofs, size_t nCount) const;
 };
 
 #endif
@@ -12,6 +12,9 @@
 #include <wx/list.h>
 #include <wx/filename.h>
 #include <wx/dir.h>
+#include <wx/textfile.h>
+#include <wx/filefn.h>
+#include <wx/log.h>
 
 #ifdef __WXMSW__
 typedef HMODULE				libhandle_t;
@@ -36,22 +39,113 @@ typedef void *				libhandle_t;
 
 
 
+/*
+ * modules are described by a manifest cached next to them, keyed by file
+ * name and modification time. unchanged modules are not loaded until some-
+ * thing actually asks for their instance (GetInstance), so startup costs a
+ * directory scan and one small text file read no matter how many plugins
+ * are installed.
+ *
+ * each manifest record is a list of "key<TAB>value" lines. "description" is
+ * always present, anything else comes from the list's Describe() override.
+ */
+#define WXPLL_MANIFEST			wxT("plugins.manifest")
+#define WXPLL_MANIFEST_MAGIC	wxT("fileDissect plugin manifest 1")
+#define WXPLL_MANIFEST_MODULE	wxT("module")
+
+
 #define WX_DECLARE_PLUGINLIST(apiclass, lcname) \
-	typedef apiclass *(*pfn##apiclass)(wxLog *plog, fileDissectTreeCtrl *tree); \
+	typedef apiclass *(*pfn##apiclass)(wxLog *plog, fileDissectNodes *tree); \
 	\
 	class apiclass##__Module \
 	{ \
 	public: \
-		apiclass##__Module(wxString &fname, libhandle_t h, pfn##apiclass ci, apiclass *ph) \
-			: m_filename(fname), m_handle(h), m_create_instance(ci), m_instance(ph) { }; \
+		apiclass##__Module(wxString &fname, wxString &fullpath, time_t mtime, wxLog *plog, fileDissectNodes *tree) \
+			: m_filename(fname), m_path(fullpath), m_mtime(mtime), m_handle(0), m_create_instance(0), m_instance(0), \
+			  m_log(plog), m_tree(tree) { }; \
 		~apiclass##__Module(void) { \
 			if (m_instance) delete m_instance; \
 			if (m_handle) WXPLL_CLOSE(m_handle); \
 		}; \
+		bool IsLoaded(void) const { return (m_instance != 0); }; \
+		apiclass *GetInstance(void) { \
+			if (!m_instance) Load(); \
+			return m_instance; \
+		}; \
+		bool Load(void) \
+		{ \
+			libhandle_t h; \
+			pfn##apiclass pfn; \
+			apiclass *ph; \
+			if (m_instance) return true; \
+			if (!(h = WXPLL_LOAD(m_path.fn_str()))) \
+			{ \
+			   	WXPLL_LOADERRMSG(""); \
+				wxLogError(wxT("Unable to load plugin \"%s\": %s"), \
+					m_filename.c_str(), errMsg.c_str()); \
+				return false; \
+			} \
+		   	if (!(pfn = (pfn##apiclass)WXPLL_LOOKUP(h, "create_instance"))) \
+			{ \
+				WXPLL_CLOSE(h); \
+				wxLogError(wxT("Invalid plugin \"%s\": Unable to lookup export"), m_filename.c_str()); \
+				return false; \
+			} \
+			if (!(ph = pfn(m_log, m_tree))) \
+			{ \
+				WXPLL_CLOSE(h); \
+				wxLogError(wxT("Invalid plugin \"%s\": Object factory failed"), m_filename.c_str()); \
+				return false; \
+			} \
+			m_handle = h; \
+			m_create_instance = pfn; \
+			m_instance = ph; \
+			return true; \
+		}; \
+		/* manifest access */ \
+		wxString GetManifest(const wxChar *key) const \
+		{ \
+			for (size_t i = 0; i < m_manifest.GetCount(); i++) \
+				if (m_manifest[i].BeforeFirst(wxT('\t')) == key) \
+					return m_manifest[i].AfterFirst(wxT('\t')); \
+			return wxEmptyString; \
+		}; \
+		void AddManifest(const wxChar *key, const wxString &value) \
+		{ \
+			wxString line(key); \
+			line += wxT("\t"); \
+			line += value; \
+			m_manifest.Add(line); \
+		}; \
+		wxString ManifestHeader(void) const \
+		{ \
+			return wxString::Format(wxT("%s\t%ld\t%s"), WXPLL_MANIFEST_MODULE, \
+				(long)m_mtime, m_filename.c_str()); \
+		}; \
+		bool FromManifest(wxTextFile &cache) \
+		{ \
+			wxString hdr = ManifestHeader(); \
+			for (size_t i = 1; i < cache.GetLineCount(); i++) \
+			{ \
+				if (cache[i] != hdr) continue; \
+				for (i++; i < cache.GetLineCount(); i++) \
+				{ \
+					if (cache[i].BeforeFirst(wxT('\t')) == WXPLL_MANIFEST_MODULE) break; \
+					m_manifest.Add(cache[i]); \
+				} \
+				return (m_manifest.GetCount() > 0); \
+			} \
+			return false; \
+		}; \
 		wxString m_filename; \
+		wxString m_path; \
+		time_t m_mtime; \
 		libhandle_t m_handle; \
 		pfn##apiclass m_create_instance; \
 		apiclass *m_instance; \
+		wxLog *m_log; \
+		fileDissectNodes *m_tree; \
+		wxArrayString m_manifest; \
 	}; \
 	WX_DECLARE_LIST(apiclass##__Module, apiclass##__List); \
 	class lcname \
@@ -61,48 +155,70 @@ typedef void *				libhandle_t;
 			m_list.DeleteContents(true); \
 			wxString path = wxT("."); \
 		}; \
-		void LoadPlugins(wxString &path, wxLog *plog, fileDissectTreeCtrl *tree) \
+		virtual ~lcname(void) { }; \
+		/* record whatever the list needs to know without loading the module */ \
+		virtual void Describe(apiclass##__Module *WXUNUSED(pm)) { }; \
+		void LoadPlugins(wxString &path, wxLog *plog, fileDissectNodes *tree) \
 		{ \
 			m_list.clear(); \
 			wxDir dir(path); \
 			if (!dir.IsOpened()) return; \
+			wxString mpath = path + WXPLL_MANIFEST; \
+			wxTextFile cache; \
+			bool have_cache = false, dirty = false; \
+			size_t ncached = 0; \
+			if (wxFileExists(mpath)) \
+			{ \
+				wxLogNull nolog; \
+				have_cache = (cache.Open(mpath) && cache.GetLineCount() > 0 \
+					&& cache[0] == WXPLL_MANIFEST_MAGIC); \
+				for (size_t i = 1; have_cache && i < cache.GetLineCount(); i++) \
+					if (cache[i].BeforeFirst(wxT('\t')) == WXPLL_MANIFEST_MODULE) ncached++; \
+			} \
 			wxString filespec(wxT("*.")); \
 			filespec += WXPLL_EXT; \
 			wxString fname; \
 			bool cont = dir.GetFirst(&fname, filespec, wxDIR_FILES | wxDIR_HIDDEN); \
 			while (cont) { \
 				wxString fullpath = path + fname; \
-				pfn##apiclass pfn; \
-				apiclass *ph = 0; \
-				libhandle_t h; \
-				if (!(h = WXPLL_LOAD(fullpath.fn_str()))) \
+				apiclass##__Module *pm = new apiclass##__Module(fname, fullpath, \
+					wxFileModificationTime(fullpath), plog, tree); \
+				if (!have_cache || !pm->FromManifest(cache)) \
 				{ \
-				   	WXPLL_LOADERRMSG(""); \
-					wxLogError(wxT("Unable to load plugin \"%s\": %s"), \
-						fname.c_str(), errMsg.c_str()); \
-				   	cont = dir.GetNext(&fname); \
-				   	continue; \
+					if (!pm->Load()) \
+					{ \
+						delete pm; \
+					   	cont = dir.GetNext(&fname); \
+					   	continue; \
+					} \
+					pm->AddManifest(wxT("description"), pm->m_instance->m_description); \
+					Describe(pm); \
+					dirty = true; \
 				} \
-			   	if (!(pfn = (pfn##apiclass)WXPLL_LOOKUP(h, "create_instance"))) \
-				{ \
-					WXPLL_CLOSE(h); \
-					wxLogError(wxT("Invalid plugin \"%s\": Unable to lookup export"), fname.c_str()); \
-				   	cont = dir.GetNext(&fname); \
-				   	continue; \
-				} \
-				if (!(ph = pfn(plog, tree))) \
-				{ \
-					WXPLL_CLOSE(h); \
-					wxLogError(wxT("Invalid plugin \"%s\": Object factory failed"), fname.c_str()); \
-				   	cont = dir.GetNext(&fname); \
-				   	continue; \
-				} \
-				m_list.push_back(new apiclass##__Module(fname, h, pfn, ph)); \
+				m_list.push_back(pm); \
 			       	wxLogMessage(wxT("Registered support for \"%s\" (%s)"), \
-		       			ph->m_description, fname.c_str()); \
+		       			pm->GetManifest(wxT("description")).c_str(), fname.c_str()); \
 				\
 				cont = dir.GetNext(&fname); \
 			} \
+			if (dirty || ncached != m_list.size()) \
+				WriteManifest(mpath); \
+		}; \
+		void WriteManifest(wxString &mpath) \
+		{ \
+			/* the plugin directory may well be read-only, that's fine */ \
+			wxLogNull nolog; \
+			wxTextFile out; \
+			if (!(wxFileExists(mpath) ? out.Open(mpath) : out.Create(mpath))) return; \
+			out.Clear(); \
+			out.AddLine(WXPLL_MANIFEST_MAGIC); \
+			for (iterator i = begin(); i != end(); i++) \
+			{ \
+				out.AddLine((*i)->ManifestHeader()); \
+				for (size_t j = 0; j < (*i)->m_manifest.GetCount(); j++) \
+					out.AddLine((*i)->m_manifest[j]); \
+			} \
+			out.Write(); \
 		}; \
 		typedef apiclass##__List::iterator iterator; \
 		iterator begin() { return m_list.begin(); } \